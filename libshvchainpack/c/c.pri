@@ -2,10 +2,12 @@ HEADERS += \
     $$PWD/ccpcp.h \
     $$PWD/ccpon.h \
     $$PWD/cchainpack.h \
+    $$PWD/ccpcp_convert.h \
 
 SOURCES += \
     $$PWD/ccpcp.c \
     $$PWD/ccpon.c \
     $$PWD/cchainpack.c \
+    $$PWD/ccpcp_convert.c \
 
 
@@ -162,9 +162,71 @@ static int bytes_needed(int bit_len)
                     n == 15 -> for future (number of bytes will be specified in next byte)
 */
 
+static uint64_t load_be64(const void *data)
+{
+	uint64_t ret;
+	memcpy(&ret, data, sizeof(ret));
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	ret = __builtin_bswap64(ret);
+#elif !(defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+	{
+		const uint8_t *p = (const uint8_t*)data;
+		int i;
+		ret = 0;
+		for (i = 0; i < 8; ++i)
+			ret = (ret << 8) | p[i];
+	}
+#endif
+	return ret;
+}
+
+static void store_be64(void *data, uint64_t val)
+{
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	val = __builtin_bswap64(val);
+	memcpy(data, &val, sizeof(val));
+#elif defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	memcpy(data, &val, sizeof(val));
+#else
+	uint8_t *p = (uint8_t*)data;
+	int i;
+	for (i = 7; i >= 0; --i) {
+		p[i] = (uint8_t)val;
+		val >>= 8;
+	}
+#endif
+}
+
+// first byte with length class bits set, byte_cnt <= 4 only
+static uint8_t uint_data_head(uint8_t head, int byte_cnt)
+{
+	uint8_t mask = 0xf0 << (4 - byte_cnt);
+	head = head & ~mask;
+	mask <<= 1;
+	return head | mask;
+}
+
 static void pack_uint_data_helper(ccpcp_pack_context* pack_context, uint64_t num, int bit_len)
 {
 	int byte_cnt = bytes_needed(bit_len);
+	if(byte_cnt <= 9 && pack_context->err_no == CCPCP_RC_OK && pack_context->end - pack_context->current >= 9) {
+		// fast path, whole number is written by single store, bytes behind it are overwritten later
+		// 10 bytes long INT64_MIN is packed by the slow path
+		uint8_t *dst = (uint8_t*)pack_context->current;
+		if(byte_cnt > 8) {
+			dst[0] = 0xf0 | (byte_cnt - 5);
+			store_be64(dst + 1, num);
+		}
+		else {
+			uint64_t data = num << (8 * (8 - byte_cnt));
+			uint8_t head = (uint8_t)(data >> 56);
+			head = (bit_len <= 28)? uint_data_head(head, byte_cnt): (uint8_t)(0xf0 | (byte_cnt - 5));
+			data = (data & (((uint64_t)1 << 56) - 1)) | ((uint64_t)head << 56);
+			store_be64(dst, data);
+		}
+		pack_context->current += byte_cnt;
+		return;
+	}
 	uint8_t bytes[byte_cnt];
 	int i;
 	for (i = byte_cnt-1; i >= 0; --i) {
@@ -175,10 +237,7 @@ static void pack_uint_data_helper(ccpcp_pack_context* pack_context, uint64_t num
 
 	uint8_t *head = bytes;
 	if(bit_len <= 28) {
-		uint8_t mask = 0xf0 << (4 - byte_cnt);
-		*head = *head & ~mask;
-		mask <<= 1;
-		*head = *head | mask;
+		*head = uint_data_head(*head, byte_cnt);
 	}
 	else {
 		*head = 0xf0 | (byte_cnt - 5);
@@ -233,17 +292,21 @@ static int expand_bit_len(int bit_len)
 	return ret;
 }
 
-static void cchainpack_pack_int_data(ccpcp_pack_context* pack_context, int64_t snum)
+void cchainpack_pack_int_data(ccpcp_pack_context* pack_context, int64_t snum)
 {
-	uint64_t num = snum < 0? -snum: snum;
+	uint64_t num = snum < 0? 0 - (uint64_t)snum: (uint64_t)snum;
 	bool neg = (snum < 0);
 
 	int bitlen = significant_bits_part_length(num);
 	bitlen++; // add sign bit
 	if(neg) {
 		int sign_pos = expand_bit_len(bitlen);
-		uint64_t sign_bit_mask = (uint64_t)1 << sign_pos;
-		num |= sign_bit_mask;
+		// INT64_MIN sign bit is out of 64 bits, leading data byte is 0 and
+		// 0x8000000000000000 magnitude is read back as INT64_MIN
+		if(sign_pos < 64) {
+			uint64_t sign_bit_mask = (uint64_t)1 << sign_pos;
+			num |= sign_bit_mask;
+		}
 	}
 	pack_uint_data_helper(pack_context, num, bitlen);
 }
@@ -301,36 +364,41 @@ void cchainpack_pack_exponential_nan(ccpcp_pack_context *pack_context, bool is_q
 	ccpcp_pack_copy_byte(pack_context, CP_TERM);
 }
 */
+static bool is_little_endian(void)
+{
+	int n = 1;
+	return *(char *)&n == 1;
+}
+
 void cchainpack_pack_double(ccpcp_pack_context* pack_context, double d)
 {
 	if (pack_context->err_no)
 		return;
 
 	ccpcp_pack_copy_byte(pack_context, CP_Double);
+	cchainpack_pack_double_data(pack_context, &d, 1);
+}
 
-	const uint8_t*bytes = (const uint8_t*)&d;
-	int len = sizeof(double);
+void cchainpack_pack_double_data(ccpcp_pack_context* pack_context, const double *values, size_t count)
+{
+	if (pack_context->err_no)
+		return;
 
-	int n = 1;
-	int i;
-	if(*(char *)&n == 1) {
-		// little endian if true
-		for (i=0; i<len; i++)
-			ccpcp_pack_copy_byte(pack_context, bytes[i]);
+	if(is_little_endian()) {
+		ccpcp_pack_copy_bytes(pack_context, values, count * sizeof(double));
+		return;
 	}
-	else {
-		for (i=len-1; i>=0; i--)
+	size_t j;
+	for (j = 0; j < count; j++) {
+		const uint8_t*bytes = (const uint8_t*)&values[j];
+		int i;
+		for (i=sizeof(double)-1; i>=0; i--)
 			ccpcp_pack_copy_byte(pack_context, bytes[i]);
 	}
 }
 
-void cchainpack_pack_date_time(ccpcp_pack_context *pack_context, int64_t epoch_msecs, int min_from_utc)
+static int64_t date_time_data(int64_t epoch_msecs, int min_from_utc)
 {
-	if (pack_context->err_no)
-		return;
-
-	ccpcp_pack_copy_byte(pack_context, CP_DateTime);
-
 	int64_t msecs = epoch_msecs - SHV_EPOCH_MSEC;
 	int offset = (min_from_utc / 15) & 0x7F;
 	int ms = msecs % 1000;
@@ -345,7 +413,16 @@ void cchainpack_pack_date_time(ccpcp_pack_context *pack_context, int64_t epoch_m
 		msecs |= 1;
 	if(ms == 0)
 		msecs |= 2;
-	cchainpack_pack_int_data(pack_context, msecs);
+	return msecs;
+}
+
+void cchainpack_pack_date_time(ccpcp_pack_context *pack_context, int64_t epoch_msecs, int min_from_utc)
+{
+	if (pack_context->err_no)
+		return;
+
+	ccpcp_pack_copy_byte(pack_context, CP_DateTime);
+	cchainpack_pack_int_data(pack_context, date_time_data(epoch_msecs, min_from_utc));
 }
 
 void cchainpack_pack_null(ccpcp_pack_context* pack_context)
@@ -460,8 +537,55 @@ void cchainpack_pack_cstring_finish (ccpcp_pack_context* pack_context)
 	ccpcp_pack_copy_byte(pack_context, '\0');
 }
 
+//============================   P A C K E D   S I Z E   ======================
+
+size_t cchainpack_uint_data_packed_size(uint64_t num)
+{
+	return bytes_needed(significant_bits_part_length(num));
+}
+
+size_t cchainpack_int_data_packed_size(int64_t snum)
+{
+	uint64_t num = snum < 0? 0 - (uint64_t)snum: (uint64_t)snum;
+	return bytes_needed(significant_bits_part_length(num) + 1);
+}
+
+size_t cchainpack_uint_packed_size(uint64_t i)
+{
+	if(i < 64)
+		return 1;
+	return 1 + cchainpack_uint_data_packed_size(i);
+}
+
+size_t cchainpack_int_packed_size(int64_t i)
+{
+	if(i >= 0 && i < 64)
+		return 1;
+	return 1 + cchainpack_int_data_packed_size(i);
+}
+
+size_t cchainpack_decimal_packed_size(int64_t i, int exponent)
+{
+	return 1 + cchainpack_int_data_packed_size(i) + cchainpack_int_data_packed_size(exponent);
+}
+
+size_t cchainpack_date_time_packed_size(int64_t epoch_msecs, int min_from_utc)
+{
+	return 1 + cchainpack_int_data_packed_size(date_time_data(epoch_msecs, min_from_utc));
+}
+
+size_t cchainpack_string_packed_size(size_t string_len)
+{
+	return 1 + cchainpack_uint_data_packed_size(string_len) + string_len;
+}
+
 //============================   U N P A C K   =================================
 
+/// data bytes following the first byte and value bit length for UInt length classes
+/// indexed by first byte high nibble, 0xF class has data bytes count in low nibble
+static const uint8_t uint_data_bytes[16] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 3, 0};
+static const uint8_t uint_data_bitlen[16] = {7, 7, 7, 7, 7, 7, 7, 7, 14, 14, 14, 14, 21, 21, 28, 0};
+
 /// @pbitlen is used to enable same function usage for signed int unpacking
 static void unpack_uint(ccpcp_unpack_context* unpack_context, uint64_t *pval, int *pbitlen)
 {
@@ -469,6 +593,36 @@ static void unpack_uint(ccpcp_unpack_context* unpack_context, uint64_t *pval, in
 	int bitlen = 0;
 
 	const char *p;
+	if(unpack_context->end - unpack_context->current >= 9) {
+		// fast path, whole number is read by single load
+		const uint8_t head = (uint8_t)*unpack_context->current;
+		const unsigned cls = head >> 4;
+		if(cls < 0xf) {
+			const int data_cnt = uint_data_bytes[cls];
+			const uint64_t data = load_be64(unpack_context->current);
+			const int shift = 64 - 8 * (data_cnt + 1);
+			bitlen = uint_data_bitlen[cls];
+			num = (data >> shift) & (((uint64_t)1 << bitlen) - 1);
+			unpack_context->current += data_cnt + 1;
+		}
+		else if((head & 0xf) <= 4) {
+			const int data_cnt = (head & 0xf) + 4;
+			bitlen = data_cnt * 8;
+			num = load_be64(unpack_context->current + 1);
+			if(data_cnt < 8)
+				num >>= 64 - bitlen;
+			unpack_context->current += data_cnt + 1;
+		}
+		else {
+			goto slow_path;
+		}
+		if(pval)
+			*pval = num;
+		if(pbitlen)
+			*pbitlen = bitlen;
+		return;
+	}
+slow_path:
 	UNPACK_TAKE_BYTE();
 	uint8_t head = *p;
 
@@ -500,7 +654,11 @@ static void unpack_int(ccpcp_unpack_context* unpack_context, int64_t *pval)
 	int bitlen;
 	uint64_t num;
 	unpack_uint(unpack_context, &num, &bitlen);
-	if(unpack_context->err_no == CCPCP_RC_OK) {
+	if(unpack_context->err_no == CCPCP_RC_OK && bitlen > 64) {
+		// 9 data bytes, INT64_MIN only, sign bit does not fit to 64 bits
+		snum = (int64_t)num;
+	}
+	else if(unpack_context->err_no == CCPCP_RC_OK) {
 		uint64_t sign_bit_mask = (uint64_t)1 << (bitlen - 1);
 		bool neg = num & sign_bit_mask;
 		snum = (int64_t)num;
@@ -548,12 +706,32 @@ void unpack_string(ccpcp_unpack_context* unpack_context)
 			}
 		}
 	}
+	else if(it->size_to_load > 0 && unpack_context->end - unpack_context->current >= it->size_to_load) {
+		// rest of string is contiguous in buffer, return it in place as single chunk
+		it->chunk_start = (char*)unpack_context->current;
+		it->chunk_size = (size_t)it->size_to_load;
+		unpack_context->current += it->size_to_load;
+		it->size_to_load = 0;
+		it->last_chunk = 1;
+	}
 	else {
+		it->chunk_start = unpack_context->string_chunk_buff;
 		it->chunk_size = 0;
 		while(it->size_to_load > 0 && it->chunk_size < it->chunk_buff_len) {
-			UNPACK_TAKE_BYTE();
-			(it->chunk_start)[it->chunk_size++] = *p;
-			it->size_to_load--;
+			// copy buffered part at once
+			size_t n = (size_t)(unpack_context->end - unpack_context->current);
+			if(n == 0) {
+				UNPACK_PEEK_BYTE();
+				n = (size_t)(unpack_context->end - unpack_context->current);
+			}
+			if(n > it->chunk_buff_len - it->chunk_size)
+				n = it->chunk_buff_len - it->chunk_size;
+			if(n > (size_t)it->size_to_load)
+				n = (size_t)it->size_to_load;
+			memcpy(it->chunk_start + it->chunk_size, unpack_context->current, n);
+			unpack_context->current += n;
+			it->chunk_size += n;
+			it->size_to_load -= (long)n;
 		}
 		it->last_chunk = (it->size_to_load == 0);
 	}
@@ -628,24 +806,7 @@ void cchainpack_unpack_next (ccpcp_unpack_context* unpack_context)
 		}
 		case CP_Double: {
 			unpack_context->item.type = CCPCP_ITEM_DOUBLE;
-			uint8_t*bytes = (uint8_t*)&(unpack_context->item.as.Double);
-			int len = sizeof(double);
-
-			int n = 1;
-			int i;
-			if(*(char *)&n == 1) {
-				// little endian if true
-				for (i=0; i<len; i++) {
-					UNPACK_TAKE_BYTE();
-					bytes[i] = *p;
-				}
-			}
-			else {
-				for (i=len-1; i>=0; i--) {
-					UNPACK_TAKE_BYTE();
-					bytes[i] = *p;
-				}
-			}
+			cchainpack_unpack_double_data(unpack_context, &(unpack_context->item.as.Double), 1);
 			break;
 		}
 		case CP_Decimal: {
@@ -706,6 +867,7 @@ void cchainpack_unpack_next (ccpcp_unpack_context* unpack_context)
 			ccpcp_unpack_context_pop_container_state(unpack_context);
 			break;
 		}
+		case CP_Blob_depr: // same layout as String, C API does not distinguish them
 		case CP_String: {
 			unpack_context->item.type = CCPCP_ITEM_STRING;
 			ccpcp_string *it = &unpack_context->item.as.String;
@@ -736,9 +898,47 @@ void cchainpack_unpack_next (ccpcp_unpack_context* unpack_context)
 
 uint64_t cchainpack_unpack_uint_data(ccpcp_unpack_context *unpack_context, bool *ok)
 {
-	uint64_t n;
+	uint64_t n = 0;
 	unpack_uint(unpack_context, &n, NULL);
 	if(ok)
 		*ok = (unpack_context->err_no == CCPCP_RC_OK);
 	return n;
 }
+
+int64_t cchainpack_unpack_int_data(ccpcp_unpack_context *unpack_context, bool *ok)
+{
+	int64_t n = 0;
+	unpack_int(unpack_context, &n);
+	if(ok)
+		*ok = (unpack_context->err_no == CCPCP_RC_OK);
+	return n;
+}
+
+void cchainpack_unpack_double_data(ccpcp_unpack_context *unpack_context, double *values, size_t count)
+{
+	size_t len = count * sizeof(double);
+	if(is_little_endian() && (size_t)(unpack_context->end - unpack_context->current) >= len) {
+		// whole array is in the buffer
+		memcpy(values, unpack_context->current, len);
+		unpack_context->current += len;
+		return;
+	}
+	const char *p;
+	size_t j;
+	for (j = 0; j < count; j++) {
+		uint8_t*bytes = (uint8_t*)&values[j];
+		int i;
+		if(is_little_endian()) {
+			for (i=0; i<(int)sizeof(double); i++) {
+				UNPACK_TAKE_BYTE();
+				bytes[i] = *p;
+			}
+		}
+		else {
+			for (i=sizeof(double)-1; i>=0; i--) {
+				UNPACK_TAKE_BYTE();
+				bytes[i] = *p;
+			}
+		}
+	}
+}
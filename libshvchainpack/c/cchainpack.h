@@ -39,6 +39,8 @@ typedef enum {
 const char* cchainpack_packing_schema_name(int sch);
 
 void cchainpack_pack_uint_data(ccpcp_pack_context* pack_context, uint64_t num);
+void cchainpack_pack_int_data(ccpcp_pack_context* pack_context, int64_t snum);
+void cchainpack_pack_double_data(ccpcp_pack_context* pack_context, const double *values, size_t count);
 
 void cchainpack_pack_null (ccpcp_pack_context* pack_context);
 void cchainpack_pack_boolean (ccpcp_pack_context* pack_context, bool b);
@@ -67,7 +69,19 @@ void cchainpack_pack_meta_begin (ccpcp_pack_context* pack_context);
 
 void cchainpack_pack_container_end(ccpcp_pack_context* pack_context);
 
+/// number of bytes produced by corresponding cchainpack_pack_xxx() function
+size_t cchainpack_uint_data_packed_size(uint64_t num);
+size_t cchainpack_int_data_packed_size(int64_t num);
+size_t cchainpack_uint_packed_size(uint64_t i);
+size_t cchainpack_int_packed_size(int64_t i);
+size_t cchainpack_decimal_packed_size(int64_t i, int exponent);
+size_t cchainpack_date_time_packed_size(int64_t epoch_msecs, int min_from_utc);
+size_t cchainpack_string_packed_size(size_t string_len);
+
 uint64_t cchainpack_unpack_uint_data(ccpcp_unpack_context *unpack_context, bool *ok);
+int64_t cchainpack_unpack_int_data(ccpcp_unpack_context *unpack_context, bool *ok);
+/// check unpack_context->err_no for success
+void cchainpack_unpack_double_data(ccpcp_unpack_context *unpack_context, double *values, size_t count);
 void cchainpack_unpack_next (ccpcp_unpack_context* unpack_context);
 
 #ifdef __cplusplus
@@ -13,6 +13,7 @@
 
 #include "ccpcp.h"
 
+#include <stdlib.h>
 #include <string.h>
 
 
@@ -138,8 +139,8 @@ ccpcp_container_state *ccpcp_unpack_context_push_container_state(ccpcp_unpack_co
 		//self->err_no = CCPCP_RC_CONTAINER_STACK_OVERFLOW;
 		return NULL;
 	}
-	if(self->container_stack->length == self->container_stack->capacity) {
-		if(self->container_stack->overflow_handler) {
+	if(self->container_stack->length + 1 >= self->container_stack->capacity) {
+		if(!self->container_stack->overflow_handler) {
 			self->err_no = CCPCP_RC_CONTAINER_STACK_OVERFLOW;
 			return NULL;
 		}
@@ -321,11 +322,6 @@ double ccpcp_exponentional_to_double(int64_t const mantisa, const int exponent,
 	return d;
 }
 
-double ccpcp_decimal_to_double(const int64_t mantisa, const int exponent)
-{
-	return ccpcp_exponentional_to_double(mantisa, exponent, 10);
-}
-
 static int int_to_str(char *buff, size_t buff_len, int64_t val)
 {
 	int n = 0;
@@ -362,6 +358,210 @@ static int int_to_str(char *buff, size_t buff_len, int64_t val)
 	return n;
 }
 
+static const double exact_pow10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+/// 128 bit truncated 5^q normalized to the highest bit set, q = -40 ... 40
+#define POW5_128_MIN_EXP -40
+#define POW5_128_MAX_EXP 40
+static const uint64_t pow5_128[][2] = {
+	{0x8B61313BBABCE2C6ULL, 0x2323AC4B3B3DA015ULL}, // 5^-40
+	{0xAE397D8AA96C1B77ULL, 0xABEC975E0A0D081AULL}, // 5^-39
+	{0xD9C7DCED53C72255ULL, 0x96E7BD358C904A21ULL}, // 5^-38
+	{0x881CEA14545C7575ULL, 0x7E50D64177DA2E54ULL}, // 5^-37
+	{0xAA242499697392D2ULL, 0xDDE50BD1D5D0B9E9ULL}, // 5^-36
+	{0xD4AD2DBFC3D07787ULL, 0x955E4EC64B44E864ULL}, // 5^-35
+	{0x84EC3C97DA624AB4ULL, 0xBD5AF13BEF0B113EULL}, // 5^-34
+	{0xA6274BBDD0FADD61ULL, 0xECB1AD8AEACDD58EULL}, // 5^-33
+	{0xCFB11EAD453994BAULL, 0x67DE18EDA5814AF2ULL}, // 5^-32
+	{0x81CEB32C4B43FCF4ULL, 0x80EACF948770CED7ULL}, // 5^-31
+	{0xA2425FF75E14FC31ULL, 0xA1258379A94D028DULL}, // 5^-30
+	{0xCAD2F7F5359A3B3EULL, 0x096EE45813A04330ULL}, // 5^-29
+	{0xFD87B5F28300CA0DULL, 0x8BCA9D6E188853FCULL}, // 5^-28
+	{0x9E74D1B791E07E48ULL, 0x775EA264CF55347EULL}, // 5^-27
+	{0xC612062576589DDAULL, 0x95364AFE032A819EULL}, // 5^-26
+	{0xF79687AED3EEC551ULL, 0x3A83DDBD83F52205ULL}, // 5^-25
+	{0x9ABE14CD44753B52ULL, 0xC4926A9672793543ULL}, // 5^-24
+	{0xC16D9A0095928A27ULL, 0x75B7053C0F178294ULL}, // 5^-23
+	{0xF1C90080BAF72CB1ULL, 0x5324C68B12DD6339ULL}, // 5^-22
+	{0x971DA05074DA7BEEULL, 0xD3F6FC16EBCA5E04ULL}, // 5^-21
+	{0xBCE5086492111AEAULL, 0x88F4BB1CA6BCF585ULL}, // 5^-20
+	{0xEC1E4A7DB69561A5ULL, 0x2B31E9E3D06C32E6ULL}, // 5^-19
+	{0x9392EE8E921D5D07ULL, 0x3AFF322E62439FD0ULL}, // 5^-18
+	{0xB877AA3236A4B449ULL, 0x09BEFEB9FAD487C3ULL}, // 5^-17
+	{0xE69594BEC44DE15BULL, 0x4C2EBE687989A9B4ULL}, // 5^-16
+	{0x901D7CF73AB0ACD9ULL, 0x0F9D37014BF60A11ULL}, // 5^-15
+	{0xB424DC35095CD80FULL, 0x538484C19EF38C95ULL}, // 5^-14
+	{0xE12E13424BB40E13ULL, 0x2865A5F206B06FBAULL}, // 5^-13
+	{0x8CBCCC096F5088CBULL, 0xF93F87B7442E45D4ULL}, // 5^-12
+	{0xAFEBFF0BCB24AAFEULL, 0xF78F69A51539D749ULL}, // 5^-11
+	{0xDBE6FECEBDEDD5BEULL, 0xB573440E5A884D1CULL}, // 5^-10
+	{0x89705F4136B4A597ULL, 0x31680A88F8953031ULL}, // 5^-9
+	{0xABCC77118461CEFCULL, 0xFDC20D2B36BA7C3EULL}, // 5^-8
+	{0xD6BF94D5E57A42BCULL, 0x3D32907604691B4DULL}, // 5^-7
+	{0x8637BD05AF6C69B5ULL, 0xA63F9A49C2C1B110ULL}, // 5^-6
+	{0xA7C5AC471B478423ULL, 0x0FCF80DC33721D54ULL}, // 5^-5
+	{0xD1B71758E219652BULL, 0xD3C36113404EA4A9ULL}, // 5^-4
+	{0x83126E978D4FDF3BULL, 0x645A1CAC083126EAULL}, // 5^-3
+	{0xA3D70A3D70A3D70AULL, 0x3D70A3D70A3D70A4ULL}, // 5^-2
+	{0xCCCCCCCCCCCCCCCCULL, 0xCCCCCCCCCCCCCCCDULL}, // 5^-1
+	{0x8000000000000000ULL, 0x0000000000000000ULL}, // 5^0
+	{0xA000000000000000ULL, 0x0000000000000000ULL}, // 5^1
+	{0xC800000000000000ULL, 0x0000000000000000ULL}, // 5^2
+	{0xFA00000000000000ULL, 0x0000000000000000ULL}, // 5^3
+	{0x9C40000000000000ULL, 0x0000000000000000ULL}, // 5^4
+	{0xC350000000000000ULL, 0x0000000000000000ULL}, // 5^5
+	{0xF424000000000000ULL, 0x0000000000000000ULL}, // 5^6
+	{0x9896800000000000ULL, 0x0000000000000000ULL}, // 5^7
+	{0xBEBC200000000000ULL, 0x0000000000000000ULL}, // 5^8
+	{0xEE6B280000000000ULL, 0x0000000000000000ULL}, // 5^9
+	{0x9502F90000000000ULL, 0x0000000000000000ULL}, // 5^10
+	{0xBA43B74000000000ULL, 0x0000000000000000ULL}, // 5^11
+	{0xE8D4A51000000000ULL, 0x0000000000000000ULL}, // 5^12
+	{0x9184E72A00000000ULL, 0x0000000000000000ULL}, // 5^13
+	{0xB5E620F480000000ULL, 0x0000000000000000ULL}, // 5^14
+	{0xE35FA931A0000000ULL, 0x0000000000000000ULL}, // 5^15
+	{0x8E1BC9BF04000000ULL, 0x0000000000000000ULL}, // 5^16
+	{0xB1A2BC2EC5000000ULL, 0x0000000000000000ULL}, // 5^17
+	{0xDE0B6B3A76400000ULL, 0x0000000000000000ULL}, // 5^18
+	{0x8AC7230489E80000ULL, 0x0000000000000000ULL}, // 5^19
+	{0xAD78EBC5AC620000ULL, 0x0000000000000000ULL}, // 5^20
+	{0xD8D726B7177A8000ULL, 0x0000000000000000ULL}, // 5^21
+	{0x878678326EAC9000ULL, 0x0000000000000000ULL}, // 5^22
+	{0xA968163F0A57B400ULL, 0x0000000000000000ULL}, // 5^23
+	{0xD3C21BCECCEDA100ULL, 0x0000000000000000ULL}, // 5^24
+	{0x84595161401484A0ULL, 0x0000000000000000ULL}, // 5^25
+	{0xA56FA5B99019A5C8ULL, 0x0000000000000000ULL}, // 5^26
+	{0xCECB8F27F4200F3AULL, 0x0000000000000000ULL}, // 5^27
+	{0x813F3978F8940984ULL, 0x4000000000000000ULL}, // 5^28
+	{0xA18F07D736B90BE5ULL, 0x5000000000000000ULL}, // 5^29
+	{0xC9F2C9CD04674EDEULL, 0xA400000000000000ULL}, // 5^30
+	{0xFC6F7C4045812296ULL, 0x4D00000000000000ULL}, // 5^31
+	{0x9DC5ADA82B70B59DULL, 0xF020000000000000ULL}, // 5^32
+	{0xC5371912364CE305ULL, 0x6C28000000000000ULL}, // 5^33
+	{0xF684DF56C3E01BC6ULL, 0xC732000000000000ULL}, // 5^34
+	{0x9A130B963A6C115CULL, 0x3C7F400000000000ULL}, // 5^35
+	{0xC097CE7BC90715B3ULL, 0x4B9F100000000000ULL}, // 5^36
+	{0xF0BDC21ABB48DB20ULL, 0x1E86D40000000000ULL}, // 5^37
+	{0x96769950B50D88F4ULL, 0x1314448000000000ULL}, // 5^38
+	{0xBC143FA4E250EB31ULL, 0x17D955A000000000ULL}, // 5^39
+	{0xEB194F8E1AE525FDULL, 0x5DCFAB0800000000ULL}, // 5^40
+};
+
+typedef struct {
+	uint64_t hi;
+	uint64_t lo;
+} uint128;
+
+static uint128 mul_64x64(uint64_t x, uint64_t y)
+{
+	uint128 ret;
+#ifdef __SIZEOF_INT128__
+	const unsigned __int128 p = (unsigned __int128)x * y;
+	ret.hi = (uint64_t)(p >> 64);
+	ret.lo = (uint64_t)p;
+#else
+	const uint64_t x_lo = x & 0xFFFFFFFFu;
+	const uint64_t x_hi = x >> 32;
+	const uint64_t y_lo = y & 0xFFFFFFFFu;
+	const uint64_t y_hi = y >> 32;
+	const uint64_t p0 = x_lo * y_lo;
+	const uint64_t p1 = x_lo * y_hi;
+	const uint64_t p2 = x_hi * y_lo;
+	const uint64_t p3 = x_hi * y_hi;
+	const uint64_t mid = (p0 >> 32) + (p1 & 0xFFFFFFFFu) + (p2 & 0xFFFFFFFFu);
+	ret.hi = p3 + (p1 >> 32) + (p2 >> 32) + (mid >> 32);
+	ret.lo = (mid << 32) | (p0 & 0xFFFFFFFFu);
+#endif
+	return ret;
+}
+
+static int leading_zeros_64(uint64_t x)
+{
+#ifdef __GNUC__
+	return __builtin_clzll(x);
+#else
+	int n = 0;
+	while(!(x >> 63)) {
+		x <<= 1;
+		n++;
+	}
+	return n;
+#endif
+}
+
+/// Eisel-Lemire: correctly rounded w * 10^q from the truncated 128 bit power of five,
+/// returns false when the result cannot be decided (or it is subnormal or infinite)
+static bool eisel_lemire(uint64_t w, int q, uint64_t *bits)
+{
+	const uint64_t *pow5 = pow5_128[q - POW5_128_MIN_EXP];
+	const int lz = leading_zeros_64(w);
+	w <<= lz;
+	uint128 product = mul_64x64(w, pow5[0]);
+	if((product.hi & 0x1FF) == 0x1FF) {
+		// low bits may be affected by the truncated part of the power
+		const uint128 product2 = mul_64x64(w, pow5[1]);
+		product.lo += product2.hi;
+		if(product2.hi > product.lo)
+			product.hi++;
+		if((product.hi & 0x1FF) == 0x1FF && product.lo == UINT64_MAX)
+			return false;
+	}
+	const int upper_bit = (int)(product.hi >> 63);
+	uint64_t mantisa = product.hi >> (upper_bit + 9);
+	int power2 = (((152170 + 65536) * q) >> 16) + 63 + upper_bit - lz + 1023;
+	if(power2 <= 0)
+		return false;
+	if(product.lo <= 1 && q >= -4 && q <= 23 && (mantisa & 3) == 1) {
+		// exactly half way, round to even
+		if((mantisa << (upper_bit + 9)) == product.hi)
+			mantisa &= ~(uint64_t)1;
+	}
+	mantisa += mantisa & 1;
+	mantisa >>= 1;
+	if(mantisa >= ((uint64_t)2 << 52)) {
+		mantisa = (uint64_t)1 << 52;
+		power2++;
+	}
+	mantisa &= ~((uint64_t)1 << 52);
+	if(power2 >= 0x7FF)
+		return false;
+	*bits = mantisa | ((uint64_t)power2 << 52);
+	return true;
+}
+
+double ccpcp_decimal_to_double(const int64_t mantisa, const int exponent)
+{
+	if(mantisa == 0)
+		return 0;
+	const bool neg = mantisa < 0;
+	const uint64_t w = neg? (uint64_t)0 - (uint64_t)mantisa: (uint64_t)mantisa;
+	double d;
+	if(w <= ((uint64_t)1 << 53) && exponent >= -22 && exponent <= 22) {
+		// both w and 10^exponent are exact doubles, single rounding only
+		d = (double)w;
+		if(exponent < 0)
+			d /= exact_pow10[-exponent];
+		else
+			d *= exact_pow10[exponent];
+		return neg? -d: d;
+	}
+	uint64_t bits;
+	if(exponent >= POW5_128_MIN_EXP && exponent <= POW5_128_MAX_EXP && eisel_lemire(w, exponent, &bits)) {
+		memcpy(&d, &bits, sizeof(d));
+		return neg? -d: d;
+	}
+	// slow path, locale independent since there is no decimal point
+	char buff[32];
+	int n = int_to_str(buff, sizeof(buff), mantisa);
+	buff[n++] = 'e';
+	n += int_to_str(buff + n, sizeof(buff) - (size_t)n, exponent);
+	buff[n] = 0;
+	return strtod(buff, NULL);
+}
+
 int ccpcp_decimal_to_string(char *buff, size_t buff_len, int64_t mantisa, int exponent)
 {
 	bool neg = false;
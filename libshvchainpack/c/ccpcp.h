@@ -92,6 +92,8 @@ typedef enum
 typedef struct {
 	long string_size;
 	long size_to_load;
+	/// points to string chunk buffer or directly to unpacked data, when the string is contiguous in it,
+	/// valid until next unpack call in both cases
 	char* chunk_start;
 	size_t chunk_size;
 	size_t chunk_buff_len;
@@ -31,20 +31,23 @@ void ccpcp_convert(ccpcp_unpack_context* in_ctx, ccpcp_pack_format in_format, cc
 						is_string_concat = 1;
 					}
 				}
-				if(!is_string_concat && in_ctx->item.type != CCPCP_ITEM_CONTAINER_END) {
+				if(!is_string_concat && in_ctx->item.type != CCPCP_ITEM_CONTAINER_END && meta_just_closed) {
+					// meta and the value it belongs to are one container item,
+					// delimiter is already written in front of the meta
+					parent_state->item_count--;
+				}
+				else if(!is_string_concat && in_ctx->item.type != CCPCP_ITEM_CONTAINER_END) {
 					switch(parent_state->container_type) {
 					case CCPCP_ITEM_LIST:
 					//case CCPCP_ITEM_ARRAY:
-						if(!meta_just_closed)
-							ccpon_pack_field_delim(out_ctx, parent_state->item_count == 1);
+						ccpon_pack_field_delim(out_ctx, parent_state->item_count == 1);
 						break;
 					case CCPCP_ITEM_MAP:
 					case CCPCP_ITEM_IMAP:
 					case CCPCP_ITEM_META: {
 						bool is_key = (parent_state->item_count % 2);
 						if(is_key) {
-							if(!meta_just_closed)
-								ccpon_pack_field_delim(out_ctx, parent_state->item_count == 1);
+							ccpon_pack_field_delim(out_ctx, parent_state->item_count == 1);
 						}
 						else {
 							// delimite value
@@ -141,7 +144,7 @@ void ccpcp_convert(ccpcp_unpack_context* in_ctx, ccpcp_pack_format in_format, cc
 				}
 				else if(it->string_size >= 0) {
 					if(it->chunk_cnt == 1)
-						cchainpack_pack_string_start(out_ctx, it->string_size, it->chunk_start, it->string_size);
+						cchainpack_pack_string_start(out_ctx, it->string_size, it->chunk_start, it->chunk_size);
 					else
 						cchainpack_pack_string_cont(out_ctx, it->chunk_start, it->chunk_size);
 				}
@@ -281,7 +284,7 @@ static void ccpcp_convert_chainpack_to_chainpack(ccpcp_unpack_context* in_ctx, c
 			}
 			else if(it->string_size >= 0) {
 				if(it->chunk_cnt == 1)
-					cchainpack_pack_string_start(out_ctx, it->string_size, it->chunk_start, it->string_size);
+					cchainpack_pack_string_start(out_ctx, it->string_size, it->chunk_start, it->chunk_size);
 				else
 					cchainpack_pack_string_cont(out_ctx, it->chunk_start, it->chunk_size);
 			}
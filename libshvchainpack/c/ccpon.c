@@ -16,6 +16,12 @@
 //#include <stdio.h>
 #include <math.h>
 
+#if defined __AVX2__
+#include <immintrin.h>
+#elif defined __SSE2__
+#include <emmintrin.h>
+#endif
+
 #ifdef BR_PLC
 /* TODO: Add your comment here */
 void ccpon(struct ccpon* inst)
@@ -63,23 +69,6 @@ static size_t uint_to_str_lpad(char *buff, size_t buff_len, uint64_t n, size_t w
 	return len;
 }
 
-static size_t uint_dot_uint_to_str(char *buff, size_t buff_len, uint64_t n1, uint64_t n2)
-{
-	size_t len = uint_to_str(buff, buff_len, n1);
-	if(len < buff_len)
-		buff[len] = '.';
-	size_t dot_pos = len;
-	len++;
-	if(n2 > 0) {
-		len += uint_to_str(buff+len, (len < buff_len)? buff_len-len: 0, n2);
-		if(len < buff_len) {
-			// remove trailing zeros
-			for(; len>dot_pos && buff[len-1] == '0'; len--);
-		}
-	}
-	return len;
-}
-
 static size_t int_to_str(char *buff, size_t buff_len, int64_t n)
 {
 	size_t len = 0;
@@ -95,87 +84,320 @@ static size_t int_to_str(char *buff, size_t buff_len, int64_t n)
 	return len;
 }
 
-static size_t double_to_str(char *buff, size_t buff_len, double d)
+/// Grisu2 shortest round-trip double to digits conversion,
+/// see Florian Loitsch: Printing Floating-Point Numbers Quickly and Accurately with Integers.
+/// Generated digits always read back to the same double, they are the shortest ones
+/// for all but a tiny fraction of values, where one digit more is emitted.
+typedef struct {
+	uint64_t f;
+	int e;
+} diy_fp;
+
+typedef struct {
+	uint64_t f;
+	int e;
+	int k;
+} cached_power;
+
+/// normalized 10^k approximations f * 2^e, k = -348, -340, ..., 340
+static const cached_power cached_powers[] = {
+	{0xFA8FD5A0081C0288ULL, -1220, -348},
+	{0xBAAEE17FA23EBF76ULL, -1193, -340},
+	{0x8B16FB203055AC76ULL, -1166, -332},
+	{0xCF42894A5DCE35EAULL, -1140, -324},
+	{0x9A6BB0AA55653B2DULL, -1113, -316},
+	{0xE61ACF033D1A45DFULL, -1087, -308},
+	{0xAB70FE17C79AC6CAULL, -1060, -300},
+	{0xFF77B1FCBEBCDC4FULL, -1034, -292},
+	{0xBE5691EF416BD60CULL, -1007, -284},
+	{0x8DD01FAD907FFC3CULL, -980, -276},
+	{0xD3515C2831559A83ULL, -954, -268},
+	{0x9D71AC8FADA6C9B5ULL, -927, -260},
+	{0xEA9C227723EE8BCBULL, -901, -252},
+	{0xAECC49914078536DULL, -874, -244},
+	{0x823C12795DB6CE57ULL, -847, -236},
+	{0xC21094364DFB5637ULL, -821, -228},
+	{0x9096EA6F3848984FULL, -794, -220},
+	{0xD77485CB25823AC7ULL, -768, -212},
+	{0xA086CFCD97BF97F4ULL, -741, -204},
+	{0xEF340A98172AACE5ULL, -715, -196},
+	{0xB23867FB2A35B28EULL, -688, -188},
+	{0x84C8D4DFD2C63F3BULL, -661, -180},
+	{0xC5DD44271AD3CDBAULL, -635, -172},
+	{0x936B9FCEBB25C996ULL, -608, -164},
+	{0xDBAC6C247D62A584ULL, -582, -156},
+	{0xA3AB66580D5FDAF6ULL, -555, -148},
+	{0xF3E2F893DEC3F126ULL, -529, -140},
+	{0xB5B5ADA8AAFF80B8ULL, -502, -132},
+	{0x87625F056C7C4A8BULL, -475, -124},
+	{0xC9BCFF6034C13053ULL, -449, -116},
+	{0x964E858C91BA2655ULL, -422, -108},
+	{0xDFF9772470297EBDULL, -396, -100},
+	{0xA6DFBD9FB8E5B88FULL, -369, -92},
+	{0xF8A95FCF88747D94ULL, -343, -84},
+	{0xB94470938FA89BCFULL, -316, -76},
+	{0x8A08F0F8BF0F156BULL, -289, -68},
+	{0xCDB02555653131B6ULL, -263, -60},
+	{0x993FE2C6D07B7FACULL, -236, -52},
+	{0xE45C10C42A2B3B06ULL, -210, -44},
+	{0xAA242499697392D3ULL, -183, -36},
+	{0xFD87B5F28300CA0EULL, -157, -28},
+	{0xBCE5086492111AEBULL, -130, -20},
+	{0x8CBCCC096F5088CCULL, -103, -12},
+	{0xD1B71758E219652CULL, -77, -4},
+	{0x9C40000000000000ULL, -50, 4},
+	{0xE8D4A51000000000ULL, -24, 12},
+	{0xAD78EBC5AC620000ULL, 3, 20},
+	{0x813F3978F8940984ULL, 30, 28},
+	{0xC097CE7BC90715B3ULL, 56, 36},
+	{0x8F7E32CE7BEA5C70ULL, 83, 44},
+	{0xD5D238A4ABE98068ULL, 109, 52},
+	{0x9F4F2726179A2245ULL, 136, 60},
+	{0xED63A231D4C4FB27ULL, 162, 68},
+	{0xB0DE65388CC8ADA8ULL, 189, 76},
+	{0x83C7088E1AAB65DBULL, 216, 84},
+	{0xC45D1DF942711D9AULL, 242, 92},
+	{0x924D692CA61BE758ULL, 269, 100},
+	{0xDA01EE641A708DEAULL, 295, 108},
+	{0xA26DA3999AEF774AULL, 322, 116},
+	{0xF209787BB47D6B85ULL, 348, 124},
+	{0xB454E4A179DD1877ULL, 375, 132},
+	{0x865B86925B9BC5C2ULL, 402, 140},
+	{0xC83553C5C8965D3DULL, 428, 148},
+	{0x952AB45CFA97A0B3ULL, 455, 156},
+	{0xDE469FBD99A05FE3ULL, 481, 164},
+	{0xA59BC234DB398C25ULL, 508, 172},
+	{0xF6C69A72A3989F5CULL, 534, 180},
+	{0xB7DCBF5354E9BECEULL, 561, 188},
+	{0x88FCF317F22241E2ULL, 588, 196},
+	{0xCC20CE9BD35C78A5ULL, 614, 204},
+	{0x98165AF37B2153DFULL, 641, 212},
+	{0xE2A0B5DC971F303AULL, 667, 220},
+	{0xA8D9D1535CE3B396ULL, 694, 228},
+	{0xFB9B7CD9A4A7443CULL, 720, 236},
+	{0xBB764C4CA7A44410ULL, 747, 244},
+	{0x8BAB8EEFB6409C1AULL, 774, 252},
+	{0xD01FEF10A657842CULL, 800, 260},
+	{0x9B10A4E5E9913129ULL, 827, 268},
+	{0xE7109BFBA19C0C9DULL, 853, 276},
+	{0xAC2820D9623BF429ULL, 880, 284},
+	{0x80444B5E7AA7CF85ULL, 907, 292},
+	{0xBF21E44003ACDD2DULL, 933, 300},
+	{0x8E679C2F5E44FF8FULL, 960, 308},
+	{0xD433179D9C8CB841ULL, 986, 316},
+	{0x9E19DB92B4E31BA9ULL, 1013, 324},
+	{0xEB96BF6EBADF77D9ULL, 1039, 332},
+	{0xAF87023B9BF0EE6BULL, 1066, 340},
+};
+
+static const int GRISU_ALPHA = -60;
+static const int GRISU_GAMMA = -32;
+
+static diy_fp diy_fp_mul(diy_fp x, diy_fp y)
 {
-	const int prec = 6;
-	unsigned prec_num = 1;
-	int i;
-	for (i = 0; i < prec; ++i)
-		prec_num *= 10;
+	const uint64_t x_lo = x.f & 0xFFFFFFFFu;
+	const uint64_t x_hi = x.f >> 32;
+	const uint64_t y_lo = y.f & 0xFFFFFFFFu;
+	const uint64_t y_hi = y.f >> 32;
+	const uint64_t p0 = x_lo * y_lo;
+	const uint64_t p1 = x_lo * y_hi;
+	const uint64_t p2 = x_hi * y_lo;
+	const uint64_t p3 = x_hi * y_hi;
+	uint64_t q = (p0 >> 32) + (p1 & 0xFFFFFFFFu) + (p2 & 0xFFFFFFFFu);
+	q += (uint64_t)1 << 31; // round
+	diy_fp ret;
+	ret.f = p3 + (p1 >> 32) + (p2 >> 32) + (q >> 32);
+	ret.e = x.e + y.e + 64;
+	return ret;
+}
+
+static diy_fp diy_fp_normalize(diy_fp x)
+{
+#ifdef __GNUC__
+	const int lz = __builtin_clzll(x.f);
+	x.f <<= lz;
+	x.e -= lz;
+#else
+	while(!(x.f >> 63)) {
+		x.f <<= 1;
+		x.e--;
+	}
+#endif
+	return x;
+}
+
+static unsigned find_largest_pow10(uint32_t n, uint32_t *pow10)
+{
+	static const uint32_t pow10s[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+	unsigned i = 9;
+	while(i > 0 && n < pow10s[i])
+		i--;
+	*pow10 = pow10s[i];
+	return i + 1;
+}
+
+static void grisu_round(char *digits, size_t len, uint64_t dist, uint64_t delta, uint64_t rest, uint64_t ten_k)
+{
+	// move last digit towards w while it stays in the rounding interval
+	while(rest < dist && delta - rest >= ten_k
+		  && (rest + ten_k < dist || dist - rest > rest + ten_k - dist)) {
+		digits[len - 1]--;
+		rest += ten_k;
+	}
+}
 
+/// generates shortest digits of positive finite d, d == digits * 10^(*dec_exp)
+static size_t grisu2(char *digits, int *dec_exp, double d)
+{
+	uint64_t bits;
+	memcpy(&bits, &d, sizeof(bits));
+	const uint64_t hidden_bit = (uint64_t)1 << 52;
+	const uint64_t bits_f = bits & (hidden_bit - 1);
+	const int bits_e = (int)(bits >> 52);
+	diy_fp v;
+	if(bits_e == 0) {
+		v.f = bits_f;
+		v.e = 1 - 1075;
+	}
+	else {
+		v.f = bits_f + hidden_bit;
+		v.e = bits_e - 1075;
+	}
+	// rounding interval boundaries, lower one is closer for powers of 2
+	diy_fp m_plus = {(v.f << 1) + 1, v.e - 1};
+	diy_fp m_minus;
+	if(bits_f == 0 && bits_e > 1) {
+		m_minus.f = (v.f << 2) - 1;
+		m_minus.e = v.e - 2;
+	}
+	else {
+		m_minus.f = (v.f << 1) - 1;
+		m_minus.e = v.e - 1;
+	}
+	m_plus = diy_fp_normalize(m_plus);
+	m_minus.f <<= m_minus.e - m_plus.e;
+	m_minus.e = m_plus.e;
+	v = diy_fp_normalize(v);
+
+	// cached power c, which brings scaled m_plus exponent to [alpha, gamma]
+	int ix = (int)(((GRISU_ALPHA - m_plus.e - 1) * 78913L >> 18) + 348 + 7) / 8;
+	if(ix < 0)
+		ix = 0;
+	const int cnt = (int)(sizeof(cached_powers) / sizeof(cached_powers[0]));
+	if(ix >= cnt)
+		ix = cnt - 1;
+	while(ix > 0 && cached_powers[ix].e + m_plus.e + 64 > GRISU_GAMMA)
+		ix--;
+	while(ix < cnt - 1 && cached_powers[ix].e + m_plus.e + 64 < GRISU_ALPHA)
+		ix++;
+	const diy_fp c = {cached_powers[ix].f, cached_powers[ix].e};
+
+	const diy_fp w = diy_fp_mul(v, c);
+	diy_fp w_minus = diy_fp_mul(m_minus, c);
+	diy_fp w_plus = diy_fp_mul(m_plus, c);
+	// shrink the interval by 1 ulp to stay safe with multiplication errors
+	w_minus.f++;
+	w_plus.f--;
+	*dec_exp = -cached_powers[ix].k;
+
+	uint64_t delta = w_plus.f - w_minus.f;
+	uint64_t dist = w_plus.f - w.f;
+	const int shift = -w_plus.e;
+	const uint64_t one = (uint64_t)1 << shift;
+	uint32_t p1 = (uint32_t)(w_plus.f >> shift);
+	uint64_t p2 = w_plus.f & (one - 1);
+	size_t len = 0;
+
+	uint32_t pow10;
+	unsigned n = find_largest_pow10(p1, &pow10);
+	while(n > 0) {
+		digits[len++] = (char)('0' + p1 / pow10);
+		p1 %= pow10;
+		n--;
+		const uint64_t rest = ((uint64_t)p1 << shift) + p2;
+		if(rest <= delta) {
+			*dec_exp += (int)n;
+			grisu_round(digits, len, dist, delta, rest, (uint64_t)pow10 << shift);
+			return len;
+		}
+		pow10 /= 10;
+	}
+	int m = 0;
+	for(;;) {
+		p2 *= 10;
+		digits[len++] = (char)('0' + (p2 >> shift));
+		p2 &= one - 1;
+		m++;
+		delta *= 10;
+		dist *= 10;
+		if(p2 <= delta)
+			break;
+	}
+	*dec_exp -= m;
+	grisu_round(digits, len, dist, delta, p2, one);
+	return len;
+}
+
+/// shortest Cpon representation which reads back to the same value,
+/// fixed notation for 0.1 <= |d| < 1e7, exponential otherwise
+static size_t double_to_str(char *buff, size_t buff_len, double d)
+{
+	char digits[20];
+	char str[32];
 	size_t len = 0;
 	if(d == 0) {
-		if(len < buff_len)
-			buff[len] = '0';
-		len++;
-		if(len < buff_len)
-			buff[len] = '.';
-		len++;
+		str[len++] = '0';
+		str[len++] = '.';
 	}
 	else {
-		bool neg = d < 0;
-		if(neg) {
-			if(len < buff_len)
-				buff[len] = '-';
-			len++;
+		if(d < 0) {
+			str[len++] = '-';
 			d = -d;
 		}
+		int dec_exp;
+		const size_t n = grisu2(digits, &dec_exp, d);
+		// digits before decimal point
+		const int dp = (int)n + dec_exp;
+		size_t i;
 		if(d < 1e7 && d >= 0.1) {
 			/// float point notation
-			if(d < 1) {
-				for ( i = 0; i < prec; ++i)
-					d *= 10;
-				unsigned ud = (unsigned)d;
-				len += uint_dot_uint_to_str(buff + len, (len < buff_len)? buff_len-len: 0, 0, ud);
+			if(dp <= 0) {
+				str[len++] = '0';
+				str[len++] = '.';
+				for (i = 0; i < (size_t)-dp; ++i)
+					str[len++] = '0';
+				memcpy(str + len, digits, n);
+				len += n;
+			}
+			else if((size_t)dp >= n) {
+				memcpy(str + len, digits, n);
+				len += n;
+				for (i = n; i < (size_t)dp; ++i)
+					str[len++] = '0';
+				str[len++] = '.';
 			}
 			else {
-				int exp = 0;
-				double myprec = 1;
-				while(d >= 10) {
-					d /= 10;
-					myprec /= 10;
-					exp++;
-				}
-				for ( i = 0; i < prec; ++i) {
-					d *= 10;
-					myprec *= 10;
-				}
-				unsigned ud = (unsigned)d;
-				unsigned myprecnum = (unsigned)myprec;
-				len += uint_dot_uint_to_str(buff + len, (len < buff_len)? buff_len-len: 0, ud/myprecnum, ud%myprecnum);
+				memcpy(str + len, digits, (size_t)dp);
+				len += (size_t)dp;
+				str[len++] = '.';
+				memcpy(str + len, digits + dp, n - (size_t)dp);
+				len += n - (size_t)dp;
 			}
 		}
 		else {
 			/// exponential notation
-			int exp = 0;
-			if(d < 1) {
-				while(d < 1) {
-					d *= 10;
-					exp--;
-				}
-				for ( i = 0; i < prec; ++i)
-					d *= 10;
-				unsigned ud = (unsigned)d;
-				len += uint_dot_uint_to_str(buff + len, (len < buff_len)? buff_len-len: 0, ud/prec_num, ud%prec_num);
+			str[len++] = digits[0];
+			if(n > 1) {
+				str[len++] = '.';
+				memcpy(str + len, digits + 1, n - 1);
+				len += n - 1;
 			}
-			else {
-				while(d >= 10) {
-					d /= 10;
-					exp++;
-				}
-				for ( i = 0; i < prec; ++i)
-					d *= 10;
-				unsigned ud = (unsigned)d;
-				len += uint_dot_uint_to_str(buff + len, (len < buff_len)? buff_len-len: 0, ud/prec_num, ud%prec_num);
-			}
-			if(len < buff_len && buff[len-1] == '.') // remove trailing dot
-				len--;
-			if(len < buff_len)
-				buff[len] = 'e';
-			len++;
-			len += int_to_str(buff + len, (len < buff_len)? buff_len-len: 0, exp);
+			str[len++] = 'e';
+			len += int_to_str(str + len, sizeof(str) - len, dp - 1);
 		}
 	}
+	if(len <= buff_len)
+		memcpy(buff, str, len);
 	return len;
 }
 
@@ -441,71 +663,114 @@ void ccpon_pack_date_time(ccpcp_pack_context *pack_context, int64_t epoch_msecs,
 	ccpcp_pack_copy_bytes(pack_context, "\"", 1);
 }
 
-void ccpon_pack_date_time_str(ccpcp_pack_context *pack_context, int64_t epoch_msecs, int min_from_utc, ccpon_msec_policy msec_policy, bool with_tz)
+#if defined __GNUC__
+#define CCPON_THREAD_LOCAL __thread
+#elif defined _MSC_VER
+#define CCPON_THREAD_LOCAL __declspec(thread)
+#elif defined __STDC_VERSION__ && __STDC_VERSION__ >= 201112L && !defined __STDC_NO_THREADS__
+#define CCPON_THREAD_LOCAL _Thread_local
+#endif
+
+static void write_2_digits(char *str, unsigned n)
+{
+	str[0] = (char)('0' + n / 10);
+	str[1] = (char)('0' + n % 10);
+}
+
+/// "YYYY-MM-DDTHH:MM:SS" of epoch_sec in local time
+static size_t format_date_time_sec(char *str, size_t buff_len, int64_t epoch_sec)
 {
 	struct tm tm;
-	ccpon_gmtime(epoch_msecs / 1000 + min_from_utc * 60, &tm);
-	static const unsigned LEN = 32;
+	ccpon_gmtime(epoch_sec, &tm);
+	const int year = tm.tm_year + 1900;
+	size_t len;
+	if(year >= 1000 && year <= 9999) {
+		write_2_digits(str, (unsigned)year / 100);
+		write_2_digits(str + 2, (unsigned)year % 100);
+		len = 4;
+	}
+	else {
+		len = uint_to_str_lpad(str, buff_len, (unsigned)year, 2, '0');
+	}
+	if(len + 15 > buff_len)
+		return buff_len;
+	str[len] = '-';
+	write_2_digits(str + len + 1, (unsigned)tm.tm_mon + 1);
+	str[len + 3] = '-';
+	write_2_digits(str + len + 4, (unsigned)tm.tm_mday);
+	str[len + 6] = 'T';
+	write_2_digits(str + len + 7, (unsigned)tm.tm_hour);
+	str[len + 9] = ':';
+	write_2_digits(str + len + 10, (unsigned)tm.tm_min);
+	str[len + 12] = ':';
+	write_2_digits(str + len + 13, (unsigned)tm.tm_sec);
+	return len + 15;
+}
+
+#ifdef CCPON_THREAD_LOCAL
+/// consecutive date times usually share the second, its formatted form is reused then
+typedef struct {
+	bool valid;
+	int64_t epoch_sec;
+	size_t len;
+	char str[32];
+} date_time_str_cache;
+
+static CCPON_THREAD_LOCAL date_time_str_cache s_dateTimeStrCache;
+#endif
+
+void ccpon_pack_date_time_str(ccpcp_pack_context *pack_context, int64_t epoch_msecs, int min_from_utc, ccpon_msec_policy msec_policy, bool with_tz)
+{
+	static const unsigned LEN = 48;
 	char str[LEN];
-	//int n = snprintf(str, LEN, "%04d-%02d-%02dT%02d:%02d:%02d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
-	size_t len = uint_to_str_lpad(str, LEN, (unsigned)tm.tm_year + 1900, 2, '0');
-	if(len < LEN)
-		str[len] = '-';
-	len++;
-	len += uint_to_str_lpad(str + len, (len < LEN)? LEN - len: 0, (unsigned)tm.tm_mon + 1, 2, '0');
-	if(len < LEN)
-		str[len] = '-';
-	len++;
-	len += uint_to_str_lpad(str + len, (len < LEN)? LEN - len: 0, (unsigned)tm.tm_mday, 2, '0');
-	if(len < LEN)
-		str[len] = 'T';
-	len++;
-	len += uint_to_str_lpad(str + len, (len < LEN)? LEN - len: 0, (unsigned)tm.tm_hour, 2, '0');
-	if(len < LEN)
-		str[len] = ':';
-	len++;
-	len += uint_to_str_lpad(str + len, (len < LEN)? LEN - len: 0, (unsigned)tm.tm_min, 2, '0');
-	if(len < LEN)
-		str[len] = ':';
-	len++;
-	len += uint_to_str_lpad(str + len, (len < LEN)? LEN - len: 0, (unsigned)tm.tm_sec, 2, '0');
-	if(len < LEN)
-		ccpcp_pack_copy_bytes(pack_context, str, len);
+	size_t len;
+	const int64_t epoch_sec = epoch_msecs / 1000 + min_from_utc * 60;
+#ifdef CCPON_THREAD_LOCAL
+	date_time_str_cache *cache = &s_dateTimeStrCache;
+	if(!cache->valid || cache->epoch_sec != epoch_sec) {
+		cache->len = format_date_time_sec(cache->str, sizeof(cache->str), epoch_sec);
+		cache->epoch_sec = epoch_sec;
+		cache->valid = true;
+	}
+	len = cache->len;
+	memcpy(str, cache->str, len);
+#else
+	len = format_date_time_sec(str, LEN, epoch_sec);
+#endif
 	int msec = epoch_msecs % 1000;
 	if((msec > 0 && msec_policy == CCPON_Auto) || msec_policy == CCPON_Always) {
-		ccpcp_pack_copy_bytes(pack_context, ".", 1);
-		len = 0;
-		len = uint_to_str_lpad(str, LEN, (unsigned)msec, 3, '0');
-		if(len < LEN)
-			ccpcp_pack_copy_bytes(pack_context, str, len);
+		str[len++] = '.';
+		if(msec >= 0) {
+			str[len] = (char)('0' + msec / 100);
+			write_2_digits(str + len + 1, (unsigned)msec % 100);
+			len += 3;
+		}
+		else {
+			len += uint_to_str_lpad(str + len, LEN - len, (unsigned)msec, 3, '0');
+		}
 	}
-	if(with_tz) {
+	if(with_tz && len < LEN) {
 		if(min_from_utc == 0) {
-			ccpcp_pack_copy_bytes(pack_context, "Z", 1);
+			str[len++] = 'Z';
 		}
 		else {
 			if(min_from_utc < 0) {
-				ccpcp_pack_copy_bytes(pack_context, "-", 1);
+				str[len++] = '-';
 				min_from_utc = -min_from_utc;
 			}
 			else {
-				ccpcp_pack_copy_bytes(pack_context, "+", 1);
-			}
-			if(min_from_utc%60) {
-				len = 0;
-				len += uint_to_str_lpad(str + len, (len < LEN)? LEN - len: 0, (unsigned)min_from_utc/60, 2, '0');
-				len += uint_to_str_lpad(str + len, (len < LEN)? LEN - len: 0, (unsigned)min_from_utc%60, 2, '0');
-				//n = snprintf(str, LEN, "%02d%02d", min_from_utc/60, min_from_utc%60);
+				str[len++] = '+';
 			}
-			else {
-				len = 0;
-				len += uint_to_str_lpad(str + len, (len < LEN)? LEN - len: 0, (unsigned)min_from_utc/60, 2, '0');
-				//n = snprintf(str, LEN, "%02d", min_from_utc/60);
+			write_2_digits(str + len, (unsigned)min_from_utc / 60);
+			len += 2;
+			if(min_from_utc % 60) {
+				write_2_digits(str + len, (unsigned)min_from_utc % 60);
+				len += 2;
 			}
-			if(len < LEN)
-				ccpcp_pack_copy_bytes(pack_context, str, len);
 		}
 	}
+	if(len < LEN)
+		ccpcp_pack_copy_bytes(pack_context, str, len);
 }
 
 void ccpon_pack_null(ccpcp_pack_context* pack_context)
@@ -623,12 +888,120 @@ void ccpon_pack_meta_end(ccpcp_pack_context *pack_context)
 	}
 }
 
+static int is_escaped_char(uint8_t ch)
+{
+	switch(ch) {
+	case '\0':
+	case '\\':
+	case '\t':
+	case '\b':
+	case '\r':
+	case '\n':
+	case '"':
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+#if defined __AVX2__ || defined __SSE2__
+static int first_bit_index(uint32_t mask)
+{
+#ifdef __GNUC__
+	return __builtin_ctz(mask);
+#else
+	int n = 0;
+	while(!(mask & 1)) {
+		mask >>= 1;
+		n++;
+	}
+	return n;
+#endif
+}
+#endif
+
+// length of the leading part of str, which can be copied to Cpon string without escaping
+static size_t escape_free_length(const uint8_t *str, size_t len)
+{
+	size_t i = 0;
+#if defined __AVX2__
+	for(; i + 32 <= len; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i*)(str + i));
+		__m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+		// '\0', '\b', '\t', '\n', '\r' are all <= 13
+		__m256i ctl = _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(13)), v);
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(m, ctl));
+		while(mask) {
+			int n = first_bit_index(mask);
+			if(is_escaped_char(str[i + n]))
+				return i + n;
+			mask &= mask - 1;
+		}
+	}
+#elif defined __SSE2__
+	for(; i + 16 <= len; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i*)(str + i));
+		__m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+		// '\0', '\b', '\t', '\n', '\r' are all <= 13
+		__m128i ctl = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(13)), v);
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_or_si128(m, ctl));
+		while(mask) {
+			int n = first_bit_index(mask);
+			if(is_escaped_char(str[i + n]))
+				return i + n;
+			mask &= mask - 1;
+		}
+	}
+#endif
+	for(; i < len; i++) {
+		if(is_escaped_char(str[i]))
+			return i;
+	}
+	return len;
+}
+
+// length of the leading part of Cpon string data without quote and backslash
+static size_t unescape_free_length(const char *str, size_t len)
+{
+	size_t i = 0;
+#if defined __AVX2__
+	for(; i + 32 <= len; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i*)(str + i));
+		__m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(m);
+		if(mask)
+			return i + first_bit_index(mask);
+	}
+#elif defined __SSE2__
+	for(; i + 16 <= len; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i*)(str + i));
+		__m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(m);
+		if(mask)
+			return i + first_bit_index(mask);
+	}
+#endif
+	for(; i < len; i++) {
+		if(str[i] == '"' || str[i] == '\\')
+			return i;
+	}
+	return len;
+}
+
 static char* copy_data_escaped(ccpcp_pack_context* pack_context, const void* str, size_t len)
 {
 	size_t i;
 	for (i = 0; i < len; ++i) {
 		if(pack_context->err_no != CCPCP_RC_OK)
 			return NULL;
+		// copy the part without escaped chars at once
+		size_t n = escape_free_length((const uint8_t*)str + i, len - i);
+		if(n > 0) {
+			ccpcp_pack_copy_bytes(pack_context, (const uint8_t*)str + i, n);
+			i += n;
+			if(i == len)
+				break;
+		}
 		uint8_t ch = ((const uint8_t*)str)[i];
 		switch(ch) {
 		case '\0':
@@ -792,8 +1165,109 @@ eonumb:
 	return n;
 }
 
+static int64_t days_from_civil(int y, int m, int d)
+{
+	y -= m <= 2;
+	const int era = (y >= 0? y: y - 399) / 400;
+	const int yoe = y - era * 400;
+	const int doy = (153 * (m > 2? m - 3: m + 9) + 2) / 5 + d - 1;
+	const int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return (int64_t)era * 146097 + doe - 719468;
+}
+
+static int parse_digits(const char *str, int cnt)
+{
+	int ret = 0;
+	int i;
+	for (i = 0; i < cnt; ++i) {
+		const unsigned d = (unsigned)(uint8_t)str[i] - '0';
+		if(d > 9)
+			return -1;
+		ret = ret * 10 + (int)d;
+	}
+	return ret;
+}
+
+/// fixed layout YYYY-MM-DDTHH:MM:SS[.mmm][Z|+hh|+hhmm] without struct tm arithmetic,
+/// returns false without consuming anything if the data does not match it
+static bool unpack_date_time_fixed(ccpcp_unpack_context *unpack_context, struct tm *tm, int *msec, int *utc_offset)
+{
+	const char *str = unpack_context->current;
+	const size_t avail = (size_t)(unpack_context->end - str);
+	if(avail < 19)
+		return false;
+	if(str[4] != '-' || str[7] != '-' || !(str[10] == 'T' || str[10] == ' ') || str[13] != ':' || str[16] != ':')
+		return false;
+	const int year = parse_digits(str, 4);
+	const int month = parse_digits(str + 5, 2);
+	const int mday = parse_digits(str + 8, 2);
+	const int hour = parse_digits(str + 11, 2);
+	const int min = parse_digits(str + 14, 2);
+	const int sec = parse_digits(str + 17, 2);
+	if(year < 1 || month < 1 || month > 12 || mday < 1 || mday > 31 || hour < 0 || hour > 23 || min < 0 || min > 59 || sec < 0 || sec > 59)
+		return false;
+	size_t n = 19;
+	if(n < avail && str[n] >= '0' && str[n] <= '9')
+		return false;
+	int ms = 0;
+	if(n < avail && str[n] == '.') {
+		if(n + 4 > avail || (n + 4 < avail && str[n + 4] >= '0' && str[n + 4] <= '9'))
+			return false;
+		ms = parse_digits(str + n + 1, 3);
+		if(ms < 0)
+			return false;
+		n += 4;
+	}
+	int offset = 0;
+	if(n < avail) {
+		const char c = str[n];
+		if(c == 'Z') {
+			n++;
+		}
+		else if(c == '+' || c == '-') {
+			size_t cnt = 0;
+			while(n + 1 + cnt < avail && cnt < 5 && str[n + 1 + cnt] >= '0' && str[n + 1 + cnt] <= '9')
+				cnt++;
+			if(cnt == 2)
+				offset = 60 * parse_digits(str + n + 1, 2);
+			else if(cnt == 4)
+				offset = 60 * parse_digits(str + n + 1, 2) + parse_digits(str + n + 3, 2);
+			else
+				return false;
+			if(c == '-')
+				offset = -offset;
+			n += 1 + cnt;
+		}
+	}
+	if(n == avail && unpack_context->handle_unpack_underflow) {
+		// date time might continue in next chunk
+		return false;
+	}
+	tm->tm_year = year - 1900;
+	tm->tm_mon = month - 1;
+	tm->tm_mday = mday;
+	tm->tm_hour = hour;
+	tm->tm_min = min;
+	tm->tm_sec = sec;
+	tm->tm_isdst = -1;
+	*msec = ms;
+	*utc_offset = offset;
+	unpack_context->current = str + n;
+
+	const int64_t epoch_sec = days_from_civil(year, month, mday) * 86400 + hour * 3600 + min * 60 + sec - offset * 60;
+	unpack_context->err_no = CCPCP_RC_OK;
+	unpack_context->item.type = CCPCP_ITEM_DATE_TIME;
+	ccpcp_date_time *it = &unpack_context->item.as.DateTime;
+	it->msecs_since_epoch = epoch_sec * 1000 + ms;
+	it->minutes_from_utc = offset;
+	return true;
+}
+
 void ccpon_unpack_date_time(ccpcp_unpack_context *unpack_context, struct tm *tm, int *msec, int *utc_offset)
 {
+	if(unpack_date_time_fixed(unpack_context, tm, msec, utc_offset))
+		return;
+
 	tm->tm_year = 0;
 	tm->tm_mon = 0;
 	tm->tm_mday = 1;
@@ -960,8 +1434,29 @@ static void ccpon_unpack_string(ccpcp_unpack_context* unpack_context)
 		if (*p != '"') {
 			UNPACK_ERROR(CCPCP_RC_MALFORMED_INPUT, "String should start with '\"' character.");
 		}
+		// string without escapes terminated in buffer is returned in place as single chunk
+		const size_t n = unescape_free_length(unpack_context->current, (size_t)(unpack_context->end - unpack_context->current));
+		if(unpack_context->current + n < unpack_context->end && unpack_context->current[n] == '"') {
+			it->chunk_start = (char*)unpack_context->current;
+			it->chunk_size = n;
+			it->last_chunk = 1;
+			it->chunk_cnt++;
+			unpack_context->current += n + 1;
+			return;
+		}
 	}
 	for(it->chunk_size = 0; it->chunk_size < it->chunk_buff_len; ) {
+		// copy buffered data up to the next quote or backslash at once
+		size_t n = (size_t)(unpack_context->end - unpack_context->current);
+		if(n > it->chunk_buff_len - it->chunk_size)
+			n = it->chunk_buff_len - it->chunk_size;
+		n = unescape_free_length(unpack_context->current, n);
+		if(n > 0) {
+			memcpy(it->chunk_start + it->chunk_size, unpack_context->current, n);
+			it->chunk_size += n;
+			unpack_context->current += n;
+			continue;
+		}
 		UNPACK_TAKE_BYTE();
 		if(*p == '\\') {
 			UNPACK_TAKE_BYTE();
@@ -1232,7 +1727,10 @@ void ccpon_unpack_next (ccpcp_unpack_context* unpack_context)
 		UNPACK_ERROR(CCPCP_RC_MALFORMED_INPUT, "Invalid character.");
 	}
 
-	bool is_container_end = false;
+	// count item before push, stack overflow handler can reallocate container states
+	if(top_cont_state && unpack_context->item.type != CCPCP_ITEM_CONTAINER_END)
+		top_cont_state->item_count++;
+
 	switch(unpack_context->item.type) {
 	case CCPCP_ITEM_LIST:
 	//case CCPCP_ITEM_ARRAY:
@@ -1243,14 +1741,10 @@ void ccpon_unpack_next (ccpcp_unpack_context* unpack_context)
 		break;
 	case CCPCP_ITEM_CONTAINER_END:
 		ccpcp_unpack_context_pop_container_state(unpack_context);
-		is_container_end = true;
 		break;
 	default:
 		break;
 	}
-
-	if(top_cont_state && !is_container_end)
-		top_cont_state->item_count++;
 }
 
 void ccpon_pack_field_delim(ccpcp_pack_context *pack_context, bool is_first_field)
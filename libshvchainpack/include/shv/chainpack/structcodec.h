@@ -0,0 +1 @@
+#include "../../../src/chainpack/structcodec.h"
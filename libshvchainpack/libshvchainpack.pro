@@ -22,6 +22,12 @@ android {
 DEFINES += ANDROID_BUILD
 }
 
+# non-atomic RpcValue reference counting for single-threaded RPC stacks, see RpcValue::freezeForSharing()
+# qmake CONFIG+=shv_nonatomic_refcount
+shv_nonatomic_refcount {
+DEFINES += SHVCHAINPACK_NONATOMIC_REFCOUNT
+}
+
 DEFINES += SHVCHAINPACK_BUILD_DLL
 
 INCLUDEPATH += \
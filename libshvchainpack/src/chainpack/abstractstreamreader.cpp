@@ -1,13 +1,16 @@
 #include "abstractstreamreader.h"
 
+#include <algorithm>
+#include <vector>
+
 namespace shv {
 namespace chainpack {
 
 size_t unpack_underflow_handler(ccpcp_unpack_context *ctx)
 {
 	AbstractStreamReader *rd = reinterpret_cast<AbstractStreamReader*>(ctx->custom_context);
-	int c = rd->m_in.get();
-	if(rd->m_in.eof())
+	int c = rd->m_in->get();
+	if(rd->m_in->eof())
 		return 0;
 	rd->m_unpackBuff[0] = c;
 	ctx->start = rd->m_unpackBuff;
@@ -22,7 +25,7 @@ const char *AbstractStreamReader::ParseException::what() const noexcept
 }
 
 AbstractStreamReader::AbstractStreamReader(std::istream &in)
-	: m_in(in)
+	: m_in(&in)
 {
 	// C++ implementation does not require container states stack
 	//ccpcp_container_stack_init(&m_containerStack, m_containerStates, CONTAINER_STATE_CNT, NULL);
@@ -31,10 +34,38 @@ AbstractStreamReader::AbstractStreamReader(std::istream &in)
 	m_inCtx.custom_context = this;
 }
 
+AbstractStreamReader::AbstractStreamReader(const char *data, size_t length)
+{
+	ccpcp_unpack_context_init(&m_inCtx, data, length, nullptr, nullptr);
+	m_inCtx.custom_context = this;
+}
+
 AbstractStreamReader::~AbstractStreamReader()
 {
 }
 
+long AbstractStreamReader::readPosition() const
+{
+	if(m_in) {
+		long pos = m_in->tellg();
+		if(pos < 0)
+			return pos;
+		return pos - (m_inCtx.end - m_inCtx.current);
+	}
+	return m_inCtx.current - m_inCtx.start;
+}
+
+std::string AbstractStreamReader::peekData(size_t max_len)
+{
+	if(m_in) {
+		std::string ret(max_len, '\0');
+		ret.resize(m_in->readsome(&ret[0], max_len));
+		return ret;
+	}
+	size_t len = m_inCtx.end - m_inCtx.current;
+	return std::string(m_inCtx.current, std::min(len, max_len));
+}
+
 RpcValue AbstractStreamReader::read()
 {
 	RpcValue value;
@@ -42,5 +73,118 @@ RpcValue AbstractStreamReader::read()
 	return value;
 }
 
+void AbstractStreamReader::readEvents(EventHandler &handler)
+{
+	struct Container
+	{
+		ccpcp_item_types type;
+		size_t itemCount;
+	};
+	std::vector<Container> containers;
+	std::string key;
+	bool is_blob = false;
+	while(true) {
+		const bool is_key = !containers.empty()
+				&& containers.back().type != CCPCP_ITEM_LIST
+				&& containers.back().itemCount % 2 == 0;
+		if(!unpackNextEvent(handler, is_blob)) {
+			if(is_key)
+				throw ParseException("Invalid map key type", readPosition());
+		}
+		else {
+			switch(m_inCtx.item.type) {
+			case CCPCP_ITEM_INVALID:
+				if(!containers.empty())
+					throw ParseException("Unexpected end of data", readPosition());
+				return;
+			case CCPCP_ITEM_LIST:
+			case CCPCP_ITEM_MAP:
+			case CCPCP_ITEM_IMAP:
+			case CCPCP_ITEM_META:
+				if(is_key)
+					throw ParseException("Container cannot be a map key", readPosition());
+				switch(m_inCtx.item.type) {
+				case CCPCP_ITEM_LIST: handler.onListBegin(); break;
+				case CCPCP_ITEM_MAP: handler.onMapBegin(); break;
+				case CCPCP_ITEM_IMAP: handler.onIMapBegin(); break;
+				default: handler.onMetaBegin(); break;
+				}
+				// container is counted in its parent when closed
+				containers.push_back(Container{m_inCtx.item.type, 0});
+				continue;
+			case CCPCP_ITEM_CONTAINER_END: {
+				if(containers.empty())
+					throw ParseException("Unexpected container end", readPosition());
+				const bool meta_closed = containers.back().type == CCPCP_ITEM_META;
+				containers.pop_back();
+				handler.onContainerEnd();
+				if(meta_closed) {
+					// value with meta data follows
+					continue;
+				}
+				break;
+			}
+			case CCPCP_ITEM_STRING: {
+				const ccpcp_string &it = m_inCtx.item.as.String;
+				if(is_key) {
+					key.append(it.chunk_start, it.chunk_size);
+					if(it.last_chunk) {
+						handler.onMapKey(key);
+						key.clear();
+					}
+				}
+				else if(is_blob) {
+					handler.onBlob(it.chunk_start, it.chunk_size, it.last_chunk);
+				}
+				else {
+					handler.onString(it.chunk_start, it.chunk_size, it.last_chunk);
+				}
+				if(!it.last_chunk)
+					continue;
+				break;
+			}
+			case CCPCP_ITEM_INT:
+				if(is_key)
+					handler.onIMapKey(static_cast<RpcValue::Int>(m_inCtx.item.as.Int));
+				else
+					handler.onInt(m_inCtx.item.as.Int);
+				break;
+			case CCPCP_ITEM_UINT:
+				if(is_key)
+					handler.onIMapKey(static_cast<RpcValue::Int>(m_inCtx.item.as.UInt));
+				else
+					handler.onUInt(m_inCtx.item.as.UInt);
+				break;
+			default:
+				if(is_key)
+					throw ParseException("Invalid map key type", readPosition());
+				switch(m_inCtx.item.type) {
+				case CCPCP_ITEM_NULL:
+					handler.onNull();
+					break;
+				case CCPCP_ITEM_BOOLEAN:
+					handler.onBool(m_inCtx.item.as.Bool);
+					break;
+				case CCPCP_ITEM_DOUBLE:
+					handler.onDouble(m_inCtx.item.as.Double);
+					break;
+				case CCPCP_ITEM_DECIMAL:
+					handler.onDecimal(RpcValue::Decimal(m_inCtx.item.as.Decimal.mantisa, m_inCtx.item.as.Decimal.exponent));
+					break;
+				case CCPCP_ITEM_DATE_TIME:
+					handler.onDateTime(RpcValue::DateTime::fromMSecsSinceEpoch(m_inCtx.item.as.DateTime.msecs_since_epoch, m_inCtx.item.as.DateTime.minutes_from_utc));
+					break;
+				default:
+					throw ParseException("Invalid item type", readPosition());
+				}
+				break;
+			}
+		}
+		if(containers.empty())
+			return;
+		containers.back().itemCount++;
+	}
+}
+
 } // namespace chainpack
 } // namespace shv
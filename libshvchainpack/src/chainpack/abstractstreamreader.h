@@ -1,6 +1,7 @@
 #pragma once
 
 #include "rpcvalue.h"
+#include "rpcvaluearena.h"
 #include "../../c/ccpcp.h"
 
 #include <istream>
@@ -24,22 +25,85 @@ public:
 		std::string m_msg;
 		long m_pos = -1;
 	};
+	/// Receiver of value parts reported by readEvents(), default implementations ignore them.
+	class SHVCHAINPACK_DECL_EXPORT EventHandler
+	{
+	public:
+		virtual ~EventHandler() {}
+
+		virtual void onNull() {}
+		virtual void onBool(bool) {}
+		virtual void onInt(int64_t) {}
+		virtual void onUInt(uint64_t) {}
+		virtual void onDouble(double) {}
+		virtual void onDecimal(const RpcValue::Decimal &) {}
+		virtual void onDateTime(const RpcValue::DateTime &) {}
+		/// long strings are reported in more chunks, the last one has last_chunk set
+		virtual void onString(const char *, size_t, bool /*last_chunk*/) {}
+		virtual void onBlob(const char *, size_t, bool /*last_chunk*/) {}
+		/// typed array is reported as a whole
+		virtual void onArray(const RpcValue &) {}
+		virtual void onMetaBegin() {}
+		virtual void onListBegin() {}
+		virtual void onMapBegin() {}
+		virtual void onIMapBegin() {}
+		/// Map or MetaData string key, always reported in one piece
+		virtual void onMapKey(const std::string &) {}
+		/// IMap or MetaData int key
+		virtual void onIMapKey(RpcValue::Int) {}
+		virtual void onContainerEnd() {}
+	};
 	friend size_t unpack_underflow_handler(ccpcp_unpack_context *ctx);
 public:
 	AbstractStreamReader(std::istream &in);
+	/// reader over contiguous memory, data must stay valid during reader lifetime
+	AbstractStreamReader(const char *data, size_t length);
 	virtual ~AbstractStreamReader();
 
 	RpcValue read();
 
 	virtual void read(RpcValue::MetaData &meta_data) = 0;
 	virtual void read(RpcValue &val) = 0;
+	/// reads one value including meta data and reports its parts to the handler,
+	/// nothing but map keys is kept in memory, so values of any size can be processed
+	void readEvents(EventHandler &handler);
+
+	/// number of bytes consumed so far, stream reader returns stream position
+	long readPosition() const;
+
+	/// decoded values allocate their data from arena when set
+	void setArena(const std::shared_ptr<RpcValueArena> &arena) {m_arena = arena;}
+	const std::shared_ptr<RpcValueArena>& arena() const {return m_arena;}
+
+	/// decoded map and meta data keys are interned as atoms (see AtomTable)
+	void setInternMapKeys(bool on) {m_internMapKeys = on;}
+	bool isInternMapKeys() const {return m_internMapKeys;}
+	/// decoded string values not longer than max_length are interned as atoms, 0 disables it,
+	/// use it for data with strings from a limited set like method names and shv paths
+	void setInternStringMaxLength(size_t max_length) {m_internStringMaxLength = max_length;}
+	size_t internStringMaxLength() const {return m_internStringMaxLength;}
+protected:
+	/// unpacks next item for readEvents(), is_blob is set for blob string chunks,
+	/// returns false if the item is not supported by C unpacker and it was reported to the handler directly
+	virtual bool unpackNextEvent(EventHandler &handler, bool &is_blob) = 0;
+	std::string peekData(size_t max_len);
+	bool isInternedString(size_t length) const
+	{
+		if(m_readingMapKey)
+			return m_internMapKeys;
+		return length <= m_internStringMaxLength && m_internStringMaxLength > 0;
+	}
 protected:
-	std::istream &m_in;
+	std::istream *m_in = nullptr;
 	char m_unpackBuff[1];
 	//static constexpr size_t CONTAINER_STATE_CNT = 100;
 	//ccpcp_container_state m_containerStates[CONTAINER_STATE_CNT];
 	//ccpcp_container_stack m_containerStack;
 	ccpcp_unpack_context m_inCtx;
+	std::shared_ptr<RpcValueArena> m_arena;
+	bool m_internMapKeys = false;
+	size_t m_internStringMaxLength = 0;
+	bool m_readingMapKey = false;
 };
 
 } // namespace chainpack
@@ -8,19 +8,55 @@ void pack_overflow_handler(ccpcp_pack_context *ctx, size_t size_hint)
 	(void)size_hint;
 	AbstractStreamWriter *wr = reinterpret_cast<AbstractStreamWriter*>(ctx->custom_context);
 	while(ctx->start < ctx->current) {
-		wr->m_out << *ctx->start++;
+		*wr->m_out << *ctx->start++;
 	}
 	ctx->start = wr->m_packBuff;
 	ctx->current = ctx->start;
 }
 
+void string_pack_overflow_handler(ccpcp_pack_context *ctx, size_t size_hint)
+{
+	AbstractStreamWriter *wr = reinterpret_cast<AbstractStreamWriter*>(ctx->custom_context);
+	std::string &out = *wr->m_outString;
+	size_t len = ctx->current - ctx->start;
+	if(size_hint == 0) {
+		// flush, cut off unused space
+		out.resize(len);
+	}
+	else {
+		size_t new_size = 2 * out.size();
+		if(new_size < len + size_hint)
+			new_size = len + size_hint;
+		if(new_size < sizeof(wr->m_packBuff))
+			new_size = sizeof(wr->m_packBuff);
+		if(new_size < out.capacity()) {
+			// use space reserved by caller first
+			new_size = out.capacity();
+		}
+		out.resize(new_size);
+	}
+	ctx->start = &out[0];
+	ctx->current = ctx->start + len;
+	ctx->end = ctx->start + out.size();
+}
+
 AbstractStreamWriter::AbstractStreamWriter(std::ostream &out)
-	: m_out(out)
+	: m_out(&out)
 {
 	ccpcp_pack_context_init(&m_outCtx, m_packBuff, sizeof(m_packBuff), pack_overflow_handler);
 	m_outCtx.custom_context = this;
 }
 
+AbstractStreamWriter::AbstractStreamWriter(std::string &out)
+	: m_outString(&out)
+{
+	// pack directly to the string, start points to the string beginning,
+	// so new data is appended to the existing content
+	ccpcp_pack_context_init(&m_outCtx, &out[0], out.size(), string_pack_overflow_handler);
+	m_outCtx.current = m_outCtx.end;
+	m_outCtx.custom_context = this;
+}
+
 AbstractStreamWriter::~AbstractStreamWriter()
 {
 	flush();
@@ -32,5 +68,16 @@ void AbstractStreamWriter::flush()
 		m_outCtx.handle_pack_overflow(&m_outCtx, 0);
 }
 
+void AbstractStreamWriter::writeBytes(const char *data, size_t length)
+{
+	if(m_out && length > sizeof(m_packBuff)) {
+		flush();
+		m_out->write(data, static_cast<std::streamsize>(length));
+	}
+	else {
+		ccpcp_pack_copy_bytes(&m_outCtx, data, length);
+	}
+}
+
 } // namespace chainpack
 } // namespace shv
@@ -11,8 +11,12 @@ namespace chainpack {
 class SHVCHAINPACK_DECL_EXPORT AbstractStreamWriter
 {
 	friend void pack_overflow_handler(ccpcp_pack_context *ctx, size_t size_hint);
+	friend void string_pack_overflow_handler(ccpcp_pack_context *ctx, size_t size_hint);
 public:
 	AbstractStreamWriter(std::ostream &out);
+	/// writer appending directly to the out string,
+	/// string content is complete after flush() or writer destruction
+	AbstractStreamWriter(std::string &out);
 	virtual ~AbstractStreamWriter();
 
 	virtual void write(const RpcValue::MetaData &meta_data) = 0;
@@ -28,10 +32,16 @@ public:
 	virtual void writeRawData(const std::string &data) = 0;
 
 	void flush();
+	/// context for direct packing with cchainpack / ccpon functions, see StructCodec
+	ccpcp_pack_context* packContext() {return &m_outCtx;}
+protected:
+	/// data longer than pack buffer are written to out stream directly
+	void writeBytes(const char *data, size_t length);
 protected:
 	static constexpr bool WRITE_INVALID_AS_NULL = true;
 protected:
-	std::ostream &m_out;
+	std::ostream *m_out = nullptr;
+	std::string *m_outString = nullptr;
 	char m_packBuff[32];
 	ccpcp_pack_context m_outCtx;
 };
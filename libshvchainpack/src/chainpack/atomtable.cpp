@@ -0,0 +1,74 @@
+#include "atomtable.h"
+#include "rpcvaluearena.h"
+
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+namespace shv {
+namespace chainpack {
+
+namespace {
+// points to the string owned by atom, lookup does not need to construct std::string
+struct StringRef
+{
+	const char *data;
+	size_t len;
+
+	bool operator==(const StringRef &o) const { return len == o.len && std::memcmp(data, o.data, len) == 0; }
+};
+
+struct StringRefHash
+{
+	size_t operator()(const StringRef &s) const
+	{
+		// FNV-1a
+		size_t h = 2166136261u;
+		for (size_t i = 0; i < s.len; ++i) {
+			h ^= static_cast<unsigned char>(s.data[i]);
+			h *= 16777619u;
+		}
+		return h;
+	}
+};
+
+struct Table
+{
+	std::mutex mutex;
+	std::unordered_map<StringRef, RpcValue, StringRefHash> atoms;
+};
+
+Table& table()
+{
+	// never destroyed, atoms can be released during static destruction
+	static Table *t = new Table();
+	return *t;
+}
+}
+
+RpcValue AtomTable::atom(const char *str, size_t len)
+{
+	Table &t = table();
+	std::lock_guard<std::mutex> lock(t.mutex);
+	auto it = t.atoms.find(StringRef{str, len});
+	if(it != t.atoms.end())
+		return it->second;
+	// atom outlives decoding arena
+	RpcValueArena::Suspend no_arena;
+	RpcValue val(std::string(str, len));
+	// atoms are shared by all threads
+	val.freezeForSharing();
+	const std::string &s = val.toString();
+	t.atoms.emplace(StringRef{s.data(), s.size()}, val);
+	return val;
+}
+
+size_t AtomTable::count()
+{
+	Table &t = table();
+	std::lock_guard<std::mutex> lock(t.mutex);
+	return t.atoms.size();
+}
+
+} // namespace chainpack
+} // namespace shv
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "rpcvalue.h"
+
+namespace shv {
+namespace chainpack {
+
+/// Global thread-safe table of interned strings (atoms).
+/// Atom is a String RpcValue, atoms with equal content share one heap copy,
+/// so they compare by pointer. Atoms are never released, intern only strings
+/// from a limited set like map keys, method names or shv paths.
+class SHVCHAINPACK_DECL_EXPORT AtomTable
+{
+public:
+	static RpcValue atom(const char *str, size_t len);
+	static RpcValue atom(const std::string &str) {return atom(str.data(), str.size());}
+	/// number of interned strings
+	static size_t count();
+};
+
+} // namespace chainpack
+} // namespace shv
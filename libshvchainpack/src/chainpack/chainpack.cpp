@@ -33,4 +33,82 @@ const char *ChainPack::PackingSchema::name(ChainPack::PackingSchema::Enum e)
 	return "UNKNOWN";
 }
 
+size_t ChainPack::packedSize(const RpcValue &value)
+{
+	struct Visitor
+	{
+		size_t operator()() const { return 1; }
+		size_t operator()(std::nullptr_t) const { return 1; }
+		size_t operator()(bool) const { return 1; }
+		size_t operator()(uint64_t val) const { return cchainpack_uint_packed_size(val); }
+		size_t operator()(int64_t val) const { return cchainpack_int_packed_size(val); }
+		size_t operator()(double) const { return 1 + sizeof(double); }
+		size_t operator()(const RpcValue::String &val) const { return cchainpack_string_packed_size(val.size()); }
+		size_t operator()(const RpcValue::Blob &val) const { return cchainpack_string_packed_size(val.size()); }
+		size_t operator()(const RpcValue::DateTime &dt) const
+		{
+			return cchainpack_date_time_packed_size(dt.msecsSinceEpoch(), dt.minutesFromUtc());
+		}
+		size_t operator()(const RpcValue::Decimal &d) const
+		{
+			return cchainpack_decimal_packed_size(d.mantisa(), d.exponent());
+		}
+		size_t operator()(const RpcValue::List &list) const
+		{
+			size_t ret = 2;
+			for(const RpcValue &v : list)
+				ret += packedSize(v);
+			return ret;
+		}
+		size_t operator()(const RpcValue::Array &array) const
+		{
+			size_t ret = 1 + cchainpack_uint_data_packed_size(array.size());
+			switch (array.type()) {
+			case RpcValue::Type::Int:
+				for(int64_t n : array.intValues())
+					ret += cchainpack_int_data_packed_size(n);
+				return ret;
+			case RpcValue::Type::UInt:
+				for(uint64_t n : array.uintValues())
+					ret += cchainpack_uint_data_packed_size(n);
+				return ret;
+			case RpcValue::Type::Double:
+				return ret + array.size() * sizeof(double);
+			default:
+				return 2;
+			}
+		}
+		size_t operator()(const RpcValue::Map &map) const
+		{
+			size_t ret = 2;
+			for(const auto &kv : map)
+				ret += cchainpack_string_packed_size(kv.first.size()) + packedSize(kv.second);
+			return ret;
+		}
+		size_t operator()(const RpcValue::IMap &map) const
+		{
+			size_t ret = 2;
+			for(const auto &kv : map)
+				ret += cchainpack_int_packed_size(kv.first) + packedSize(kv.second);
+			return ret;
+		}
+	};
+	if(const RpcValue::Blob *str = value.stringData())
+		return packedSize(value.metaData()) + cchainpack_string_packed_size(str->size());
+	return packedSize(value.metaData()) + value.visit(Visitor());
+}
+
+size_t ChainPack::packedSize(const RpcValue::MetaData &meta_data)
+{
+	if(meta_data.isEmpty())
+		return 0;
+	size_t ret = 2;
+	meta_data.forEachIValue([&ret](RpcValue::Int key, const RpcValue &val) {
+		ret += cchainpack_int_packed_size(key) + packedSize(val);
+	});
+	for(const auto &kv : meta_data.sValues())
+		ret += cchainpack_string_packed_size(kv.first.size()) + packedSize(kv.second);
+	return ret;
+}
+
 }}
@@ -41,6 +41,10 @@ public:
 		};
 		static const char* name(Enum e);
 	};
+public:
+	/// exact number of bytes written by ChainPackWriter
+	static size_t packedSize(const RpcValue &value);
+	static size_t packedSize(const RpcValue::MetaData &meta_data);
 };
 
 }}
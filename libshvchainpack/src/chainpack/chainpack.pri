@@ -2,7 +2,11 @@ SOURCES += \
     $$PWD/rpc.cpp \
     $$PWD/rpcmessage.cpp \
     $$PWD/rpcvalue.cpp \
+    $$PWD/rpcvaluearena.cpp \
+    $$PWD/atomtable.cpp \
+    $$PWD/persistentmap.cpp \
     $$PWD/rpcdriver.cpp \
+    $$PWD/rpcframereader.cpp \
     $$PWD/metatypes.cpp \
     $$PWD/exception.cpp \
     $$PWD/utils.cpp \
@@ -15,6 +19,9 @@ SOURCES += \
     $$PWD/chainpack.cpp \
     $$PWD/chainpackreader.cpp \
     $$PWD/chainpackreader1.cpp \
+    $$PWD/chainpackview.cpp \
+    $$PWD/transcoder.cpp \
+    $$PWD/structcodec.cpp \
     $$PWD/metamethod.cpp \
     $$PWD/tunnelctl.cpp \
     $$PWD/irpcconnection.cpp
@@ -23,7 +30,12 @@ HEADERS += \
     $$PWD/rpc.h \
     $$PWD/rpcmessage.h \
     $$PWD/rpcvalue.h \
+    $$PWD/flatmap.h \
+    $$PWD/rpcvaluearena.h \
+    $$PWD/atomtable.h \
+    $$PWD/persistentmap.h \
     $$PWD/rpcdriver.h \
+    $$PWD/rpcframereader.h \
     $$PWD/metatypes.h \
     $$PWD/exception.h \
     $$PWD/utils.h \
@@ -36,6 +48,9 @@ HEADERS += \
     $$PWD/chainpack.h \
     $$PWD/chainpackreader1.h \
     $$PWD/chainpackreader.h \
+    $$PWD/chainpackview.h \
+    $$PWD/transcoder.h \
+    $$PWD/structcodec.h \
     $$PWD/metamethod.h \
     $$PWD/tunnelctl.h \
     $$PWD/irpcconnection.h
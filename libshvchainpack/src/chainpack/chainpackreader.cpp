@@ -1,28 +1,32 @@
 #include "chainpack.h"
 #include "chainpackreader.h"
+#include "atomtable.h"
 #include "../../c/cchainpack.h"
 
 #include <iostream>
 #include <cmath>
+#include <algorithm>
 
 namespace shv {
 namespace chainpack {
 
 #define PARSE_EXCEPTION(msg) {\
-	char buff[40]; \
-	m_in.readsome(buff, sizeof(buff)); \
+	long pos = readPosition(); \
+	std::string near_to = peekData(40); \
 	if(exception_aborts) { \
 		std::clog << __FILE__ << ':' << __LINE__;  \
-		std::clog << ' ' << (msg) << " at pos: " << m_in.tellg() << " near to: " << buff << std::endl; \
+		std::clog << ' ' << (msg) << " at pos: " << pos << " near to: " << near_to << std::endl; \
 		abort(); \
 	} \
 	else { \
-		throw ChainPackReader::ParseException(std::string("ChainPack ") + msg + std::string(" at pos: ") + std::to_string(m_in.tellg()) + " near to: " + buff, m_in.tellg()); \
+		throw ChainPackReader::ParseException(std::string("ChainPack ") + msg + std::string(" at pos: ") + std::to_string(pos) + " near to: " + near_to, pos); \
 	} \
 }
 
 namespace {
 enum {exception_aborts = 0};
+// shorter strings are copied, slice would keep whole input buffer alive for few bytes
+const size_t STRING_DATA_MIN_SIZE = 1024;
 /*
 const int MAX_RECURSION_DEPTH = 1000;
 
@@ -56,6 +60,32 @@ void ChainPackReader::unpackNext()
 		PARSE_EXCEPTION("Parse error: " + std::string(m_inCtx.err_msg) + " at: " + std::to_string(m_inCtx.err_no));
 }
 
+bool ChainPackReader::unpackNextEvent(EventHandler &handler, bool &is_blob)
+{
+	if(m_inCtx.item.type == CCPCP_ITEM_STRING && !m_inCtx.item.as.String.last_chunk) {
+		// next chunk of string or blob
+		unpackNext();
+		return true;
+	}
+	is_blob = false;
+	const uint8_t *b = (const uint8_t*)ccpcp_unpack_take_byte(&m_inCtx);
+	if(b && *b >= CP_Null && *b < CP_FALSE && (*b & ChainPack::ARRAY_FLAG_MASK)) {
+		// typed array is not supported by C unpacker
+		RpcValue array;
+		parseArray(array, *b & ~ChainPack::ARRAY_FLAG_MASK);
+		m_inCtx.item.type = CCPCP_ITEM_INVALID;
+		handler.onArray(array);
+		return false;
+	}
+	if(b) {
+		// C unpacker reads blob as string
+		is_blob = (*b == CP_Blob_depr);
+		m_inCtx.current--;
+	}
+	unpackNext();
+	return true;
+}
+
 void ChainPackReader::read(RpcValue &val, std::string &err)
 {
 	err.clear();
@@ -79,13 +109,44 @@ uint64_t ChainPackReader::readUIntData(std::istream &in, bool *ok)
 }
 
 void ChainPackReader::read(RpcValue &val)
+{
+	// arena is activated once for whole value tree
+	RpcValueArena::Scope arena_scope(m_arena);
+	readValue(val);
+}
+
+void ChainPackReader::read(RpcValue::MetaData &meta_data)
+{
+	RpcValueArena::Scope arena_scope(m_arena);
+	readMetaData(meta_data);
+}
+
+void ChainPackReader::readValue(RpcValue &val)
 {
 	//if (m_depth > MAX_RECURSION_DEPTH)
 	//	PARSE_EXCEPTION("maximum nesting depth exceeded");
 	//DepthScope{m_depth};
 
 	RpcValue::MetaData md;
-	read(md);
+	readMetaData(md);
+
+	const uint8_t *b = (const uint8_t*)ccpcp_unpack_take_byte(&m_inCtx);
+	if(b && *b >= CP_Null && *b < CP_FALSE && (*b & ChainPack::ARRAY_FLAG_MASK)) {
+		// typed array is not supported by C unpacker
+		parseArray(val, *b & ~ChainPack::ARRAY_FLAG_MASK);
+		if(!md.isEmpty())
+			val.setMetaData(std::move(md));
+		return;
+	}
+	if(b && *b == CP_Blob_depr) {
+		// C unpacker reads blob as string
+		parseBlob(val);
+		if(!md.isEmpty())
+			val.setMetaData(std::move(md));
+		return;
+	}
+	if(b)
+		m_inCtx.current--;
 
 	unpackNext();
 
@@ -115,16 +176,29 @@ void ChainPackReader::read(RpcValue &val)
 	}
 	case CCPCP_ITEM_STRING: {
 		ccpcp_string *it = &(m_inCtx.item.as.String);
-		std::string str;
-		while(m_inCtx.item.type == CCPCP_ITEM_STRING) {
-			str += std::string(it->chunk_start, it->chunk_size);
-			if(it->last_chunk)
-				break;
+		if(it->last_chunk && isInternedString(it->chunk_size)) {
+			val = AtomTable::atom(it->chunk_start, it->chunk_size);
+			break;
+		}
+		// string contiguous in input data comes in single chunk
+		if(it->last_chunk && m_blobDataOwner && !m_in && it->chunk_size >= STRING_DATA_MIN_SIZE) {
+			val = RpcValue::fromStringData(RpcValue::Blob(m_blobDataOwner, it->chunk_start, it->chunk_size));
+			break;
+		}
+		std::string str(it->chunk_start, it->chunk_size);
+		if(!it->last_chunk && it->string_size >= 0 && m_in) {
+			readStringRest(str);
+		}
+		else while(!it->last_chunk) {
 			unpackNext();
 			if(m_inCtx.item.type != CCPCP_ITEM_STRING)
 				PARSE_EXCEPTION("Unfinished string");
+			str.append(it->chunk_start, it->chunk_size);
 		}
-		val = str;
+		if(isInternedString(str.size()))
+			val = AtomTable::atom(str);
+		else
+			val = std::move(str);
 		break;
 	}
 	case CCPCP_ITEM_BOOLEAN: {
@@ -165,7 +239,7 @@ void ChainPackReader::parseList(RpcValue &val)
 	RpcValue::List lst;
 	while (true) {
 		RpcValue v;
-		read(v);
+		readValue(v);
 		if(m_inCtx.item.type == CCPCP_ITEM_CONTAINER_END) {
 			m_inCtx.item.type = CCPCP_ITEM_INVALID;
 			break;
@@ -175,17 +249,124 @@ void ChainPackReader::parseList(RpcValue &val)
 	val = lst;
 }
 
+void ChainPackReader::parseArray(RpcValue &val, uint8_t element_schema)
+{
+	bool ok;
+	uint64_t size = cchainpack_unpack_uint_data(&m_inCtx, &ok);
+	if(!ok)
+		PARSE_EXCEPTION("Cannot read array size");
+	// do not trust the size from input data more than the buffer content
+	size_t size_hint = static_cast<size_t>(std::min<uint64_t>(size, static_cast<uint64_t>(m_inCtx.end - m_inCtx.current)));
+	switch(element_schema) {
+	case CP_Int: {
+		std::vector<int64_t> values;
+		values.reserve(size_hint);
+		for (uint64_t i = 0; i < size; ++i) {
+			values.push_back(cchainpack_unpack_int_data(&m_inCtx, &ok));
+			if(!ok)
+				PARSE_EXCEPTION("Cannot read Int array element");
+		}
+		val = RpcValue::Array(std::move(values));
+		break;
+	}
+	case CP_UInt: {
+		std::vector<uint64_t> values;
+		values.reserve(size_hint);
+		for (uint64_t i = 0; i < size; ++i) {
+			values.push_back(cchainpack_unpack_uint_data(&m_inCtx, &ok));
+			if(!ok)
+				PARSE_EXCEPTION("Cannot read UInt array element");
+		}
+		val = RpcValue::Array(std::move(values));
+		break;
+	}
+	case CP_Double: {
+		std::vector<double> values;
+		// read in chunks, whole buffered part at once
+		size_t chunk_size = std::max<size_t>(size_hint / sizeof(double), 1024);
+		while(values.size() < size) {
+			size_t pos = values.size();
+			size_t n = static_cast<size_t>(std::min<uint64_t>(size - pos, chunk_size));
+			values.resize(pos + n);
+			cchainpack_unpack_double_data(&m_inCtx, values.data() + pos, n);
+			if(m_inCtx.err_no != CCPCP_RC_OK)
+				PARSE_EXCEPTION("Cannot read Double array element");
+		}
+		val = RpcValue::Array(std::move(values));
+		break;
+	}
+	default:
+		PARSE_EXCEPTION("Unsupported array element type: " + std::string(cchainpack_packing_schema_name(element_schema)));
+	}
+}
+
+void ChainPackReader::parseBlob(RpcValue &val)
+{
+	bool ok;
+	uint64_t size = cchainpack_unpack_uint_data(&m_inCtx, &ok);
+	if(!ok)
+		PARSE_EXCEPTION("Cannot read blob size");
+	size_t buffered = static_cast<size_t>(m_inCtx.end - m_inCtx.current);
+	if(!m_in) {
+		if(size > buffered)
+			PARSE_EXCEPTION("Unfinished blob");
+		size_t len = static_cast<size_t>(size);
+		if(m_blobDataOwner)
+			val = RpcValue::Blob(m_blobDataOwner, m_inCtx.current, len);
+		else
+			val = RpcValue::Blob(m_inCtx.current, len);
+		m_inCtx.current += len;
+		return;
+	}
+	std::string data(m_inCtx.current, static_cast<size_t>(std::min<uint64_t>(size, buffered)));
+	m_inCtx.current += data.size();
+	// do not trust the size from input data, read the rest from stream in chunks
+	while(data.size() < size) {
+		size_t pos = data.size();
+		size_t n = static_cast<size_t>(std::min<uint64_t>(size - pos, 64 * 1024));
+		data.resize(pos + n);
+		m_in->read(&data[pos], static_cast<std::streamsize>(n));
+		if(static_cast<size_t>(m_in->gcount()) != n)
+			PARSE_EXCEPTION("Unfinished blob");
+	}
+	val = RpcValue::Blob(std::move(data));
+}
+
+void ChainPackReader::readStringRest(std::string &str)
+{
+	ccpcp_string *it = &(m_inCtx.item.as.String);
+	static constexpr uint64_t MAX_RESERVE = 1024 * 1024;
+	uint64_t size = static_cast<uint64_t>(it->string_size);
+	str.reserve(static_cast<size_t>(std::min(size, MAX_RESERVE)));
+	size_t buffered = static_cast<size_t>(std::min<uint64_t>(static_cast<uint64_t>(m_inCtx.end - m_inCtx.current), size - str.size()));
+	str.append(m_inCtx.current, buffered);
+	m_inCtx.current += buffered;
+	// read the rest from stream at once instead of chunk by chunk, in pieces since the size is not trusted
+	while(str.size() < size) {
+		size_t pos = str.size();
+		size_t n = static_cast<size_t>(std::min<uint64_t>(size - pos, 64 * 1024));
+		str.resize(pos + n);
+		m_in->read(&str[pos], static_cast<std::streamsize>(n));
+		if(static_cast<size_t>(m_in->gcount()) != n)
+			PARSE_EXCEPTION("Unfinished string");
+	}
+	it->size_to_load = 0;
+	it->last_chunk = 1;
+}
+
 void ChainPackReader::parseMetaData(RpcValue::MetaData &meta_data)
 {
 	while (true) {
 		RpcValue key;
-		read(key);
+		m_readingMapKey = true;
+		readValue(key);
+		m_readingMapKey = false;
 		if(m_inCtx.item.type == CCPCP_ITEM_CONTAINER_END) {
 			m_inCtx.item.type = CCPCP_ITEM_INVALID;
 			break;
 		}
 		RpcValue val;
-		read(val);
+		readValue(val);
 		if(key.isString())
 			meta_data.setValue(key.toString(), val);
 		else
@@ -195,42 +376,47 @@ void ChainPackReader::parseMetaData(RpcValue::MetaData &meta_data)
 
 void ChainPackReader::parseMap(RpcValue &val)
 {
-	RpcValue::Map map;
+	// pairs are sorted once, decoded keys can come in any order
+	RpcValue::Map::container_type pairs;
 	while (true) {
 		RpcValue key;
-		read(key);
+		m_readingMapKey = true;
+		readValue(key);
+		m_readingMapKey = false;
 		if(m_inCtx.item.type == CCPCP_ITEM_CONTAINER_END) {
 			m_inCtx.item.type = CCPCP_ITEM_INVALID;
 			break;
 		}
 		RpcValue val;
-		read(val);
-		map[key.toString()] = val;
+		readValue(val);
+		pairs.emplace_back(key.toString(), std::move(val));
 	}
-	val = map;
+	val = RpcValue::Map(std::move(pairs));
 }
 
 void ChainPackReader::parseIMap(RpcValue &val)
 {
-	RpcValue::IMap map;
+	// pairs are sorted once, decoded keys can come in any order
+	RpcValue::IMap::container_type pairs;
 	while (true) {
 		RpcValue key;
-		read(key);
+		readValue(key);
 		if(m_inCtx.item.type == CCPCP_ITEM_CONTAINER_END) {
 			m_inCtx.item.type = CCPCP_ITEM_INVALID;
 			break;
 		}
 		RpcValue val;
-		read(val);
-		map[key.toInt()] = val;
+		readValue(val);
+		pairs.emplace_back(key.toInt(), std::move(val));
 	}
-	val = map;
+	val = RpcValue::IMap(std::move(pairs));
 }
 
-void ChainPackReader::read(RpcValue::MetaData &meta_data)
+void ChainPackReader::readMetaData(RpcValue::MetaData &meta_data)
 {
 	const uint8_t *b = (const uint8_t*)ccpcp_unpack_take_byte(&m_inCtx);
-	m_inCtx.current--;
+	if(b)
+		m_inCtx.current--;
 	if(b && *b == CP_MetaMap) {
 		cchainpack_unpack_next(&m_inCtx);
 		parseMetaData(meta_data);
@@ -11,6 +11,7 @@ class SHVCHAINPACK_DECL_EXPORT ChainPackReader : public AbstractStreamReader
 	using Super = AbstractStreamReader;
 public:
 	ChainPackReader(std::istream &in) : Super(in) {}
+	ChainPackReader(const char *data, size_t length) : Super(data, length) {}
 
 	ChainPackReader& operator >>(RpcValue &value);
 	ChainPackReader& operator >>(RpcValue::MetaData &meta_data);
@@ -22,13 +23,26 @@ public:
 
 	uint64_t readUIntData(bool *ok);
 	static uint64_t readUIntData(std::istream &in, bool *ok);
+
+	/// decoded blobs and long strings reference contiguous input data instead of copying them,
+	/// owner must keep the data valid and unchanged, stream reader ignores it
+	void setBlobDataOwner(std::shared_ptr<const void> owner) {m_blobDataOwner = std::move(owner);}
+protected:
+	bool unpackNextEvent(EventHandler &handler, bool &is_blob) override;
 private:
 	void unpackNext();
+	void readValue(RpcValue &val);
+	void readMetaData(RpcValue::MetaData &meta_data);
 
 	void parseList(RpcValue &val);
+	void parseArray(RpcValue &val, uint8_t element_schema);
+	void parseBlob(RpcValue &val);
+	void readStringRest(std::string &str);
 	void parseMetaData(RpcValue::MetaData &meta_data);
 	void parseMap(RpcValue &val);
 	void parseIMap(RpcValue &val);
+private:
+	std::shared_ptr<const void> m_blobDataOwner;
 };
 
 } // namespace chainpack
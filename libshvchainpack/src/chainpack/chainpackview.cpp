@@ -0,0 +1,432 @@
+#include "chainpackview.h"
+#include "chainpackreader.h"
+#include "exception.h"
+#include "../../c/cchainpack.h"
+
+namespace shv {
+namespace chainpack {
+
+namespace {
+
+void check_unpack_error(const ccpcp_unpack_context &ctx)
+{
+	if(ctx.err_no != CCPCP_RC_OK)
+		SHVCHP_EXCEPTION(std::string("Malformed ChainPack data: ") + ccpcp_error_string(ctx.err_no));
+}
+
+void skip_value(ccpcp_unpack_context *ctx);
+
+bool is_array_schema(uint8_t schema)
+{
+	return schema >= CP_Null && schema < CP_FALSE && (schema & ChainPack::ARRAY_FLAG_MASK);
+}
+
+void skip_array(ccpcp_unpack_context *ctx)
+{
+	uint8_t element_schema = (uint8_t)*ctx->current & ~ChainPack::ARRAY_FLAG_MASK;
+	ctx->current++;
+	bool ok;
+	uint64_t size = cchainpack_unpack_uint_data(ctx, &ok);
+	if(!ok)
+		return;
+	switch(element_schema) {
+	case CP_Double:
+		if(size > static_cast<uint64_t>(ctx->end - ctx->current) / sizeof(double)) {
+			ctx->err_no = CCPCP_RC_BUFFER_UNDERFLOW;
+			return;
+		}
+		ctx->current += size * sizeof(double);
+		return;
+	case CP_Int:
+	case CP_UInt:
+		// Int and UInt data have the same length encoding
+		for(uint64_t i = 0; i < size && ctx->err_no == CCPCP_RC_OK; i++)
+			cchainpack_unpack_uint_data(ctx, nullptr);
+		return;
+	default:
+		ctx->err_no = CCPCP_RC_MALFORMED_INPUT;
+		return;
+	}
+}
+
+void skip_container_rest(ccpcp_unpack_context *ctx)
+{
+	while(ctx->err_no == CCPCP_RC_OK) {
+		const char *p = ccpcp_unpack_peek_byte(ctx);
+		if(!p)
+			return;
+		if((uint8_t)*p == CP_TERM) {
+			ctx->current++;
+			return;
+		}
+		skip_value(ctx);
+	}
+}
+
+void skip_value(ccpcp_unpack_context *ctx)
+{
+	const char *p = ccpcp_unpack_peek_byte(ctx);
+	if(!p)
+		return;
+	if((uint8_t)*p == CP_MetaMap) {
+		ctx->current++;
+		skip_container_rest(ctx);
+		p = ccpcp_unpack_peek_byte(ctx);
+		if(!p)
+			return;
+	}
+	if(is_array_schema((uint8_t)*p)) {
+		skip_array(ctx);
+		return;
+	}
+	switch((uint8_t)*p) {
+	case CP_String: {
+		// skip string data without copying it to the chunk buffer
+		ctx->current++;
+		bool ok;
+		uint64_t len = cchainpack_unpack_uint_data(ctx, &ok);
+		if(!ok)
+			return;
+		if(len > static_cast<uint64_t>(ctx->end - ctx->current)) {
+			ctx->err_no = CCPCP_RC_BUFFER_UNDERFLOW;
+			return;
+		}
+		ctx->current += len;
+		return;
+	}
+	case CP_List:
+	case CP_Map:
+	case CP_IMap:
+		ctx->current++;
+		skip_container_rest(ctx);
+		return;
+	case CP_TERM:
+		ctx->err_no = CCPCP_RC_MALFORMED_INPUT;
+		return;
+	default:
+		ctx->item.type = CCPCP_ITEM_INVALID;
+		cchainpack_unpack_next(ctx);
+		while(ctx->err_no == CCPCP_RC_OK && ctx->item.type == CCPCP_ITEM_STRING && !ctx->item.as.String.last_chunk)
+			cchainpack_unpack_next(ctx);
+		ctx->item.type = CCPCP_ITEM_INVALID;
+		return;
+	}
+}
+
+const char* skip_value(const char *start, const char *end)
+{
+	ccpcp_unpack_context ctx;
+	ccpcp_unpack_context_init(&ctx, start, end - start, nullptr, nullptr);
+	skip_value(&ctx);
+	check_unpack_error(ctx);
+	return ctx.current;
+}
+
+void unpack_scalar(ccpcp_unpack_context *ctx, const char *start, const char *end)
+{
+	ccpcp_unpack_context_init(ctx, start, end - start, nullptr, nullptr);
+	if(start)
+		cchainpack_unpack_next(ctx);
+	if(ctx->err_no != CCPCP_RC_OK)
+		ctx->item.type = CCPCP_ITEM_INVALID;
+}
+
+}
+
+//================================================================
+// ChainPackView::const_iterator
+//================================================================
+ChainPackView::const_iterator::const_iterator(const char *pos, const char *end, bool is_map)
+	: m_pos(pos)
+	, m_end(end)
+	, m_isMap(is_map)
+{
+	normalize();
+}
+
+void ChainPackView::const_iterator::normalize()
+{
+	if(!m_pos)
+		return;
+	if(m_pos >= m_end)
+		SHVCHP_EXCEPTION("Malformed ChainPack data: unterminated container");
+	if((uint8_t)*m_pos == CP_TERM)
+		m_pos = nullptr;
+}
+
+const char *ChainPackView::const_iterator::valueStart() const
+{
+	return m_isMap? skip_value(m_pos, m_end): m_pos;
+}
+
+ChainPackView ChainPackView::const_iterator::key() const
+{
+	if(!m_pos || !m_isMap)
+		return ChainPackView();
+	return ChainPackView(m_pos, m_end - m_pos);
+}
+
+ChainPackView ChainPackView::const_iterator::value() const
+{
+	if(!m_pos)
+		return ChainPackView();
+	const char *p = valueStart();
+	return ChainPackView(p, m_end - p);
+}
+
+ChainPackView::const_iterator &ChainPackView::const_iterator::operator++()
+{
+	if(m_pos) {
+		m_pos = skip_value(valueStart(), m_end);
+		normalize();
+	}
+	return *this;
+}
+
+//================================================================
+// ChainPackView
+//================================================================
+ChainPackView::ChainPackView(const char *data, size_t length)
+{
+	if(!data || length == 0)
+		return;
+	m_start = data;
+	m_end = data + length;
+	m_valueStart = m_start;
+	if((uint8_t)*m_start == CP_MetaMap) {
+		ccpcp_unpack_context ctx;
+		ccpcp_unpack_context_init(&ctx, m_start + 1, length - 1, nullptr, nullptr);
+		skip_container_rest(&ctx);
+		check_unpack_error(ctx);
+		if(ctx.current >= m_end)
+			SHVCHP_EXCEPTION("Malformed ChainPack data: value missing after meta data");
+		m_valueStart = ctx.current;
+	}
+}
+
+RpcValue::Type ChainPackView::type() const
+{
+	if(!m_valueStart)
+		return RpcValue::Type::Invalid;
+	uint8_t schema = (uint8_t)*m_valueStart;
+	if(schema < 128)
+		return (schema & 64)? RpcValue::Type::Int: RpcValue::Type::UInt;
+	if(is_array_schema(schema))
+		return RpcValue::Type::Array;
+	switch(schema) {
+	case CP_Null: return RpcValue::Type::Null;
+	case CP_UInt: return RpcValue::Type::UInt;
+	case CP_Int: return RpcValue::Type::Int;
+	case CP_Double: return RpcValue::Type::Double;
+	case CP_TRUE:
+	case CP_FALSE: return RpcValue::Type::Bool;
+	case CP_String:
+	case CP_CString: return RpcValue::Type::String;
+	case CP_DateTime: return RpcValue::Type::DateTime;
+	case CP_List: return RpcValue::Type::List;
+	case CP_Map: return RpcValue::Type::Map;
+	case CP_IMap: return RpcValue::Type::IMap;
+	case CP_Decimal: return RpcValue::Type::Decimal;
+	case CP_Blob_depr: return RpcValue::Type::Blob;
+	default: return RpcValue::Type::Invalid;
+	}
+}
+
+size_t ChainPackView::packedSize() const
+{
+	if(!m_start)
+		return 0;
+	return skip_value(m_start, m_end) - m_start;
+}
+
+ChainPackView ChainPackView::metaValue(RpcValue::Int key) const
+{
+	if(!hasMetaData())
+		return ChainPackView();
+	return findInMap(m_start + 1, m_valueStart, true, key, std::string());
+}
+
+ChainPackView ChainPackView::metaValue(const std::string &key) const
+{
+	if(!hasMetaData())
+		return ChainPackView();
+	return findInMap(m_start + 1, m_valueStart, false, 0, key);
+}
+
+bool ChainPackView::toBool() const
+{
+	ccpcp_unpack_context ctx;
+	unpack_scalar(&ctx, m_valueStart, m_end);
+	switch(ctx.item.type) {
+	case CCPCP_ITEM_BOOLEAN: return ctx.item.as.Bool;
+	case CCPCP_ITEM_INT: return ctx.item.as.Int != 0;
+	case CCPCP_ITEM_UINT: return ctx.item.as.UInt != 0;
+	default: return false;
+	}
+}
+
+int64_t ChainPackView::toInt64() const
+{
+	ccpcp_unpack_context ctx;
+	unpack_scalar(&ctx, m_valueStart, m_end);
+	switch(ctx.item.type) {
+	case CCPCP_ITEM_BOOLEAN: return ctx.item.as.Bool;
+	case CCPCP_ITEM_INT: return ctx.item.as.Int;
+	case CCPCP_ITEM_UINT: return static_cast<int64_t>(ctx.item.as.UInt);
+	case CCPCP_ITEM_DOUBLE: return static_cast<int64_t>(ctx.item.as.Double);
+	case CCPCP_ITEM_DECIMAL: return static_cast<int64_t>(RpcValue::Decimal(ctx.item.as.Decimal.mantisa, ctx.item.as.Decimal.exponent).toDouble());
+	default: return 0;
+	}
+}
+
+uint64_t ChainPackView::toUInt64() const
+{
+	ccpcp_unpack_context ctx;
+	unpack_scalar(&ctx, m_valueStart, m_end);
+	if(ctx.item.type == CCPCP_ITEM_UINT)
+		return ctx.item.as.UInt;
+	return static_cast<uint64_t>(toInt64());
+}
+
+double ChainPackView::toDouble() const
+{
+	ccpcp_unpack_context ctx;
+	unpack_scalar(&ctx, m_valueStart, m_end);
+	switch(ctx.item.type) {
+	case CCPCP_ITEM_INT: return ctx.item.as.Int;
+	case CCPCP_ITEM_UINT: return ctx.item.as.UInt;
+	case CCPCP_ITEM_DOUBLE: return ctx.item.as.Double;
+	case CCPCP_ITEM_DECIMAL: return RpcValue::Decimal(ctx.item.as.Decimal.mantisa, ctx.item.as.Decimal.exponent).toDouble();
+	default: return 0;
+	}
+}
+
+RpcValue::DateTime ChainPackView::toDateTime() const
+{
+	ccpcp_unpack_context ctx;
+	unpack_scalar(&ctx, m_valueStart, m_end);
+	if(ctx.item.type == CCPCP_ITEM_DATE_TIME)
+		return RpcValue::DateTime::fromMSecsSinceEpoch(ctx.item.as.DateTime.msecs_since_epoch, ctx.item.as.DateTime.minutes_from_utc);
+	return RpcValue::DateTime();
+}
+
+ChainPackView::StringView ChainPackView::toStringView() const
+{
+	if(!m_valueStart || ((uint8_t)*m_valueStart != CP_String && (uint8_t)*m_valueStart != CP_Blob_depr))
+		return StringView();
+	ccpcp_unpack_context ctx;
+	ccpcp_unpack_context_init(&ctx, m_valueStart + 1, m_end - m_valueStart - 1, nullptr, nullptr);
+	bool ok;
+	uint64_t len = cchainpack_unpack_uint_data(&ctx, &ok);
+	if(!ok || len > static_cast<uint64_t>(ctx.end - ctx.current))
+		SHVCHP_EXCEPTION("Malformed ChainPack data: string truncated");
+	return StringView(ctx.current, len);
+}
+
+std::string ChainPackView::toString() const
+{
+	if(!m_valueStart)
+		return std::string();
+	uint8_t schema = (uint8_t)*m_valueStart;
+	if(schema == CP_String || schema == CP_Blob_depr)
+		return toStringView().toString();
+	std::string ret;
+	if(schema == CP_CString) {
+		ccpcp_unpack_context ctx;
+		unpack_scalar(&ctx, m_valueStart, m_end);
+		while(ctx.item.type == CCPCP_ITEM_STRING) {
+			const ccpcp_string &it = ctx.item.as.String;
+			ret.append(it.chunk_start, it.chunk_size);
+			if(it.last_chunk)
+				break;
+			cchainpack_unpack_next(&ctx);
+			check_unpack_error(ctx);
+		}
+	}
+	return ret;
+}
+
+RpcValue ChainPackView::toRpcValue() const
+{
+	if(!m_start)
+		return RpcValue();
+	ChainPackReader rd(m_start, m_end - m_start);
+	return rd.read();
+}
+
+ChainPackView ChainPackView::at(RpcValue::Int ix) const
+{
+	switch(type()) {
+	case RpcValue::Type::List: {
+		const_iterator it = begin();
+		for(RpcValue::Int i = 0; i < ix && it != end(); i++)
+			++it;
+		return (ix >= 0 && it != end())? it.value(): ChainPackView();
+	}
+	case RpcValue::Type::IMap:
+		return findInMap(m_valueStart + 1, m_end, true, ix, std::string());
+	default:
+		return ChainPackView();
+	}
+}
+
+ChainPackView ChainPackView::at(const std::string &key) const
+{
+	if(type() != RpcValue::Type::Map)
+		return ChainPackView();
+	return findInMap(m_valueStart + 1, m_end, false, 0, key);
+}
+
+size_t ChainPackView::count() const
+{
+	if(type() == RpcValue::Type::Array) {
+		ccpcp_unpack_context ctx;
+		ccpcp_unpack_context_init(&ctx, m_valueStart + 1, m_end - m_valueStart - 1, nullptr, nullptr);
+		uint64_t n = cchainpack_unpack_uint_data(&ctx, nullptr);
+		check_unpack_error(ctx);
+		return static_cast<size_t>(n);
+	}
+	size_t n = 0;
+	for(const_iterator it = begin(); it != end(); ++it)
+		n++;
+	return n;
+}
+
+ChainPackView::const_iterator ChainPackView::begin() const
+{
+	switch(type()) {
+	case RpcValue::Type::List:
+		return const_iterator(m_valueStart + 1, m_end, false);
+	case RpcValue::Type::Map:
+	case RpcValue::Type::IMap:
+		return const_iterator(m_valueStart + 1, m_end, true);
+	default:
+		return end();
+	}
+}
+
+ChainPackView::const_iterator ChainPackView::end() const
+{
+	return const_iterator(nullptr, m_end, false);
+}
+
+ChainPackView ChainPackView::findInMap(const char *map_begin, const char *end, bool is_imap, RpcValue::Int ikey, const std::string &skey)
+{
+	for(const_iterator it(map_begin, end, true); it != const_iterator(nullptr, end, true); ++it) {
+		ChainPackView k = it.key();
+		RpcValue::Type kt = k.type();
+		if(is_imap) {
+			if((kt == RpcValue::Type::Int || kt == RpcValue::Type::UInt) && k.toInt64() == ikey)
+				return it.value();
+		}
+		else if(kt == RpcValue::Type::String) {
+			StringView sv = k.toStringView();
+			if(sv.data? sv == skey: k.toString() == skey)
+				return it.value();
+		}
+	}
+	return ChainPackView();
+}
+
+} // namespace chainpack
+} // namespace shv
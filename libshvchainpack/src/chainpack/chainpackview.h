@@ -0,0 +1,103 @@
+#pragma once
+
+#include "rpcvalue.h"
+
+namespace shv {
+namespace chainpack {
+
+/// Read-only view of ChainPack encoded value.
+/// Nothing is decoded until asked for, unused subtrees are skipped by scanning.
+/// Viewed data must stay valid during the view lifetime.
+class SHVCHAINPACK_DECL_EXPORT ChainPackView
+{
+public:
+	struct StringView
+	{
+		const char *data = nullptr;
+		size_t size = 0;
+
+		StringView() {}
+		StringView(const char *d, size_t sz) : data(d), size(sz) {}
+
+		bool operator==(const std::string &s) const {return s.size() == size && s.compare(0, size, data, size) == 0;}
+		std::string toString() const {return std::string(data, size);}
+	};
+
+	class SHVCHAINPACK_DECL_EXPORT const_iterator
+	{
+		friend class ChainPackView;
+	public:
+		/// map key, invalid view for List
+		ChainPackView key() const;
+		ChainPackView value() const;
+		ChainPackView operator*() const {return value();}
+
+		const_iterator& operator++();
+		bool operator==(const const_iterator &o) const {return m_pos == o.m_pos;}
+		bool operator!=(const const_iterator &o) const {return m_pos != o.m_pos;}
+	private:
+		const_iterator(const char *pos, const char *end, bool is_map);
+		void normalize();
+		const char* valueStart() const;
+	private:
+		const char *m_pos = nullptr;
+		const char *m_end = nullptr;
+		bool m_isMap = false;
+	};
+public:
+	ChainPackView() {}
+	/// view of value packed at the beginning of the data
+	ChainPackView(const char *data, size_t length);
+	ChainPackView(const std::string &data) : ChainPackView(data.data(), data.size()) {}
+
+	bool isValid() const {return m_valueStart != nullptr;}
+	RpcValue::Type type() const;
+	bool isNull() const {return type() == RpcValue::Type::Null;}
+	bool isString() const {return type() == RpcValue::Type::String;}
+	bool isList() const {return type() == RpcValue::Type::List;}
+	/// typed array elements have no own packing schema, use toRpcValue() to access them
+	bool isArray() const {return type() == RpcValue::Type::Array;}
+	bool isMap() const {return type() == RpcValue::Type::Map;}
+	bool isIMap() const {return type() == RpcValue::Type::IMap;}
+
+	/// packed data of the value including meta data
+	const char* packedData() const {return m_start;}
+	size_t packedSize() const;
+
+	bool hasMetaData() const {return m_valueStart != m_start;}
+	ChainPackView metaValue(RpcValue::Int key) const;
+	ChainPackView metaValue(const std::string &key) const;
+
+	bool toBool() const;
+	RpcValue::Int toInt() const {return static_cast<RpcValue::Int>(toInt64());}
+	RpcValue::UInt toUInt() const {return static_cast<RpcValue::UInt>(toUInt64());}
+	int64_t toInt64() const;
+	uint64_t toUInt64() const;
+	double toDouble() const;
+	RpcValue::DateTime toDateTime() const;
+	/// zero copy string access, works for String and Blob packing schema only,
+	/// CString has to be unescaped, use toString() for it
+	StringView toStringView() const;
+	std::string toString() const;
+	/// decode value including meta data
+	RpcValue toRpcValue() const;
+
+	/// List element or IMap value
+	ChainPackView at(RpcValue::Int ix) const;
+	ChainPackView at(const std::string &key) const;
+	ChainPackView operator[](RpcValue::Int ix) const {return at(ix);}
+	ChainPackView operator[](const std::string &key) const {return at(key);}
+	size_t count() const;
+
+	const_iterator begin() const;
+	const_iterator end() const;
+private:
+	static ChainPackView findInMap(const char *map_begin, const char *end, bool is_imap, RpcValue::Int ikey, const std::string &skey);
+private:
+	const char *m_start = nullptr;
+	const char *m_valueStart = nullptr;
+	const char *m_end = nullptr;
+};
+
+} // namespace chainpack
+} // namespace shv
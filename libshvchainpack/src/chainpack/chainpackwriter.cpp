@@ -1,4 +1,5 @@
 #include "chainpackwriter.h"
+#include "chainpack.h"
 #include "cpon.h"
 #include "exception.h"
 
@@ -20,38 +21,46 @@ void ChainPackWriter::writeUIntData(uint64_t n)
 
 void ChainPackWriter::write(const RpcValue &value)
 {
-	if(!value.metaData().isEmpty()) {
-		write(value.metaData());
-	}
-	switch (value.type()) {
-	case RpcValue::Type::Null: write_p(nullptr); break;
-	case RpcValue::Type::UInt: write_p(value.toUInt64()); break;
-	case RpcValue::Type::Int: write_p(value.toInt64()); break;
-	case RpcValue::Type::Double: write_p(value.toDouble()); break;
-	case RpcValue::Type::Bool: write_p(value.toBool()); break;
-	//case RpcValue::Type::Blob: write_p(value.toBlob()); break;
-	case RpcValue::Type::String: write_p(value.toString()); break;
-	case RpcValue::Type::DateTime: write_p(value.toDateTime()); break;
-	case RpcValue::Type::List: write_p(value.toList()); break;
-	case RpcValue::Type::Map: write_p(value.toMap()); break;
-	case RpcValue::Type::IMap: write_p(value.toIMap()); break;
-	case RpcValue::Type::Decimal: write_p(value.toDecimal()); break;
-	case RpcValue::Type::Invalid:
-		if(WRITE_INVALID_AS_NULL) {
-			write_p(nullptr);
+	struct Visitor
+	{
+		ChainPackWriter *wr;
+		void operator()() const {
+			if(WRITE_INVALID_AS_NULL) {
+				wr->write_p(nullptr);
+			}
 		}
-		break;
+		void operator()(std::nullptr_t) const { wr->write_p(nullptr); }
+		void operator()(uint64_t val) const { wr->write_p(val); }
+		void operator()(int64_t val) const { wr->write_p(val); }
+		void operator()(double val) const { wr->write_p(val); }
+		void operator()(bool val) const { wr->write_p(val); }
+		void operator()(const RpcValue::DateTime &val) const { wr->write_p(val); }
+		void operator()(const RpcValue::Decimal &val) const { wr->write_p(val); }
+		void operator()(const RpcValue::String &val) const { wr->write_p(val); }
+		void operator()(const RpcValue::Blob &val) const { wr->write_p(val); }
+		void operator()(const RpcValue::List &val) const { wr->write_p(val); }
+		void operator()(const RpcValue::Array &val) const { wr->write_p(val); }
+		void operator()(const RpcValue::Map &val) const { wr->write_p(val); }
+		void operator()(const RpcValue::IMap &val) const { wr->write_p(val); }
+	};
+	const RpcValue::MetaData &meta_data = value.metaData();
+	if(!meta_data.isEmpty()) {
+		write(meta_data);
 	}
+	if(const RpcValue::Blob *str = value.stringData()) {
+		cchainpack_pack_string(&m_outCtx, str->data(), str->size());
+		return;
+	}
+	value.visit(Visitor{this});
 }
 
 void ChainPackWriter::write(const RpcValue::MetaData &meta_data)
 {
 	if(!meta_data.isEmpty()) {
 		cchainpack_pack_meta_begin(&m_outCtx);
-		const RpcValue::IMap &cim = meta_data.iValues();
-		for (const auto &kv : cim) {
-			writeMapElement(kv.first, kv.second);
-		}
+		meta_data.forEachIValue([this](RpcValue::Int key, const RpcValue &val) {
+			writeMapElement(key, val);
+		});
 		const RpcValue::Map &csm = meta_data.sValues();
 		for (const auto &kv : csm) {
 			writeMapElement(kv.first, kv.second);
@@ -174,6 +183,14 @@ ChainPackWriter &ChainPackWriter::write_p(const std::string &value)
 	return *this;
 }
 
+ChainPackWriter &ChainPackWriter::write_p(const RpcValue::Blob &value)
+{
+	ccpcp_pack_copy_byte(&m_outCtx, CP_Blob_depr);
+	cchainpack_pack_uint_data(&m_outCtx, value.size());
+	writeBytes(value.data(), value.size());
+	return *this;
+}
+
 ChainPackWriter &ChainPackWriter::write_p(const RpcValue::Map &values)
 {
 	writeContainerBegin(RpcValue::Type::Map);
@@ -205,5 +222,34 @@ ChainPackWriter &ChainPackWriter::write_p(const RpcValue::List &values)
 	return *this;
 }
 
+ChainPackWriter &ChainPackWriter::write_p(const RpcValue::Array &values)
+{
+	switch(values.type()) {
+	case RpcValue::Type::Int:
+		ccpcp_pack_copy_byte(&m_outCtx, CP_Int | ChainPack::ARRAY_FLAG_MASK);
+		cchainpack_pack_uint_data(&m_outCtx, values.size());
+		for(int64_t n : values.intValues())
+			cchainpack_pack_int_data(&m_outCtx, n);
+		break;
+	case RpcValue::Type::UInt:
+		ccpcp_pack_copy_byte(&m_outCtx, CP_UInt | ChainPack::ARRAY_FLAG_MASK);
+		cchainpack_pack_uint_data(&m_outCtx, values.size());
+		for(uint64_t n : values.uintValues())
+			cchainpack_pack_uint_data(&m_outCtx, n);
+		break;
+	case RpcValue::Type::Double:
+		ccpcp_pack_copy_byte(&m_outCtx, CP_Double | ChainPack::ARRAY_FLAG_MASK);
+		cchainpack_pack_uint_data(&m_outCtx, values.size());
+		cchainpack_pack_double_data(&m_outCtx, values.doubleValues().data(), values.size());
+		break;
+	default:
+		// array without element type cannot be typed, write it as empty list
+		writeContainerBegin(RpcValue::Type::List);
+		writeContainerEnd();
+		break;
+	}
+	return *this;
+}
+
 } // namespace chainpack
 } // namespace shv
@@ -10,6 +10,7 @@ class SHVCHAINPACK_DECL_EXPORT ChainPackWriter : public shv::chainpack::Abstract
 	using Super = AbstractStreamWriter;
 public:
 	ChainPackWriter(std::ostream &out) : Super(out) {}
+	ChainPackWriter(std::string &out) : Super(out) {}
 
 	ChainPackWriter& operator <<(const RpcValue &value) {write(value); return *this;}
 	ChainPackWriter& operator <<(const RpcValue::MetaData &meta_data) {write(meta_data); return *this;}
@@ -40,9 +41,9 @@ private:
 	ChainPackWriter& write_p(RpcValue::Decimal value);
 	ChainPackWriter& write_p(RpcValue::DateTime value);
 	ChainPackWriter& write_p(const std::string &value);
-	//ChainPackWriter& write_p(const RpcValue::Blob &value);
+	ChainPackWriter& write_p(const RpcValue::Blob &value);
 	ChainPackWriter& write_p(const RpcValue::List &values);
-	//ChainPackWriter& write_p(const RpcValue::Array &values);
+	ChainPackWriter& write_p(const RpcValue::Array &values);
 	ChainPackWriter& write_p(const RpcValue::Map &values);
 	ChainPackWriter& write_p(const RpcValue::IMap &values);
 };
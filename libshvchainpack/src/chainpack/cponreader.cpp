@@ -1,5 +1,6 @@
 #include "cpon.h"
 #include "cponreader.h"
+#include "atomtable.h"
 #include "../../c/ccpon.h"
 
 #include <iostream>
@@ -9,15 +10,15 @@ namespace shv {
 namespace chainpack {
 
 #define PARSE_EXCEPTION(msg) {\
-	char buff[40]; \
-	m_in.readsome(buff, sizeof(buff)); \
+	long pos = readPosition(); \
+	std::string near_to = peekData(40); \
 	if(exception_aborts) { \
 		std::clog << __FILE__ << ':' << __LINE__;  \
-		std::clog << ' ' << (msg) << " at pos: " << m_in.tellg() << " near to: " << buff << std::endl; \
+		std::clog << ' ' << (msg) << " at pos: " << pos << " near to: " << near_to << std::endl; \
 		abort(); \
 	} \
 	else { \
-		throw CponReader::ParseException(std::string("Cpon ") + msg + std::string(" at pos: ") + std::to_string(m_in.tellg()) + " near to: " + buff, m_in.tellg()); \
+		throw CponReader::ParseException(std::string("Cpon ") + msg + std::string(" at pos: ") + std::to_string(pos) + " near to: " + near_to, pos); \
 	} \
 }
 
@@ -56,6 +57,14 @@ void CponReader::unpackNext()
 		PARSE_EXCEPTION("Parse error: " + std::to_string(m_inCtx.err_no) + " " + ccpcp_error_string(m_inCtx.err_no) + " - " + std::string(m_inCtx.err_msg));
 }
 
+bool CponReader::unpackNextEvent(EventHandler &handler, bool &is_blob)
+{
+	(void)handler;
+	is_blob = false;
+	unpackNext();
+	return true;
+}
+
 void CponReader::read(RpcValue &val, std::string &err)
 {
 	err.clear();
@@ -87,13 +96,26 @@ RpcValue::DateTime CponReader::readDateTime()
 }
 */
 void CponReader::read(RpcValue &val)
+{
+	// arena is activated once for whole value tree
+	RpcValueArena::Scope arena_scope(m_arena);
+	readValue(val);
+}
+
+void CponReader::read(RpcValue::MetaData &meta_data)
+{
+	RpcValueArena::Scope arena_scope(m_arena);
+	readMetaData(meta_data);
+}
+
+void CponReader::readValue(RpcValue &val)
 {
 	//if (m_depth > MAX_RECURSION_DEPTH)
 	//	PARSE_EXCEPTION("maximum nesting depth exceeded");
 	//DepthScope{m_depth};
 
 	RpcValue::MetaData md;
-	read(md);
+	readMetaData(md);
 
 	unpackNext();
 
@@ -123,16 +145,22 @@ void CponReader::read(RpcValue &val)
 	}
 	case CCPCP_ITEM_STRING: {
 		ccpcp_string *it = &(m_inCtx.item.as.String);
-		std::string str;
-		while(m_inCtx.item.type == CCPCP_ITEM_STRING) {
-			str += std::string(it->chunk_start, it->chunk_size);
-			if(it->last_chunk)
-				break;
+		if(it->last_chunk && isInternedString(it->chunk_size)) {
+			val = AtomTable::atom(it->chunk_start, it->chunk_size);
+			break;
+		}
+		// string without escapes contiguous in input data comes in single chunk
+		std::string str(it->chunk_start, it->chunk_size);
+		while(!it->last_chunk) {
 			unpackNext();
 			if(m_inCtx.item.type != CCPCP_ITEM_STRING)
 				PARSE_EXCEPTION("Unfinished string key");
+			str.append(it->chunk_start, it->chunk_size);
 		}
-		val = str;
+		if(isInternedString(str.size()))
+			val = AtomTable::atom(str);
+		else
+			val = std::move(str);
 		break;
 	}
 	case CCPCP_ITEM_BOOLEAN: {
@@ -200,7 +228,7 @@ void CponReader::parseList(RpcValue &val)
 	RpcValue::List lst;
 	while (true) {
 		RpcValue v;
-		read(v);
+		readValue(v);
 		if(m_inCtx.item.type == CCPCP_ITEM_CONTAINER_END) {
 			m_inCtx.item.type = CCPCP_ITEM_INVALID; // to parse something like [[]]
 			break;
@@ -214,13 +242,15 @@ void CponReader::parseMetaData(RpcValue::MetaData &meta_data)
 {
 	while (true) {
 		RpcValue key;
-		read(key);
+		m_readingMapKey = true;
+		readValue(key);
+		m_readingMapKey = false;
 		if(m_inCtx.item.type == CCPCP_ITEM_CONTAINER_END) {
 			m_inCtx.item.type = CCPCP_ITEM_INVALID;
 			break;
 		}
 		RpcValue val;
-		read(val);
+		readValue(val);
 		if(key.isString())
 			meta_data.setValue(key.toString(), val);
 		else
@@ -230,42 +260,47 @@ void CponReader::parseMetaData(RpcValue::MetaData &meta_data)
 
 void CponReader::parseMap(RpcValue &val)
 {
-	RpcValue::Map map;
+	// pairs are sorted once, decoded keys can come in any order
+	RpcValue::Map::container_type pairs;
 	while (true) {
 		RpcValue key;
-		read(key);
+		m_readingMapKey = true;
+		readValue(key);
+		m_readingMapKey = false;
 		if(m_inCtx.item.type == CCPCP_ITEM_CONTAINER_END) {
 			m_inCtx.item.type = CCPCP_ITEM_INVALID;
 			break;
 		}
 		RpcValue val;
-		read(val);
-		map[key.toString()] = val;
+		readValue(val);
+		pairs.emplace_back(key.toString(), std::move(val));
 	}
-	val = map;
+	val = RpcValue::Map(std::move(pairs));
 }
 
 void CponReader::parseIMap(RpcValue &val)
 {
-	RpcValue::IMap map;
+	// pairs are sorted once, decoded keys can come in any order
+	RpcValue::IMap::container_type pairs;
 	while (true) {
 		RpcValue key;
-		read(key);
+		readValue(key);
 		if(m_inCtx.item.type == CCPCP_ITEM_CONTAINER_END) {
 			m_inCtx.item.type = CCPCP_ITEM_INVALID;
 			break;
 		}
 		RpcValue val;
-		read(val);
-		map[key.toInt()] = val;
+		readValue(val);
+		pairs.emplace_back(key.toInt(), std::move(val));
 	}
-	val = map;
+	val = RpcValue::IMap(std::move(pairs));
 }
 
-void CponReader::read(RpcValue::MetaData &meta_data)
+void CponReader::readMetaData(RpcValue::MetaData &meta_data)
 {
 	const char *c = ccpon_unpack_skip_insignificant(&m_inCtx);
-	m_inCtx.current--;
+	if(c)
+		m_inCtx.current--;
 	if(c && *c == '<') {
 		ccpon_unpack_next(&m_inCtx);
 		parseMetaData(meta_data);
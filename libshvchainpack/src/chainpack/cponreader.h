@@ -15,6 +15,7 @@ class SHVCHAINPACK_DECL_EXPORT CponReader : public AbstractStreamReader
 	using Super = AbstractStreamReader;
 public:
 	CponReader(std::istream &in) : Super(in) {}
+	CponReader(const char *data, size_t length) : Super(data, length) {}
 
 	CponReader& operator >>(RpcValue &value);
 	CponReader& operator >>(RpcValue::MetaData &meta_data);
@@ -26,8 +27,12 @@ public:
 	void read(RpcValue &val, std::string *err);
 
 	//RpcValue::DateTime readDateTime();
+protected:
+	bool unpackNextEvent(EventHandler &handler, bool &is_blob) override;
 private:
 	void unpackNext();
+	void readValue(RpcValue &val);
+	void readMetaData(RpcValue::MetaData &meta_data);
 
 	void parseList(RpcValue &val);
 	void parseMetaData(RpcValue::MetaData &meta_data);
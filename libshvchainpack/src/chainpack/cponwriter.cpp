@@ -21,79 +21,93 @@ CponWriter::CponWriter(std::ostream &out, const CponWriterOptions &opts)
 	m_outCtx.cpon_options.indent = m_opts.indent().empty()? nullptr: m_opts.indent().data();
 }
 
+CponWriter::CponWriter(std::string &out, const CponWriterOptions &opts)
+	: Super(out)
+	, m_opts(opts)
+{
+	m_outCtx.cpon_options.json_output = opts.isJsonFormat();
+	m_outCtx.cpon_options.indent = m_opts.indent().empty()? nullptr: m_opts.indent().data();
+}
+
 void CponWriter::write(const RpcValue &value)
 {
-	if(!value.metaData().isEmpty()) {
-		write(value.metaData());
-	}
-	switch (value.type()) {
-	case RpcValue::Type::Null: write_p(nullptr); break;
-	case RpcValue::Type::UInt: write_p(value.toUInt64()); break;
-	case RpcValue::Type::Int: write_p(value.toInt64()); break;
-	case RpcValue::Type::Double: write_p(value.toDouble()); break;
-	case RpcValue::Type::Bool: write_p(value.toBool()); break;
-	//case RpcValue::Type::Blob: write(value.toBlob()); break;
-	case RpcValue::Type::String: write_p(value.toString()); break;
-	case RpcValue::Type::DateTime: write_p(value.toDateTime()); break;
-	case RpcValue::Type::List: write_p(value.toList()); break;
-	case RpcValue::Type::Map: write_p(value.toMap()); break;
-	case RpcValue::Type::IMap: write_p(value.toIMap(), &value.metaData()); break;
-	case RpcValue::Type::Decimal: write_p(value.toDecimal()); break;
-	case RpcValue::Type::Invalid:
-		if(WRITE_INVALID_AS_NULL) {
-			write_p(nullptr);
+	struct Visitor
+	{
+		CponWriter *wr;
+		const RpcValue::MetaData *metaData;
+		void operator()() const {
+			if(WRITE_INVALID_AS_NULL) {
+				wr->write_p(nullptr);
+			}
 		}
-		break;
+		void operator()(std::nullptr_t) const { wr->write_p(nullptr); }
+		void operator()(uint64_t val) const { wr->write_p(val); }
+		void operator()(int64_t val) const { wr->write_p(val); }
+		void operator()(double val) const { wr->write_p(val); }
+		void operator()(bool val) const { wr->write_p(val); }
+		void operator()(const RpcValue::DateTime &val) const { wr->write_p(val); }
+		void operator()(const RpcValue::Decimal &val) const { wr->write_p(val); }
+		void operator()(const RpcValue::String &val) const { wr->write_p(val); }
+		void operator()(const RpcValue::Blob &val) const { wr->write_p(val); }
+		void operator()(const RpcValue::List &val) const { wr->write_p(val); }
+		void operator()(const RpcValue::Array &val) const { wr->write_p(val); }
+		void operator()(const RpcValue::Map &val) const { wr->write_p(val); }
+		void operator()(const RpcValue::IMap &val) const { wr->write_p(val, metaData); }
+	};
+	const RpcValue::MetaData &meta_data = value.metaData();
+	if(!meta_data.isEmpty()) {
+		write(meta_data);
 	}
+	if(const RpcValue::Blob *str = value.stringData()) {
+		ccpon_pack_string(&m_outCtx, str->data(), str->size());
+		return;
+	}
+	value.visit(Visitor{this, &meta_data});
 }
 
 void CponWriter::write(const RpcValue::MetaData &meta_data)
 {
 	if(!meta_data.isEmpty()) {
 		writeMetaBegin();
-		const RpcValue::IMap &cim = meta_data.iValues();
-		if(!cim.empty()) {
-			for (const auto &kv : cim) {
-				if(m_opts.isTranslateIds()) {
-					ContainerState &cs = m_containerStates[m_containerStates.size() - 1];
-					ccpon_pack_field_delim(&m_outCtx, cs.elementCount++ == 0);
-					int nsid = meta_data.metaTypeNameSpaceId();
-					int mtid = meta_data.metaTypeId();
-					int tag = kv.first;
-					const meta::MetaInfo &tag_info = meta::registeredType(nsid, mtid).tagById(tag);
-					if(tag_info.isValid())
-						ccpcp_pack_copy_bytes(&m_outCtx, tag_info.name, ::strlen(tag_info.name));
+		meta_data.forEachIValue([this, &meta_data](RpcValue::Int key, const RpcValue &meta_val) {
+			if(m_opts.isTranslateIds()) {
+				ContainerState &cs = m_containerStates[m_containerStates.size() - 1];
+				ccpon_pack_field_delim(&m_outCtx, cs.elementCount++ == 0);
+				int nsid = meta_data.metaTypeNameSpaceId();
+				int mtid = meta_data.metaTypeId();
+				int tag = key;
+				const meta::MetaInfo &tag_info = meta::registeredType(nsid, mtid).tagById(tag);
+				if(tag_info.isValid())
+					ccpcp_pack_copy_bytes(&m_outCtx, tag_info.name, ::strlen(tag_info.name));
+				else
+					write(tag);
+				ccpon_pack_key_val_delim(&m_outCtx);
+				if(tag == meta::Tag::MetaTypeNameSpaceId) {
+					int id = meta_val.toInt();
+					const meta::MetaNameSpace &type = meta::registeredNameSpace(nsid);
+					const char *n = type.name();
+					if(n[0])
+						ccpcp_pack_copy_bytes(&m_outCtx, n, ::strlen(n));
+					else
+						write(id);
+				}
+				else if(tag == meta::Tag::MetaTypeId) {
+					int id = meta_val.toInt();
+					const meta::MetaType &type = meta::registeredType(nsid, id);
+					const char *n = type.name();
+					if(n[0])
+						ccpcp_pack_copy_bytes(&m_outCtx, n, ::strlen(n));
 					else
-						write(tag);
-					ccpon_pack_key_val_delim(&m_outCtx);
-					RpcValue meta_val = kv.second;
-					if(tag == meta::Tag::MetaTypeNameSpaceId) {
-						int id = meta_val.toInt();
-						const meta::MetaNameSpace &type = meta::registeredNameSpace(nsid);
-						const char *n = type.name();
-						if(n[0])
-							ccpcp_pack_copy_bytes(&m_outCtx, n, ::strlen(n));
-						else
-							write(id);
-					}
-					else if(tag == meta::Tag::MetaTypeId) {
-						int id = meta_val.toInt();
-						const meta::MetaType &type = meta::registeredType(nsid, id);
-						const char *n = type.name();
-						if(n[0])
-							ccpcp_pack_copy_bytes(&m_outCtx, n, ::strlen(n));
-						else
-							write(id);
-					}
-					else {
-						write(meta_val);
-					}
+						write(id);
 				}
 				else {
-					writeMapElement(kv.first, kv.second);
+					write(meta_val);
 				}
 			}
-		}
+			else {
+				writeMapElement(key, meta_val);
+			}
+		});
 		const RpcValue::Map &csm = meta_data.sValues();
 		for (const auto &kv : csm) {
 			writeMapElement(kv.first, kv.second);
@@ -251,6 +265,30 @@ CponWriter &CponWriter::write_p(const std::string &value)
 	return *this;
 }
 
+CponWriter &CponWriter::write_p(const RpcValue::Blob &value)
+{
+	// Cpon has no blob literal, blob is written as string
+	if(m_opts.isHexBlob()) {
+		static const char hex_digits[] = "0123456789abcdef";
+		ccpon_pack_string_start(&m_outCtx, nullptr, 0);
+		char buff[64];
+		for(size_t i = 0; i < value.size(); ) {
+			size_t n = 0;
+			for(; n < sizeof(buff) && i < value.size(); ++i) {
+				uint8_t b = static_cast<uint8_t>(value.data()[i]);
+				buff[n++] = hex_digits[b >> 4];
+				buff[n++] = hex_digits[b & 15];
+			}
+			ccpcp_pack_copy_bytes(&m_outCtx, buff, n);
+		}
+		ccpon_pack_string_finish(&m_outCtx);
+	}
+	else {
+		ccpon_pack_string(&m_outCtx, value.data(), value.size());
+	}
+	return *this;
+}
+
 CponWriter &CponWriter::write_p(const RpcValue::Map &values)
 {
 	writeContainerBegin(RpcValue::Type::Map);
@@ -300,5 +338,23 @@ CponWriter &CponWriter::write_p(const RpcValue::List &values)
 	return *this;
 }
 
+CponWriter &CponWriter::write_p(const RpcValue::Array &values)
+{
+	// Cpon has no typed array notation, array is written as a list
+	writeContainerBegin(RpcValue::Type::List);
+	for (size_t ix = 0; ix < values.size(); ix++) {
+		ContainerState &cs = m_containerStates[m_containerStates.size() - 1];
+		ccpon_pack_field_delim(&m_outCtx, cs.elementCount++ == 0);
+		switch(values.type()) {
+		case RpcValue::Type::Int: write_p(values.intValues()[ix]); break;
+		case RpcValue::Type::UInt: write_p(values.uintValues()[ix]); break;
+		case RpcValue::Type::Double: write_p(values.doubleValues()[ix]); break;
+		default: break;
+		}
+	}
+	writeContainerEnd();
+	return *this;
+}
+
 } // namespace chainpack
 } // namespace shv
@@ -36,6 +36,8 @@ class SHVCHAINPACK_DECL_EXPORT CponWriter : public AbstractStreamWriter
 public:
 	CponWriter(std::ostream &out) : Super(out) {}
 	CponWriter(std::ostream &out, const CponWriterOptions &opts);
+	CponWriter(std::string &out) : Super(out) {}
+	CponWriter(std::string &out, const CponWriterOptions &opts);
 
 	CponWriter& operator <<(const RpcValue &value) {write(value); return *this;}
 	CponWriter& operator <<(const RpcValue::MetaData &meta_data) {write(meta_data); return *this;}
@@ -66,9 +68,9 @@ private:
 	CponWriter& write_p(RpcValue::Decimal value);
 	CponWriter& write_p(RpcValue::DateTime value);
 	CponWriter& write_p(const std::string &value);
-	//CponWriter& write(const RpcValue::Blob &value);
+	CponWriter& write_p(const RpcValue::Blob &value);
 	CponWriter& write_p(const RpcValue::List &values);
-	//CponWriter& write(const RpcValue::Array &values);
+	CponWriter& write_p(const RpcValue::Array &values);
 	CponWriter& write_p(const RpcValue::Map &values);
 	CponWriter& write_p(const RpcValue::IMap &values, const RpcValue::MetaData *meta_data = nullptr);
 private:
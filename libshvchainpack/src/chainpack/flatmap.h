@@ -0,0 +1,162 @@
+#pragma once
+
+#include <algorithm>
+#include <initializer_list>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace shv {
+namespace chainpack {
+
+/// Associative container with key-value pairs sorted by key in one contiguous vector.
+/// It provides the subset of std::map API used with RpcValue maps.
+/// Lookup is binary search, inserting keys in ascending order is amortized O(1),
+/// inserting in the middle moves the tail, which is cheap for small maps only.
+/// Large maps with keys in random order should be built at once from pairs (decoders do so),
+/// they are sorted once then.
+/// Unlike std::map, iterators and references are invalidated by insertion and erasure.
+template<typename Key, typename T>
+class FlatMap
+{
+public:
+	using key_type = Key;
+	using mapped_type = T;
+	using value_type = std::pair<Key, T>;
+	using container_type = std::vector<value_type>;
+	using size_type = typename container_type::size_type;
+	using iterator = typename container_type::iterator;
+	using const_iterator = typename container_type::const_iterator;
+public:
+	FlatMap() {}
+	/// pairs in any order, the last of pairs with equal keys is kept
+	explicit FlatMap(container_type &&pairs) : m_data(std::move(pairs)) { sortUnique(m_data.begin(), true); }
+	/// the first of pairs with equal keys is kept like in std::map
+	FlatMap(std::initializer_list<value_type> init) : m_data(init) { sortUnique(m_data.begin(), false); }
+	template<typename InputIt>
+	FlatMap(InputIt first, InputIt last) : m_data(first, last) { sortUnique(m_data.begin(), false); }
+
+	iterator begin() { return m_data.begin(); }
+	iterator end() { return m_data.end(); }
+	const_iterator begin() const { return m_data.begin(); }
+	const_iterator end() const { return m_data.end(); }
+	const_iterator cbegin() const { return m_data.cbegin(); }
+	const_iterator cend() const { return m_data.cend(); }
+
+	bool empty() const { return m_data.empty(); }
+	size_type size() const { return m_data.size(); }
+	void clear() { m_data.clear(); }
+	void reserve(size_type n) { m_data.reserve(n); }
+	void swap(FlatMap &other) { m_data.swap(other.m_data); }
+
+	iterator lower_bound(const Key &key)
+	{
+		// ascending insertion fast path
+		if(m_data.empty() || m_data.back().first < key)
+			return m_data.end();
+		return std::lower_bound(m_data.begin(), m_data.end(), key, [](const value_type &kv, const Key &k) { return kv.first < k; });
+	}
+	const_iterator lower_bound(const Key &key) const
+	{
+		return const_cast<FlatMap*>(this)->lower_bound(key);
+	}
+	iterator find(const Key &key)
+	{
+		iterator it = lower_bound(key);
+		return (it == m_data.end() || key < it->first)? m_data.end(): it;
+	}
+	const_iterator find(const Key &key) const
+	{
+		return const_cast<FlatMap*>(this)->find(key);
+	}
+	size_type count(const Key &key) const { return find(key) == end()? 0: 1; }
+
+	T& at(const Key &key)
+	{
+		iterator it = find(key);
+		if(it == m_data.end())
+			throw std::out_of_range("FlatMap::at");
+		return it->second;
+	}
+	const T& at(const Key &key) const
+	{
+		return const_cast<FlatMap*>(this)->at(key);
+	}
+	T& operator[](const Key &key)
+	{
+		return insert(value_type(key, T())).first->second;
+	}
+	T& operator[](Key &&key)
+	{
+		return insert(value_type(std::move(key), T())).first->second;
+	}
+
+	std::pair<iterator, bool> insert(const value_type &kv)
+	{
+		return insert(value_type(kv));
+	}
+	std::pair<iterator, bool> insert(value_type &&kv)
+	{
+		iterator it = lower_bound(kv.first);
+		if(it != m_data.end() && !(kv.first < it->first))
+			return std::make_pair(it, false);
+		return std::make_pair(m_data.insert(it, std::move(kv)), true);
+	}
+	/// existing keys are kept like in std::map
+	template<typename InputIt>
+	void insert(InputIt first, InputIt last)
+	{
+		size_type n = m_data.size();
+		m_data.insert(m_data.end(), first, last);
+		sortUnique(m_data.begin() + static_cast<typename container_type::difference_type>(n), false);
+	}
+	template<typename... Args>
+	std::pair<iterator, bool> emplace(Args&&... args)
+	{
+		return insert(value_type(std::forward<Args>(args)...));
+	}
+
+	iterator erase(const_iterator pos) { return m_data.erase(pos); }
+	size_type erase(const Key &key)
+	{
+		iterator it = find(key);
+		if(it == m_data.end())
+			return 0;
+		m_data.erase(it);
+		return 1;
+	}
+
+	bool operator==(const FlatMap &other) const { return m_data == other.m_data; }
+	bool operator!=(const FlatMap &other) const { return m_data != other.m_data; }
+private:
+	static bool keyLess(const value_type &a, const value_type &b) { return a.first < b.first; }
+	/// sorts pairs from mid on, merges them with sorted pairs before mid and removes equal keys,
+	/// the last or the first of equal keys is kept
+	void sortUnique(iterator mid, bool keep_last)
+	{
+		if(mid == m_data.end())
+			return;
+		if(std::adjacent_find(mid, m_data.end(), [](const value_type &a, const value_type &b) { return !(a.first < b.first); }) != m_data.end())
+			std::stable_sort(mid, m_data.end(), keyLess);
+		if(mid != m_data.begin() && mid != m_data.end() && !((mid - 1)->first < mid->first))
+			std::inplace_merge(m_data.begin(), mid, m_data.end(), keyLess);
+		if(m_data.size() < 2)
+			return;
+		iterator out = m_data.begin();
+		for(iterator it = out + 1; it != m_data.end(); ++it) {
+			if(out->first < it->first) {
+				if(++out != it)
+					*out = std::move(*it);
+			}
+			else if(keep_last) {
+				*out = std::move(*it);
+			}
+		}
+		m_data.erase(out + 1, m_data.end());
+	}
+private:
+	container_type m_data;
+};
+
+} // namespace chainpack
+} // namespace shv
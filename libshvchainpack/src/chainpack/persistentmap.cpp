@@ -0,0 +1,238 @@
+#include "persistentmap.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace shv {
+namespace chainpack {
+
+struct PersistentMap::Node
+{
+	using Leaf = std::pair<RpcValue::String, RpcValue>;
+	/// either child node or key-value leaf
+	struct Entry
+	{
+		std::shared_ptr<const Node> node;
+		std::shared_ptr<const Leaf> leaf;
+	};
+	/// bit n is set when entry for hash chunk n exists, entries are ordered by chunk,
+	/// collision node (all hash bits consumed) has bitmap 0 and leaves only
+	uint32_t bitmap = 0;
+	std::vector<Entry> entries;
+};
+
+namespace {
+using Node = PersistentMap::Node;
+using NodePtr = std::shared_ptr<const Node>;
+using LeafPtr = std::shared_ptr<const Node::Leaf>;
+
+constexpr unsigned CHUNK_BITS = 5;
+constexpr unsigned HASH_BITS = sizeof(size_t) * 8;
+
+size_t key_hash(const RpcValue::String &key)
+{
+	return std::hash<RpcValue::String>()(key);
+}
+
+unsigned popcount(uint32_t x)
+{
+#ifdef __GNUC__
+	return static_cast<unsigned>(__builtin_popcount(x));
+#else
+	x = x - ((x >> 1) & 0x55555555u);
+	x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+	return (((x + (x >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24;
+#endif
+}
+
+uint32_t chunk_bit(size_t hash, unsigned shift)
+{
+	return 1u << ((hash >> shift) & 31);
+}
+
+/// returns copy of node n with leaf inserted or replaced, nodes on the path only are copied
+NodePtr insert(const Node *n, size_t hash, unsigned shift, const LeafPtr &leaf, bool &added)
+{
+	std::shared_ptr<Node> ret = n? std::make_shared<Node>(*n): std::make_shared<Node>();
+	if(shift >= HASH_BITS) {
+		for(Node::Entry &e : ret->entries) {
+			if(e.leaf->first == leaf->first) {
+				e.leaf = leaf;
+				return ret;
+			}
+		}
+		ret->entries.push_back(Node::Entry{nullptr, leaf});
+		added = true;
+		return ret;
+	}
+	const uint32_t bit = chunk_bit(hash, shift);
+	const unsigned pos = popcount(ret->bitmap & (bit - 1));
+	if(!(ret->bitmap & bit)) {
+		ret->bitmap |= bit;
+		ret->entries.insert(ret->entries.begin() + pos, Node::Entry{nullptr, leaf});
+		added = true;
+		return ret;
+	}
+	Node::Entry &e = ret->entries[pos];
+	if(e.node) {
+		e.node = insert(e.node.get(), hash, shift + CHUNK_BITS, leaf, added);
+	}
+	else if(e.leaf->first == leaf->first) {
+		e.leaf = leaf;
+	}
+	else {
+		// two keys with the same hash chunk, push both one level down
+		bool moved = false;
+		NodePtr sub = insert(nullptr, key_hash(e.leaf->first), shift + CHUNK_BITS, e.leaf, moved);
+		e.node = insert(sub.get(), hash, shift + CHUNK_BITS, leaf, added);
+		e.leaf.reset();
+	}
+	return ret;
+}
+
+/// returns n if key is not found, nullptr if the node becomes empty
+NodePtr erase(const NodePtr &n, size_t hash, unsigned shift, const RpcValue::String &key, bool &removed)
+{
+	if(shift >= HASH_BITS) {
+		for(size_t i = 0; i < n->entries.size(); ++i) {
+			if(n->entries[i].leaf->first == key) {
+				removed = true;
+				if(n->entries.size() == 1)
+					return nullptr;
+				std::shared_ptr<Node> ret = std::make_shared<Node>(*n);
+				ret->entries.erase(ret->entries.begin() + static_cast<long>(i));
+				return ret;
+			}
+		}
+		return n;
+	}
+	const uint32_t bit = chunk_bit(hash, shift);
+	if(!(n->bitmap & bit))
+		return n;
+	const unsigned pos = popcount(n->bitmap & (bit - 1));
+	const Node::Entry &e = n->entries[pos];
+	NodePtr sub;
+	if(e.node) {
+		sub = erase(e.node, hash, shift + CHUNK_BITS, key, removed);
+		if(!removed)
+			return n;
+	}
+	else if(e.leaf->first == key) {
+		removed = true;
+	}
+	else {
+		return n;
+	}
+	std::shared_ptr<Node> ret = std::make_shared<Node>(*n);
+	if(sub) {
+		ret->entries[pos].node = sub;
+	}
+	else {
+		ret->bitmap &= ~bit;
+		ret->entries.erase(ret->entries.begin() + pos);
+		if(ret->entries.empty())
+			return nullptr;
+	}
+	return ret;
+}
+
+void for_each_leaf(const Node *n, const std::function<void (const Node::Leaf &)> &fn)
+{
+	for(const Node::Entry &e : n->entries) {
+		if(e.node)
+			for_each_leaf(e.node.get(), fn);
+		else
+			fn(*e.leaf);
+	}
+}
+
+std::vector<const Node::Leaf*> sorted_leaves(const Node *root, size_t size)
+{
+	std::vector<const Node::Leaf*> leaves;
+	if(root) {
+		leaves.reserve(size);
+		for_each_leaf(root, [&leaves](const Node::Leaf &leaf) { leaves.push_back(&leaf); });
+		std::sort(leaves.begin(), leaves.end(), [](const Node::Leaf *a, const Node::Leaf *b) { return a->first < b->first; });
+	}
+	return leaves;
+}
+}
+
+PersistentMap::PersistentMap(const RpcValue::Map &map)
+{
+	for(const auto &kv : map)
+		setValue(kv.first, kv.second);
+}
+
+const RpcValue *PersistentMap::find(const RpcValue::String &key) const
+{
+	if(!m_root)
+		return nullptr;
+	const size_t hash = key_hash(key);
+	const Node *n = m_root.get();
+	for(unsigned shift = 0; shift < HASH_BITS; shift += CHUNK_BITS) {
+		const uint32_t bit = chunk_bit(hash, shift);
+		if(!(n->bitmap & bit))
+			return nullptr;
+		const Node::Entry &e = n->entries[popcount(n->bitmap & (bit - 1))];
+		if(e.leaf)
+			return (e.leaf->first == key)? &e.leaf->second: nullptr;
+		n = e.node.get();
+	}
+	for(const Node::Entry &e : n->entries) {
+		if(e.leaf->first == key)
+			return &e.leaf->second;
+	}
+	return nullptr;
+}
+
+RpcValue PersistentMap::value(const RpcValue::String &key, const RpcValue &default_val) const
+{
+	const RpcValue *v = find(key);
+	return v? *v: default_val;
+}
+
+void PersistentMap::setValue(const RpcValue::String &key, const RpcValue &val)
+{
+	const size_t hash = key_hash(key);
+	if(val.isValid()) {
+		bool added = false;
+		m_root = insert(m_root.get(), hash, 0, std::make_shared<Node::Leaf>(key, val), added);
+		if(added)
+			m_size++;
+	}
+	else if(m_root) {
+		bool removed = false;
+		m_root = erase(m_root, hash, 0, key, removed);
+		if(removed)
+			m_size--;
+	}
+}
+
+std::vector<RpcValue::String> PersistentMap::keys() const
+{
+	std::vector<RpcValue::String> ret;
+	ret.reserve(m_size);
+	for(const Node::Leaf *leaf : sorted_leaves(m_root.get(), m_size))
+		ret.push_back(leaf->first);
+	return ret;
+}
+
+void PersistentMap::forEach(const std::function<void (const RpcValue::String &, const RpcValue &)> &fn) const
+{
+	if(m_root)
+		for_each_leaf(m_root.get(), [&fn](const Node::Leaf &leaf) { fn(leaf.first, leaf.second); });
+}
+
+RpcValue::Map PersistentMap::toMap() const
+{
+	RpcValue::Map ret;
+	ret.reserve(m_size);
+	// ascending keys are appended
+	for(const Node::Leaf *leaf : sorted_leaves(m_root.get(), m_size))
+		ret.emplace(leaf->first, leaf->second);
+	return ret;
+}
+
+} // namespace chainpack
+} // namespace shv
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "rpcvalue.h"
+
+#include <functional>
+#include <memory>
+
+namespace shv {
+namespace chainpack {
+
+/// Immutable String -> RpcValue map with structural sharing (hash array mapped trie).
+/// Copy (snapshot) is O(1), setValue() copies only O(log n) nodes on the path to the key,
+/// so other copies keep their version. Nodes are never modified after creation,
+/// a snapshot can be read from other threads while new versions are created.
+/// Keys are not ordered, toMap() and keys() sort them.
+class SHVCHAINPACK_DECL_EXPORT PersistentMap
+{
+public:
+	struct Node;
+public:
+	PersistentMap() {}
+	PersistentMap(const RpcValue::Map &map);
+
+	size_t size() const {return m_size;}
+	bool empty() const {return m_size == 0;}
+	bool hasKey(const RpcValue::String &key) const {return find(key) != nullptr;}
+	RpcValue value(const RpcValue::String &key, const RpcValue &default_val = RpcValue()) const;
+	/// nullptr if key is not set, pointer is valid while the snapshot lives
+	const RpcValue* find(const RpcValue::String &key) const;
+	/// invalid value removes the key
+	void setValue(const RpcValue::String &key, const RpcValue &val);
+
+	std::vector<RpcValue::String> keys() const;
+	RpcValue::Map toMap() const;
+	/// visits entries in unspecified order
+	void forEach(const std::function<void (const RpcValue::String &key, const RpcValue &val)> &fn) const;
+private:
+	std::shared_ptr<const Node> m_root;
+	size_t m_size = 0;
+};
+
+} // namespace chainpack
+} // namespace shv
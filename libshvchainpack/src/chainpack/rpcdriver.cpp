@@ -6,10 +6,12 @@
 #include "cponreader.h"
 #include "chainpackwriter.h"
 #include "chainpackreader.h"
+#include "rpcvaluearena.h"
+#include "chainpackview.h"
+#include "transcoder.h"
 
 #include <necrolog.h>
 
-#include <sstream>
 #include <iostream>
 
 #define logRpcRawMsg() nCDebug("RpcRawMsg")
@@ -58,15 +60,16 @@ void RpcDriver::sendRawData(const RpcValue::MetaData &meta_data, std::string &&d
 				<< Utils::toHex(data, 0, 250);
 	using namespace std;
 	//shvLogFuncFrame() << msg.toStdString();
-	std::ostringstream os_packed_meta_data;
+	std::string packed_meta_data;
 	switch (protocolType()) {
 	case Rpc::ProtocolType::Cpon: {
-		CponWriter wr(os_packed_meta_data);
+		CponWriter wr(packed_meta_data);
 		wr << meta_data;
 		break;
 	}
 	case Rpc::ProtocolType::ChainPack: {
-		ChainPackWriter wr(os_packed_meta_data);
+		packed_meta_data.reserve(ChainPack::packedSize(meta_data));
+		ChainPackWriter wr(packed_meta_data);
 		wr << meta_data;
 		break;
 	}
@@ -81,19 +84,14 @@ void RpcDriver::sendRawData(const RpcValue::MetaData &meta_data, std::string &&d
 		// JSON RPC must be handled separately
 		if(packed_data_ver == Rpc::ProtocolType::Invalid)
 			SHVCHP_EXCEPTION("Cannot serialize to JSON-RPC data without protocol version specified.")
-		// recode data;
-		RpcValue val = decodeData(packed_data_ver, data, 0);
-		val.setMetaData(RpcValue::MetaData(meta_data));
-		enqueueDataToSend(MessageData(codeRpcValue(Rpc::ProtocolType::JsonRpc, val)));
+		enqueueDataToSend(MessageData(transcodeData(packed_data_ver, data, Rpc::ProtocolType::JsonRpc, meta_data)));
 	}
 	else {
 		if(packed_data_ver == Rpc::ProtocolType::Invalid || packed_data_ver == protocolType()) {
-			enqueueDataToSend(MessageData(os_packed_meta_data.str(), std::move(data)));
+			enqueueDataToSend(MessageData(std::move(packed_meta_data), std::move(data)));
 		}
 		else {
-			// recode data;
-			RpcValue val = decodeData(packed_data_ver, data, 0);
-			enqueueDataToSend(MessageData(os_packed_meta_data.str(), codeRpcValue(protocolType(), val)));
+			enqueueDataToSend(MessageData(std::move(packed_meta_data), transcodeData(packed_data_ver, data, protocolType(), meta_data)));
 		}
 	}
 }
@@ -145,15 +143,10 @@ void RpcDriver::writeQueue()
 	if(!m_topMessageDataHeaderWritten) {
 		writeMessageBegin();
 		std::string protocol_type_data;
+		{ ChainPackWriter wr(protocol_type_data); wr.writeUIntData((unsigned)protocolType());}
 		{
-			std::ostringstream os;
-			{ ChainPackWriter wr(os); wr.writeUIntData((unsigned)protocolType());}
-			protocol_type_data = os.str();
-		}
-		{
-			std::ostringstream os;
-			{ ChainPackWriter wr(os); wr.writeUIntData(chunk.size() + protocol_type_data.length()); }
-			std::string packet_len_data = os.str();
+			std::string packet_len_data;
+			{ ChainPackWriter wr(packet_len_data); wr.writeUIntData(chunk.size() + protocol_type_data.length()); }
 			auto len = writeBytes(packet_len_data.data(), packet_len_data.length());
 			if(len < 0)
 				SHVCHP_EXCEPTION("Write socket error!");
@@ -199,19 +192,12 @@ int64_t RpcDriver::writeBytes_helper(const std::string &str, size_t from, size_t
 void RpcDriver::onBytesRead(std::string &&bytes)
 {
 	logRpcData().nospace() << __FUNCTION__ << " " << bytes.length() << " bytes of data read:\n" << shv::chainpack::Utils::hexDump(bytes);
-	m_readData += std::string(std::move(bytes));
-	while(true) {
-		int len = processReadData(m_readData);
-		logRpcData() << len << "bytes of" << m_readData.size() << "processed";
-		if(len > 0) {
-			//nWarning().nospace() << "1:" << m_readData.size() << " '" << m_readData << "'";
-			m_readData = m_readData.substr(len);
-			//nWarning().nospace() << "2:" << m_readData.size() << " '" << m_readData << "'";
-		}
-		else {
-			break;
-		}
+	m_frameReader.addData(std::move(bytes));
+	RpcFrameReader::Frame frame;
+	while(m_frameReader.nextFrame(frame)) {
+		processReadData(frame);
 	}
+	logRpcData() << m_frameReader.bytesNeeded() << "bytes needed to complete next message";
 }
 
 void RpcDriver::clearBuffers()
@@ -219,44 +205,27 @@ void RpcDriver::clearBuffers()
 	m_sendQueue.clear();
 	m_topMessageDataHeaderWritten = false;
 	m_topMessageDataBytesWrittenSoFar = 0;
-	m_readData.clear();
+	m_frameReader.clear();
 }
 
-int RpcDriver::processReadData(const std::string &read_data)
+void RpcDriver::processReadData(const RpcFrameReader::Frame &frame)
 {
-	logRpcData() << __FUNCTION__ << "data len:" << read_data.length();
+	logRpcData() << __FUNCTION__ << "protocol:" << Rpc::protocolTypeToString(frame.protocolType) << "data len:" << frame.length;
 
 	using namespace shv::chainpack;
 
-	std::istringstream in(read_data);
-
-	bool ok;
-	uint64_t chunk_len = ChainPackReader::readUIntData(in, &ok);
-	if(!ok)
-		return 0;
-
-	size_t read_len = (size_t)in.tellg() + chunk_len;
-
-	Rpc::ProtocolType protocol_type = (Rpc::ProtocolType)ChainPackReader::readUIntData(in, &ok);
-	if(!ok)
-		return 0;
-
-	logRpcData() << "\t expected message data length:" << read_len << "length available:" << read_data.size();
-	if(read_len > read_data.length())
-		return 0;
-
-	if(in.tellg() < 0)
-		return 0;
-
+	Rpc::ProtocolType protocol_type = frame.protocolType;
 	if(m_protocolType == Rpc::ProtocolType::Invalid && protocol_type != Rpc::ProtocolType::Invalid) {
 		// if protocol version is not explicitly specified,
 		// it is set from first received message
 		m_protocolType = protocol_type;
 	}
 
+	const std::string &read_data = m_frameReader.buffer();
+	size_t read_len = frame.start + frame.length;
 	try {
 		RpcValue::MetaData meta_data;
-		size_t meta_data_end_pos = decodeMetaData(meta_data, protocol_type, read_data, in.tellg());
+		size_t meta_data_end_pos = decodeMetaData(meta_data, protocol_type, read_data, frame.start);
 		if(meta_data_end_pos > read_len)
 			throw std::runtime_error("Data header corrupted");
 		onRpcDataReceived(protocol_type, std::move(meta_data), read_data, meta_data_end_pos, read_len - meta_data_end_pos);
@@ -265,19 +234,17 @@ int RpcDriver::processReadData(const std::string &read_data)
 		nError() << "processReadData error:" << e.what();
 		onProcessReadDataException(e);
 	}
-
-	return read_len;
 }
 
 size_t RpcDriver::decodeMetaData(RpcValue::MetaData &meta_data, Rpc::ProtocolType protocol_type, const std::string &data, size_t start_pos)
 {
 	size_t meta_data_end_pos = start_pos;
-	std::istringstream in(data);
-	in.seekg(start_pos);
+	const char *in_data = data.data() + start_pos;
+	size_t in_len = data.size() - start_pos;
 
 	switch (protocol_type) {
 	case Rpc::ProtocolType::JsonRpc: {
-		CponReader rd(in);
+		CponReader rd(in_data, in_len);
 		RpcValue msg;
 		rd.read(msg);
 		if(!msg.isMap()) {
@@ -301,15 +268,15 @@ size_t RpcDriver::decodeMetaData(RpcValue::MetaData &meta_data, Rpc::ProtocolTyp
 		break;
 	}
 	case Rpc::ProtocolType::Cpon: {
-		CponReader rd(in);
+		CponReader rd(in_data, in_len);
 		rd.read(meta_data);
-		meta_data_end_pos = (in.tellg() < 0)? data.size(): (size_t)in.tellg();
+		meta_data_end_pos = start_pos + rd.readPosition();
 		break;
 	}
 	case Rpc::ProtocolType::ChainPack: {
-		ChainPackReader rd(in);
+		ChainPackReader rd(in_data, in_len);
 		rd.read(meta_data);
-		meta_data_end_pos = (in.tellg() < 0)? data.size(): (size_t)in.tellg();
+		meta_data_end_pos = start_pos + rd.readPosition();
 		break;
 	}
 	default:
@@ -322,15 +289,15 @@ size_t RpcDriver::decodeMetaData(RpcValue::MetaData &meta_data, Rpc::ProtocolTyp
 	return meta_data_end_pos;
 }
 
-RpcValue RpcDriver::decodeData(Rpc::ProtocolType protocol_type, const std::string &data, size_t start_pos)
+RpcValue RpcDriver::decodeData(Rpc::ProtocolType protocol_type, const std::string &data, size_t start_pos, const std::shared_ptr<const void> &data_owner)
 {
 	RpcValue ret;
-	std::istringstream in(data);
-	in.seekg(start_pos);
+	const char *in_data = data.data() + start_pos;
+	size_t in_len = data.size() - start_pos;
 	try {
 		switch (protocol_type) {
 		case Rpc::ProtocolType::JsonRpc: {
-			CponReader rd(in);
+			CponReader rd(in_data, in_len);
 			rd.read(ret);
 			RpcValue::Map map = ret.toMap();
 			RpcValue::IMap imap;
@@ -353,12 +320,13 @@ RpcValue RpcDriver::decodeData(Rpc::ProtocolType protocol_type, const std::strin
 			break;
 		}
 		case Rpc::ProtocolType::Cpon: {
-			CponReader rd(in);
+			CponReader rd(in_data, in_len);
 			rd.read(ret);
 			break;
 		}
 		case Rpc::ProtocolType::ChainPack: {
-			ChainPackReader rd(in);
+			ChainPackReader rd(in_data, in_len);
+			rd.setBlobDataOwner(data_owner);
 			rd.read(ret);
 			break;
 		}
@@ -369,15 +337,17 @@ RpcValue RpcDriver::decodeData(Rpc::ProtocolType protocol_type, const std::strin
 	}
 	catch(AbstractStreamReader::ParseException &e) {
 		nError() << Rpc::protocolTypeToString(protocol_type) << "Decode data error:" << e.what();
-		std::string data_piece = data.substr(e.pos() - 10*16, 20*16);
-		nError().nospace() << "Start offset: " << start_pos << " Data: from pos:" << (e.pos() - 10*16) << "\n" << shv::chainpack::Utils::hexDump(data_piece);
+		size_t err_pos = start_pos + e.pos();
+		size_t dump_pos = (err_pos > 10*16)? err_pos - 10*16: 0;
+		std::string data_piece = data.substr(dump_pos, 20*16);
+		nError().nospace() << "Start offset: " << start_pos << " Data: from pos:" << dump_pos << "\n" << shv::chainpack::Utils::hexDump(data_piece);
 	}
 	return ret;
 }
 
 std::string RpcDriver::codeRpcValue(Rpc::ProtocolType protocol_type, const RpcValue &val)
 {
-	std::ostringstream os_packed_data;
+	std::string packed_data;
 	switch (protocol_type) {
 	case Rpc::ProtocolType::JsonRpc: {
 		RpcValue::Map json_msg;
@@ -412,31 +382,162 @@ std::string RpcDriver::codeRpcValue(Rpc::ProtocolType protocol_type, const RpcVa
 		}
 		CponWriterOptions opts;
 		opts.setJsonFormat(true);
-		CponWriter wr(os_packed_data, opts);
+		CponWriter wr(packed_data, opts);
 		wr.write(json_msg);
 		break;
 	}
 	case Rpc::ProtocolType::Cpon: {
-		CponWriter wr(os_packed_data);
+		CponWriter wr(packed_data);
 		wr << val;
 		break;
 	}
 	case Rpc::ProtocolType::ChainPack: {
-		ChainPackWriter wr(os_packed_data);
+		packed_data.reserve(ChainPack::packedSize(val));
+		ChainPackWriter wr(packed_data);
 		wr << val;
 		break;
 	}
 	default:
 		SHVCHP_EXCEPTION("Cannot serialize data without protocol version specified.")
 	}
-	return os_packed_data.str();
+	return packed_data;
+}
+
+namespace {
+
+std::string packed_view_data(const ChainPackView &v)
+{
+	return std::string(v.packedData(), v.packedSize());
+}
+
+/// JSON-RPC message to RpcMessage data IMap
+std::string transcode_from_json_rpc(const std::string &data, Rpc::ProtocolType to)
+{
+	const std::string cp_data = Transcoder::transcode(Rpc::ProtocolType::JsonRpc, data, Rpc::ProtocolType::ChainPack);
+	ChainPackView json_msg(cp_data);
+	if(!json_msg.isMap())
+		SHVCHP_EXCEPTION("JSON-RPC message should be a Map.");
+	std::string ret;
+	{
+		std::unique_ptr<AbstractStreamWriter> wr;
+		if(to == Rpc::ProtocolType::ChainPack)
+			wr.reset(new ChainPackWriter(ret));
+		else
+			wr.reset(new CponWriter(ret));
+		wr->writeContainerBegin(RpcValue::Type::IMap);
+		ChainPackView params = json_msg.at(Rpc::JSONRPC_PARAMS);
+		ChainPackView result = json_msg.at(Rpc::JSONRPC_RESULT);
+		ChainPackView error = json_msg.at(Rpc::JSONRPC_ERROR);
+		if(params.isValid() || result.isValid()) {
+			const ChainPackView &v = params.isValid()? params: result;
+			wr->writeIMapKey(params.isValid()? RpcMessage::MetaType::Key::Params: RpcMessage::MetaType::Key::Result);
+			if(to == Rpc::ProtocolType::ChainPack)
+				wr->writeRawData(packed_view_data(v));
+			else
+				wr->writeRawData(Transcoder::transcode(Rpc::ProtocolType::ChainPack, packed_view_data(v), to));
+		}
+		else if(error.isValid()) {
+			wr->writeMapElement(RpcMessage::MetaType::Key::Error, RpcResponse::Error::fromJson(error.toRpcValue().toMap()));
+		}
+		wr->writeContainerEnd();
+	}
+	return ret;
+}
+
+/// RpcMessage data IMap and meta data to JSON-RPC message
+std::string transcode_to_json_rpc(Rpc::ProtocolType from, const std::string &data, const RpcValue::MetaData &meta_data)
+{
+	std::string cp_data;
+	if(from == Rpc::ProtocolType::JsonRpc)
+		cp_data = transcode_from_json_rpc(data, Rpc::ProtocolType::ChainPack);
+	else if(from != Rpc::ProtocolType::ChainPack)
+		cp_data = Transcoder::transcode(from, data, Rpc::ProtocolType::ChainPack);
+	ChainPackView msg_data(cp_data.empty()? data: cp_data);
+	if(!msg_data.isIMap())
+		SHVCHP_EXCEPTION("RpcMessage data should be an IMap.");
+	auto write_json_value = [](AbstractStreamWriter &wr, const char *key, const ChainPackView &v) {
+		wr.writeMapKey(key);
+		wr.writeRawData(Transcoder::transcode(Rpc::ProtocolType::ChainPack, packed_view_data(v), Rpc::ProtocolType::JsonRpc));
+	};
+	// keys are written in the same order as the sorted Map in codeRpcValue()
+	std::string ret;
+	{
+		CponWriterOptions opts;
+		opts.setJsonFormat(true);
+		CponWriter wr(ret, opts);
+		wr.writeContainerBegin(RpcValue::Type::Map);
+		const RpcValue caller_id = RpcMessage::callerIds(meta_data);
+		if(caller_id.isValid())
+			wr.writeMapElement(Rpc::JSONRPC_CALLER_ID, caller_id);
+		const bool is_response = RpcMessage::isResponse(meta_data);
+		bool is_error = false;
+		if(is_response) {
+			ChainPackView error = msg_data.at(RpcMessage::MetaType::Key::Error);
+			RpcResponse::Error err(error.isValid()? error.toRpcValue().toIMap(): RpcValue::IMap());
+			is_error = !err.empty();
+			if(is_error)
+				wr.writeMapElement(Rpc::JSONRPC_ERROR, err.toJson());
+		}
+		const RpcValue rq_id = RpcMessage::requestId(meta_data);
+		if(rq_id.isValid())
+			wr.writeMapElement(Rpc::JSONRPC_REQUEST_ID, rq_id);
+		if(!is_response) {
+			wr.writeMapElement(Rpc::JSONRPC_METHOD, RpcMessage::method(meta_data));
+			ChainPackView params = msg_data.at(RpcMessage::MetaType::Key::Params);
+			if(params.isValid())
+				write_json_value(wr, Rpc::JSONRPC_PARAMS, params);
+		}
+		const RpcValue shv_path = RpcMessage::shvPath(meta_data);
+		if(shv_path.isString())
+			wr.writeMapElement(Rpc::JSONRPC_SHV_PATH, shv_path.toString());
+		if(is_response && !is_error) {
+			ChainPackView result = msg_data.at(RpcMessage::MetaType::Key::Result);
+			if(result.isValid())
+				write_json_value(wr, Rpc::JSONRPC_RESULT, result);
+			else
+				wr.writeMapElement(Rpc::JSONRPC_RESULT, nullptr);
+		}
+		wr.writeContainerEnd();
+	}
+	return ret;
+}
+
+}
+
+std::string RpcDriver::transcodeData(Rpc::ProtocolType from, const std::string &data, Rpc::ProtocolType to, const RpcValue::MetaData &meta_data)
+{
+	try {
+		if(to == Rpc::ProtocolType::JsonRpc)
+			return transcode_to_json_rpc(from, data, meta_data);
+		if(from == Rpc::ProtocolType::JsonRpc)
+			return transcode_from_json_rpc(data, to);
+		return Transcoder::transcode(from, data, to);
+	}
+	catch (std::exception &e) {
+		// typed arrays for example
+		logRpcData() << "Cannot transcode data:" << e.what() << "recoding using RpcValue.";
+	}
+	RpcValue val = decodeData(from, data, 0);
+	if(to == Rpc::ProtocolType::JsonRpc)
+		val.setMetaData(RpcValue::MetaData(meta_data));
+	return codeRpcValue(to, val);
 }
 
 void RpcDriver::onRpcDataReceived(Rpc::ProtocolType protocol_type, RpcValue::MetaData &&md, const std::string &data, size_t start_pos, size_t data_len)
 {
 	//nInfo() << __FILE__ << RCV_LOG_ARROW << md.toStdString() << shv::chainpack::Utils::toHexElided(data, start_pos, 100);
-	(void)data_len;
-	RpcValue msg = decodeData(protocol_type, data, start_pos);
+	std::shared_ptr<RpcValueArena> arena;
+	if(m_decodeArenaEnabled)
+		arena = std::make_shared<RpcValueArena>(data_len);
+	RpcValue msg;
+	{
+		RpcValueArena::Scope arena_scope(arena);
+		// received blobs and long strings reference the frame buffer
+		std::shared_ptr<const void> data_owner;
+		if(&data == &m_frameReader.buffer())
+			data_owner = m_frameReader.sharedBuffer();
+		msg = decodeData(protocol_type, data, start_pos, data_owner);
+	}
 	if(msg.isValid()) {
 		msg.setMetaData(std::move(md));
 		logRpcRawMsg() << RCV_LOG_ARROW << msg.toPrettyString();
@@ -3,6 +3,7 @@
 #include "../shvchainpackglobal.h"
 #include "rpcmessage.h"
 #include "rpc.h"
+#include "rpcframereader.h"
 
 #include <functional>
 #include <string>
@@ -30,14 +31,23 @@ public:
 	using MessageReceivedCallback = std::function< void (const RpcValue &msg)>;
 	void setMessageReceivedCallback(const MessageReceivedCallback &callback) {m_messageReceivedCallback = callback;}
 
+	/// decode each received message into its own RpcValueArena, handler keeping
+	/// parts of the message long should promote them, see RpcValue::promoteFromArena()
+	bool isDecodeArenaEnabled() const {return m_decodeArenaEnabled;}
+	void setDecodeArenaEnabled(bool b) {m_decodeArenaEnabled = b;}
+
 	static int defaultRpcTimeoutMsec() {return s_defaultRpcTimeoutMsec;}
 	static void setDefaultRpcTimeoutMsec(int msec) {s_defaultRpcTimeoutMsec = msec;}
 
 	static RpcMessage composeRpcMessage(RpcValue::MetaData &&meta_data, const std::string &data, std::string *errmsg = nullptr);
 
 	static size_t decodeMetaData(RpcValue::MetaData &meta_data, Rpc::ProtocolType protocol_type, const std::string &data, size_t start_pos);
-	static RpcValue decodeData(Rpc::ProtocolType protocol_type, const std::string &data, size_t start_pos);
+	/// decoded blobs and long strings reference data without copying if data_owner is set, see ChainPackReader::setBlobDataOwner()
+	static RpcValue decodeData(Rpc::ProtocolType protocol_type, const std::string &data, size_t start_pos, const std::shared_ptr<const void> &data_owner = nullptr);
 	static std::string codeRpcValue(Rpc::ProtocolType protocol_type, const RpcValue &val);
+	/// recodes packed RpcMessage data to another protocol without decoding it to RpcValue,
+	/// meta_data are needed to compose JSON-RPC message only
+	static std::string transcodeData(Rpc::ProtocolType from, const std::string &data, Rpc::ProtocolType to, const RpcValue::MetaData &meta_data = RpcValue::MetaData());
 protected:
 	struct MessageData
 	{
@@ -81,7 +91,7 @@ protected:
 	virtual void lockSendQueue() {}
 	virtual void unlockSendQueue() {}
 private:
-	int processReadData(const std::string &read_data);
+	void processReadData(const RpcFrameReader::Frame &frame);
 	void writeQueue();
 	int64_t writeBytes_helper(const std::string &str, size_t from, size_t length);
 private:
@@ -89,8 +99,9 @@ private:
 	std::deque<MessageData> m_sendQueue;
 	bool m_topMessageDataHeaderWritten = false;
 	size_t m_topMessageDataBytesWrittenSoFar = 0;
-	std::string m_readData;
+	RpcFrameReader m_frameReader;
 	Rpc::ProtocolType m_protocolType = Rpc::ProtocolType::Invalid;
+	bool m_decodeArenaEnabled = false;
 	static int s_defaultRpcTimeoutMsec;
 };
 
@@ -0,0 +1,98 @@
+#include "rpcframereader.h"
+#include "chainpackreader.h"
+
+#include <limits>
+
+namespace shv {
+namespace chainpack {
+
+void RpcFrameReader::addData(std::string &&bytes)
+{
+	if(m_data.use_count() > 1) {
+		// buffer is referenced by blobs, keep it untouched, copy unprocessed rest only
+		m_data = std::make_shared<std::string>(*m_data, m_frameStart);
+		if(m_frameHeaderRead)
+			m_frame.start -= m_frameStart;
+		m_frameStart = 0;
+	}
+	else if(m_frameStart > 0) {
+		// release frames already returned by nextFrame()
+		m_data->erase(0, m_frameStart);
+		if(m_frameHeaderRead)
+			m_frame.start -= m_frameStart;
+		m_frameStart = 0;
+	}
+	if(m_data->empty())
+		*m_data = std::move(bytes);
+	else
+		*m_data += bytes;
+}
+
+bool RpcFrameReader::nextFrame(RpcFrameReader::Frame &frame)
+{
+	if(!m_frameHeaderRead && !readFrameHeader())
+		return false;
+	size_t frame_end = m_frame.start + m_frame.length;
+	if(frame_end > m_data->size())
+		return false;
+	frame = m_frame;
+	m_frameStart = frame_end;
+	m_frameHeaderRead = false;
+	return true;
+}
+
+size_t RpcFrameReader::bytesNeeded() const
+{
+	if(!m_frameHeaderRead)
+		return 0;
+	size_t frame_end = m_frame.start + m_frame.length;
+	return (frame_end > m_data->size())? frame_end - m_data->size(): 0;
+}
+
+void RpcFrameReader::clear()
+{
+	if(m_data.use_count() > 1)
+		m_data = std::make_shared<std::string>();
+	else
+		m_data->clear();
+	m_frameStart = 0;
+	m_frameHeaderRead = false;
+}
+
+bool RpcFrameReader::readFrameHeader()
+{
+	if(m_frameStart >= m_data->size())
+		return false;
+	ChainPackReader rd(m_data->data() + m_frameStart, m_data->size() - m_frameStart);
+	bool ok;
+	uint64_t chunk_len = rd.readUIntData(&ok);
+	if(!ok)
+		return false;
+	size_t pos = m_frameStart + rd.readPosition();
+	if(chunk_len > std::numeric_limits<size_t>::max() - pos) {
+		// corrupted header, frame end cannot be addressed
+		m_frame.protocolType = Rpc::ProtocolType::Invalid;
+		m_frame.start = pos;
+		m_frame.length = 0;
+		m_frameHeaderRead = true;
+		return true;
+	}
+	size_t frame_end = pos + static_cast<size_t>(chunk_len);
+	Rpc::ProtocolType protocol_type = (Rpc::ProtocolType)rd.readUIntData(&ok);
+	if(!ok)
+		return false;
+	size_t start = m_frameStart + rd.readPosition();
+	if(start > frame_end) {
+		// corrupted header, let frame consumer report the error
+		protocol_type = Rpc::ProtocolType::Invalid;
+		start = frame_end;
+	}
+	m_frame.protocolType = protocol_type;
+	m_frame.start = start;
+	m_frame.length = frame_end - start;
+	m_frameHeaderRead = true;
+	return true;
+}
+
+} // namespace chainpack
+} // namespace shv
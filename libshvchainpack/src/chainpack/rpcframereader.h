@@ -0,0 +1,49 @@
+#pragma once
+
+#include "../shvchainpackglobal.h"
+#include "rpc.h"
+
+#include <memory>
+#include <string>
+
+namespace shv {
+namespace chainpack {
+
+/// Splits incoming byte stream to RPC frames: chunk_len(UInt) protocol_type(UInt) meta_data data
+/// Frame header is parsed only once, incomplete frame is not reparsed when more bytes arrive.
+/// Buffer referenced by decoded blobs and long strings is never modified, new data are appended to a new one.
+class SHVCHAINPACK_DECL_EXPORT RpcFrameReader
+{
+public:
+	struct Frame
+	{
+		Rpc::ProtocolType protocolType = Rpc::ProtocolType::Invalid;
+		/// offset of meta data start in buffer()
+		size_t start = 0;
+		/// length of meta data + data
+		size_t length = 0;
+	};
+public:
+	RpcFrameReader() : m_data(std::make_shared<std::string>()) {}
+
+	void addData(std::string &&bytes);
+	/// returns false if complete frame is not available yet,
+	/// frame offsets are valid till next addData() or clear() call
+	bool nextFrame(Frame &frame);
+	const std::string& buffer() const {return *m_data;}
+	/// buffer() shared with values decoded from it, see ChainPackReader::setBlobDataOwner()
+	std::shared_ptr<const std::string> sharedBuffer() const {return m_data;}
+	/// number of bytes needed to complete current frame, 0 if frame header is not read yet
+	size_t bytesNeeded() const;
+	void clear();
+private:
+	bool readFrameHeader();
+private:
+	std::shared_ptr<std::string> m_data;
+	size_t m_frameStart = 0;
+	bool m_frameHeaderRead = false;
+	Frame m_frame;
+};
+
+} // namespace chainpack
+} // namespace shv
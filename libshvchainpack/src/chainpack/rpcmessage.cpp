@@ -9,6 +9,8 @@
 namespace shv {
 namespace chainpack {
 
+static_assert(RpcValue::MetaData::SLOT_KEY_MAX == RpcMessage::MetaType::Tag::MAX - 1, "RpcMessage header tags must be stored in meta data slots");
+
 RpcMessage::MetaType::MetaType()
 	: Super("RpcMessage")
 {
@@ -1,4 +1,6 @@
 #include "rpcvalue.h"
+#include "rpcvaluearena.h"
+#include "persistentmap.h"
 
 #include "cponwriter.h"
 #include "cponreader.h"
@@ -11,13 +13,19 @@
 
 #include <necrolog.h>
 
+#include <atomic>
 #include <cassert>
+#include <cstddef>
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
 #include <ctime>
 #include <sstream>
 #include <iostream>
 #include <chrono>
+#include <mutex>
+#include <new>
+#include <thread>
 /*
 namespace {
 #if defined _WIN32 || defined LIBC_NEWLIB
@@ -69,6 +77,10 @@ public:
 	virtual ~AbstractValueData() {}
 
 	virtual RpcValue::Type type() const {return RpcValue::Type::Invalid;}
+	/// deep copy of this node (value and meta data) with one reference, children are shared
+	virtual AbstractValueData* clone() const = 0;
+	/// see RpcValue::heapValue()
+	virtual RpcValue::Type typedValue(const void *&val) const = 0;
 	//virtual RpcValue::Type arrayType() const {return RpcValue::Type::Invalid;}
 
 	virtual const RpcValue::MetaData &metaData() const = 0;
@@ -89,23 +101,298 @@ public:
 	virtual bool toBool() const {return false;}
 	virtual RpcValue::DateTime toDateTime() const { return RpcValue::DateTime{}; }
 	virtual const std::string &toString() const;
-	//virtual const RpcValue::Blob &toBlob() const;
+	virtual const RpcValue::Blob &toBlob() const;
+	virtual const RpcValue::Blob *stringData() const {return nullptr;}
 	virtual const RpcValue::List &toList() const;
+	virtual const RpcValue::Array &toArray() const;
 	virtual const RpcValue::Map &toMap() const;
 	virtual const RpcValue::IMap &toIMap() const;
+	virtual const PersistentMap *persistentMap() const {return nullptr;}
 	virtual size_t count() const {return 0;}
 
 	virtual bool has(RpcValue::Int i) const { (void)i; return false; }
 	virtual bool has(const RpcValue::String &key) const { (void)key; return false; }
 	virtual RpcValue at(RpcValue::Int i) const { (void)i; return RpcValue(); }
 	virtual RpcValue at(const RpcValue::String &key) const { (void)key; return RpcValue(); }
-	virtual void set(RpcValue::Int ix, const RpcValue &val);
-	virtual void set(const RpcValue::String &key, const RpcValue &val);
-	virtual void append(const RpcValue &);
+	virtual void set(RpcValue::Int ix, RpcValue &&val);
+	virtual void set(const RpcValue::String &key, RpcValue &&val);
+	virtual void append(RpcValue &&val);
 
 	virtual std::string toStdString() const = 0;
+
+	size_t hash() const
+	{
+		size_t h = m_hash.load(std::memory_order_relaxed);
+		if(h == 0) {
+			h = computeHash();
+			// 0 means not computed
+			if(h == 0)
+				h = 1;
+			m_hash.store(h, std::memory_order_relaxed);
+		}
+		return h;
+	}
+	size_t cachedHash() const { return m_hash.load(std::memory_order_relaxed); }
+	void resetHash() { m_hash.store(0, std::memory_order_relaxed); }
+
+	void ref()
+	{
+#ifdef SHVCHAINPACK_NONATOMIC_REFCOUNT
+		if(!m_frozen) {
+			checkOwnerThread();
+			m_refCount.store(m_refCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			return;
+		}
+#endif
+		m_refCount.fetch_add(1, std::memory_order_relaxed);
+	}
+	/// returns true if the last reference was released
+	bool deref()
+	{
+#ifdef SHVCHAINPACK_NONATOMIC_REFCOUNT
+		if(!m_frozen) {
+			checkOwnerThread();
+			uint32_t cnt = m_refCount.load(std::memory_order_relaxed) - 1;
+			m_refCount.store(cnt, std::memory_order_relaxed);
+			return cnt == 0;
+		}
+#endif
+		return m_refCount.fetch_sub(1, std::memory_order_acq_rel) == 1;
+	}
+	long useCount() const { return m_refCount.load(std::memory_order_acquire); }
+	/// deletes data with refcount 0, arena allocated data are destructed and release arena memory
+	void destroy();
+	void setArenaMemory(RpcValueArena::Memory *memory) { m_arenaMemory = memory; }
+	bool isArenaAllocated() const { return m_arenaMemory != nullptr; }
+	/// data, its meta data or children are allocated in arena
+	bool hasArenaData() const;
+	/// copies arena allocated meta data and children to default heap, data must not be shared
+	void promote();
+	static bool hasArenaData(const RpcValue &val)
+	{
+		const AbstractValueData *d = val.heapData();
+		return d && d->hasArenaData();
+	}
+
+	bool isFrozen() const { return m_frozen; }
+	/// children are frozen already, clones of frozen data
+	void setFrozen() { m_frozen = true; }
+	void freeze();
+	/// value stored into frozen data must be frozen as well
+	void freezeIfFrozen(const RpcValue &val) const
+	{
+#ifdef SHVCHAINPACK_NONATOMIC_REFCOUNT
+		if(m_frozen)
+			val.freezeForSharing();
+#else
+		(void)val;
+#endif
+	}
+protected:
+	virtual size_t computeHash() const = 0;
+	virtual void freezeChildren() {}
+	virtual bool childrenHaveArenaData() const { return false; }
+	virtual void promoteChildren() {}
+private:
+#if defined SHVCHAINPACK_NONATOMIC_REFCOUNT && !defined NDEBUG
+	void checkOwnerThread() const
+	{
+		// not frozen data copied or released in other thread, see RpcValue::freezeForSharing()
+		assert(m_ownerThread == std::this_thread::get_id());
+	}
+	const std::thread::id m_ownerThread = std::this_thread::get_id();
+#else
+	void checkOwnerThread() const {}
+#endif
+	mutable std::atomic<size_t> m_hash{0};
+	std::atomic<uint32_t> m_refCount{1};
+	bool m_frozen = false;
+	RpcValueArena::Memory *m_arenaMemory = nullptr;
 };
 
+void RpcValue::AbstractValueData::freeze()
+{
+	if(m_frozen)
+		return;
+	m_frozen = true;
+	const RpcValue::MetaData &md = metaData();
+	md.forEachIValue([](RpcValue::Int, const RpcValue &val) { val.freezeForSharing(); });
+	for(const auto &kv : md.sValues())
+		kv.second.freezeForSharing();
+	freezeChildren();
+}
+
+bool RpcValue::AbstractValueData::hasArenaData() const
+{
+	if(m_arenaMemory)
+		return true;
+	const RpcValue::MetaData &md = metaData();
+	bool ret = false;
+	md.forEachIValue([&ret](RpcValue::Int, const RpcValue &val) { ret = ret || hasArenaData(val); });
+	for(const auto &kv : md.sValues())
+		ret = ret || hasArenaData(kv.second);
+	return ret || childrenHaveArenaData();
+}
+
+void RpcValue::AbstractValueData::promote()
+{
+	const RpcValue::MetaData &md = metaData();
+	for(RpcValue::Int key : md.iKeys()) {
+		RpcValue val = md.value(key);
+		if(hasArenaData(val)) {
+			val.promoteFromArena();
+			setMetaValue(key, val);
+		}
+	}
+	for(const RpcValue::String &key : md.sKeys()) {
+		RpcValue val = md.value(key);
+		if(hasArenaData(val)) {
+			val.promoteFromArena();
+			setMetaValue(key, val);
+		}
+	}
+	promoteChildren();
+}
+
+namespace {
+size_t hash_combine(size_t seed, size_t h)
+{
+	return seed ^ (h + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+}
+
+size_t blob_hash(const RpcValue::Blob &blob)
+{
+	// FNV-1a
+	size_t h = static_cast<size_t>(14695981039346656037ULL);
+	for(size_t i = 0; i < blob.size(); ++i)
+		h = (h ^ static_cast<uint8_t>(blob.data()[i])) * static_cast<size_t>(1099511628211ULL);
+	return h;
+}
+
+size_t map_entry_hash(const RpcValue::String &key, const RpcValue &val)
+{
+	return hash_combine(std::hash<std::string>()(key), val.hash());
+}
+
+// entry hashes are summed, PersistentMap visits entries unordered and must hash as equal Map
+size_t map_hash(const RpcValue::Map &map)
+{
+	size_t h = 0;
+	for(const auto &kv : map)
+		h += map_entry_hash(kv.first, kv.second);
+	return hash_combine(static_cast<size_t>(RpcValue::Type::Map), h);
+}
+
+size_t map_hash(const PersistentMap &map)
+{
+	size_t h = 0;
+	map.forEach([&h](const RpcValue::String &key, const RpcValue &val) {
+		h += map_entry_hash(key, val);
+	});
+	return hash_combine(static_cast<size_t>(RpcValue::Type::Map), h);
+}
+}
+
+/* * * * * * * * * * * * * * * * * * * *
+ * Arena allocation
+ */
+namespace {
+template<typename T, typename... Args>
+T* make_value_data(Args&&... args)
+{
+	if(const std::shared_ptr<RpcValueArena> *arena = RpcValueArena::current()) {
+		// data keep arena memory alive till destroy()
+		RpcValueArena::Memory *memory;
+		void *mem = (*arena)->allocateValueData(sizeof(T), alignof(T), &memory);
+		T *ret;
+		try {
+			ret = new (mem) T(std::forward<Args>(args)...);
+		}
+		catch (...) {
+			RpcValueArena::releaseValueData(memory);
+			throw;
+		}
+		ret->setArenaMemory(memory);
+		return ret;
+	}
+	return new T(std::forward<Args>(args)...);
+}
+}
+
+void RpcValue::AbstractValueData::destroy()
+{
+	if(RpcValueArena::Memory *memory = m_arenaMemory) {
+		this->~AbstractValueData();
+		RpcValueArena::releaseValueData(memory);
+	}
+	else {
+		delete this;
+	}
+}
+
+/* * * * * * * * * * * * * * * * * * * *
+ * Reference counting
+ */
+RpcValue::DataPtr::DataPtr(const DataPtr &o) noexcept
+	: m_d(o.m_d)
+{
+	if(m_d)
+		m_d->ref();
+}
+
+RpcValue::DataPtr::~DataPtr()
+{
+	if(m_d && m_d->deref())
+		m_d->destroy();
+}
+
+RpcValue::DataPtr &RpcValue::DataPtr::operator=(const DataPtr &o) noexcept
+{
+	if(o.m_d)
+		o.m_d->ref();
+	AbstractValueData *old = m_d;
+	m_d = o.m_d;
+	if(old && old->deref())
+		old->destroy();
+	return *this;
+}
+
+RpcValue::DataPtr &RpcValue::DataPtr::operator=(DataPtr &&o) noexcept
+{
+	if(this != &o) {
+		AbstractValueData *old = m_d;
+		m_d = o.m_d;
+		o.m_d = nullptr;
+		if(old && old->deref())
+			old->destroy();
+	}
+	return *this;
+}
+
+long RpcValue::DataPtr::use_count() const
+{
+	return m_d? m_d->useCount(): 0;
+}
+
+void RpcValue::freezeForSharing() const
+{
+#ifdef SHVCHAINPACK_NONATOMIC_REFCOUNT
+	if(AbstractValueData *d = heapData())
+		d->freeze();
+#endif
+}
+
+void RpcValue::promoteFromArena()
+{
+	AbstractValueData *d = heapData();
+	if(!d || !d->hasArenaData())
+		return;
+	RpcValueArena::Suspend no_arena;
+	if(d->isArenaAllocated() || m_storage.ptr.use_count() > 1)
+		m_storage.ptr = DataPtr(d->clone());
+	m_storage.ptr->promote();
+}
+
 /* * * * * * * * * * * * * * * * * * * *
  * Value wrappers
  */
@@ -128,6 +415,7 @@ protected:
 	}
 
 	RpcValue::Type type() const override { return tag; }
+	RpcValue::Type typedValue(const void *&val) const override { val = &m_value; return tag; }
 
 	const RpcValue::MetaData &metaData() const override
 	{
@@ -157,187 +445,209 @@ protected:
 			m_metaData = new RpcValue::MetaData();
 		m_metaData->setValue(key, val);
 	}
+protected:
+	template<typename D>
+	RpcValue::AbstractValueData* cloneAs() const
+	{
+		D *ret = make_value_data<D>(m_value);
+		if(m_metaData)
+			ret->m_metaData = new RpcValue::MetaData(*m_metaData);
+		if(isFrozen())
+			ret->setFrozen();
+		return ret;
+	}
 protected:
 	T m_value;
 	RpcValue::MetaData *m_metaData = nullptr;
 };
 
-class ChainPackDouble final : public ValueData<RpcValue::Type::Double, double>
-{
-	std::string toStdString() const override { return shv::chainpack::Utils::toString(m_value); }
-	double toDouble() const override { return m_value; }
-	bool toBool() const override { return !(m_value == 0); }
-	RpcValue::Int toInt() const override { return static_cast<RpcValue::Int>(m_value); }
-	RpcValue::UInt toUInt() const override { return static_cast<RpcValue::UInt>(m_value); }
-	int64_t toInt64() const override { return static_cast<int64_t>(m_value); }
-	uint64_t toUInt64() const override { return static_cast<uint64_t>(m_value); }
-	bool equals(const RpcValue::AbstractValueData * other) const override {
-		return m_value == other->toDouble();
-	}
-	//bool less(const Data * other) const override { return m_value < other->toDouble(); }
-public:
-	explicit ChainPackDouble(double value) : ValueData(value) {}
-};
-
-class ChainPackDecimal final : public ValueData<RpcValue::Type::Decimal, RpcValue::Decimal>
+/// scalar value with meta data, scalars without meta data are stored inline in RpcValue
+class ChainPackScalar final : public ValueData<RpcValue::Type::Invalid, RpcValue>
 {
-	std::string toStdString() const override { return m_value.toString(); }
+	RpcValue::Type type() const override { return m_value.type(); }
+	RpcValue::Type typedValue(const void *&val) const override { val = &m_value; return m_value.type(); }
+	RpcValue::AbstractValueData* clone() const override { return cloneAs<ChainPackScalar>(); }
+	std::string toStdString() const override { return m_value.toStdString(); }
 
+	bool isNull() const override { return m_value.isNull(); }
 	double toDouble() const override { return m_value.toDouble(); }
-	bool toBool() const override { return !(m_value.mantisa() == 0); }
-	RpcValue::Int toInt() const override { return static_cast<RpcValue::Int>(m_value.toDouble()); }
-	RpcValue::UInt toUInt() const override { return static_cast<RpcValue::UInt>(m_value.toDouble()); }
-	int64_t toInt64() const override { return static_cast<int64_t>(m_value.toDouble()); }
-	uint64_t toUInt64() const override { return static_cast<uint64_t>(m_value.toDouble()); }
-	RpcValue::Decimal toDecimal() const override { return m_value; }
-	bool equals(const RpcValue::AbstractValueData * other) const override { return toDouble() == other->toDouble(); }
-	//bool less(const Data * other) const override { return m_value < other->toDouble(); }
-public:
-	explicit ChainPackDecimal(RpcValue::Decimal &&value) : ValueData(std::move(value)) {}
-};
-
-class ChainPackInt final : public ValueData<RpcValue::Type::Int, int64_t>
-{
-	std::string toStdString() const override { return Utils::toString(m_value); }
-
-	double toDouble() const override { return m_value; }
-	bool toBool() const override { return !(m_value == 0); }
-	RpcValue::Int toInt() const override { return static_cast<RpcValue::Int>(m_value); }
-	RpcValue::UInt toUInt() const override { return static_cast<RpcValue::UInt>(m_value); }
-	int64_t toInt64() const override { return m_value; }
-	uint64_t toUInt64() const override { return static_cast<uint64_t>(m_value); }
-	bool equals(const RpcValue::AbstractValueData * other) const override { return m_value == other->toInt64(); }
-	//bool less(const Data * other) const override { return m_value < other->toDouble(); }
-public:
-	explicit ChainPackInt(int64_t value) : ValueData(value) {}
-};
-
-class ChainPackUInt final : public ValueData<RpcValue::Type::UInt, uint64_t>
-{
-	std::string toStdString() const override { return Utils::toString(m_value); }
-
-	double toDouble() const override { return m_value; }
-	bool toBool() const override { return !(m_value == 0); }
-	RpcValue::Int toInt() const override { return static_cast<RpcValue::Int>(m_value); }
-	RpcValue::UInt toUInt() const override { return static_cast<RpcValue::UInt>(m_value); }
-	int64_t toInt64() const override { return static_cast<int64_t>(m_value); }
-	uint64_t toUInt64() const override { return m_value; }
-	bool equals(const RpcValue::AbstractValueData * other) const override { return m_value == other->toUInt64(); }
-	//bool less(const Data * other) const override { return m_value < other->toDouble(); }
-public:
-	explicit ChainPackUInt(uint64_t value) : ValueData(value) {}
-};
-
-class ChainPackBoolean final : public ValueData<RpcValue::Type::Bool, bool>
-{
-	std::string toStdString() const override { return m_value? "true": "false"; }
-
-	bool toBool() const override { return m_value; }
-	RpcValue::Int toInt() const override { return m_value; }
-	RpcValue::UInt toUInt() const override { return m_value; }
-	int64_t toInt64() const override { return m_value; }
-	uint64_t toUInt64() const override { return m_value; }
-	bool equals(const RpcValue::AbstractValueData * other) const override { return m_value == other->toBool(); }
-public:
-	explicit ChainPackBoolean(bool value) : ValueData(value) {}
-};
-
-class ChainPackDateTime final : public ValueData<RpcValue::Type::DateTime, RpcValue::DateTime>
-{
-	std::string toStdString() const override { return m_value.toIsoString(); }
-
-	bool toBool() const override { return m_value.msecsSinceEpoch() != 0; }
-	int64_t toInt64() const override { return m_value.msecsSinceEpoch(); }
-	uint64_t toUInt64() const override { return m_value.msecsSinceEpoch(); }
-	RpcValue::DateTime toDateTime() const override { return m_value; }
-	bool equals(const RpcValue::AbstractValueData * other) const override { return m_value.msecsSinceEpoch() == other->toDateTime().msecsSinceEpoch(); }
+	RpcValue::Decimal toDecimal() const override { return m_value.toDecimal(); }
+	RpcValue::Int toInt() const override { return m_value.toInt(); }
+	RpcValue::UInt toUInt() const override { return m_value.toUInt(); }
+	int64_t toInt64() const override { return m_value.toInt64(); }
+	uint64_t toUInt64() const override { return m_value.toUInt64(); }
+	bool toBool() const override { return m_value.toBool(); }
+	RpcValue::DateTime toDateTime() const override { return m_value.toDateTime(); }
+	// scalars are compared in RpcValue::operator==
+	size_t computeHash() const override { return m_value.hash(); }
+	bool equals(const RpcValue::AbstractValueData *) const override { return false; }
 public:
-	explicit ChainPackDateTime(RpcValue::DateTime value) : ValueData(value) {}
+	explicit ChainPackScalar(const RpcValue &value) : ValueData(value) {}
 };
 
 class ChainPackString : public ValueData<RpcValue::Type::String, RpcValue::String>
 {
+	RpcValue::AbstractValueData* clone() const override { return cloneAs<ChainPackString>(); }
 	std::string toStdString() const override { return toString(); }
 
 	const std::string &toString() const override { return m_value; }
-	bool equals(const RpcValue::AbstractValueData * other) const override { return m_value == other->toString(); }
+	size_t computeHash() const override { return std::hash<std::string>()(m_value); }
+	bool equals(const RpcValue::AbstractValueData * other) const override
+	{
+		if(const RpcValue::Blob *data = other->stringData())
+			return m_value.size() == data->size() && std::memcmp(m_value.data(), data->data(), data->size()) == 0;
+		return m_value == other->toString();
+	}
 public:
 	explicit ChainPackString(const RpcValue::String &value) : ValueData(value) {}
 	explicit ChainPackString(RpcValue::String &&value) : ValueData(std::move(value)) {}
 };
-/*
+/// String referencing shared buffer bytes, std::string is created on first toString() only
+class ChainPackStringData final : public ValueData<RpcValue::Type::String, RpcValue::Blob>
+{
+	RpcValue::Type typedValue(const void *&val) const override { val = &toString(); return RpcValue::Type::String; }
+	RpcValue::AbstractValueData* clone() const override { return cloneAs<ChainPackStringData>(); }
+	std::string toStdString() const override { return m_value.toString(); }
+
+	const std::string &toString() const override;
+	const RpcValue::Blob *stringData() const override { return &m_value; }
+	// must be equal to ChainPackString hash
+	size_t computeHash() const override { return std::hash<std::string>()(toString()); }
+	bool equals(const RpcValue::AbstractValueData * other) const override
+	{
+		if(const RpcValue::Blob *data = other->stringData())
+			return m_value == *data;
+		return other->equals(this);
+	}
+public:
+	explicit ChainPackStringData(const RpcValue::Blob &value) : ValueData(value) {}
+	explicit ChainPackStringData(RpcValue::Blob &&value) : ValueData(std::move(value)) {}
+private:
+	mutable std::once_flag m_stringOnce;
+	mutable std::string m_string;
+};
 class ChainPackBlob final : public ValueData<RpcValue::Type::Blob, RpcValue::Blob>
 {
-	std::string toStdString() const override { return toBlob(); }
-	//const std::string &toString() const override { return Utils::toHex(m_value); }
+	RpcValue::AbstractValueData* clone() const override { return cloneAs<ChainPackBlob>(); }
+	std::string toStdString() const override { return m_value.toString(); }
+
 	const RpcValue::Blob &toBlob() const override { return m_value; }
+	size_t computeHash() const override { return blob_hash(m_value); }
 	bool equals(const RpcValue::AbstractValueData * other) const override { return m_value == other->toBlob(); }
 public:
 	explicit ChainPackBlob(const RpcValue::Blob &value) : ValueData(value) {}
 	explicit ChainPackBlob(RpcValue::Blob &&value) : ValueData(std::move(value)) {}
-	explicit ChainPackBlob(const uint8_t *bytes, size_t size) : ValueData(RpcValue::Blob()) {
-		m_value.reserve(size);
-		for (size_t i = 0; i < size; ++i) {
-			m_value[i] = bytes[i];
-		}
-	}
 };
-*/
+
 class ChainPackList final : public ValueData<RpcValue::Type::List, RpcValue::List>
 {
+	RpcValue::AbstractValueData* clone() const override { return cloneAs<ChainPackList>(); }
 	std::string toStdString() const override { return std::string(); }
 
 	size_t count() const override {return m_value.size();}
 	RpcValue at(RpcValue::Int i) const override;
-	void set(RpcValue::Int i, const RpcValue &val) override;
+	void set(RpcValue::Int i, RpcValue &&val) override;
+	void append(RpcValue &&val) override { m_value.push_back(std::move(val)); }
+	size_t computeHash() const override;
+	void freezeChildren() override { for(const RpcValue &val : m_value) val.freezeForSharing(); }
+	bool childrenHaveArenaData() const override;
+	void promoteChildren() override { for(RpcValue &val : m_value) val.promoteFromArena(); }
 	bool equals(const RpcValue::AbstractValueData * other) const override { return m_value == other->toList(); }
 public:
 	explicit ChainPackList(const RpcValue::List &value) : ValueData(value) {}
 	explicit ChainPackList(RpcValue::List &&value) : ValueData(move(value)) {}
 
+	RpcValue::List take() { return std::move(m_value); }
+
 	const RpcValue::List &toList() const override { return m_value; }
 };
 
+class ChainPackArray final : public ValueData<RpcValue::Type::Array, RpcValue::Array>
+{
+	RpcValue::AbstractValueData* clone() const override { return cloneAs<ChainPackArray>(); }
+	std::string toStdString() const override { return std::string(); }
+
+	size_t count() const override {return m_value.size();}
+	RpcValue at(RpcValue::Int i) const override;
+	size_t computeHash() const override;
+	bool equals(const RpcValue::AbstractValueData * other) const override { return m_value == other->toArray(); }
+public:
+	explicit ChainPackArray(const RpcValue::Array &value) : ValueData(value) {}
+	explicit ChainPackArray(RpcValue::Array &&value) : ValueData(std::move(value)) {}
+
+	const RpcValue::Array &toArray() const override { return m_value; }
+};
+
 class ChainPackMap final : public ValueData<RpcValue::Type::Map, RpcValue::Map>
 {
+	RpcValue::AbstractValueData* clone() const override { return cloneAs<ChainPackMap>(); }
 	std::string toStdString() const override { return std::string(); }
 
 	size_t count() const override {return m_value.size();}
 	bool has(const RpcValue::String &key) const override;
 	RpcValue at(const RpcValue::String &key) const override;
-	void set(const RpcValue::String &key, const RpcValue &val) override;
-	bool equals(const RpcValue::AbstractValueData * other) const override { return m_value == other->toMap(); }
+	void set(const RpcValue::String &key, RpcValue &&val) override;
+	size_t computeHash() const override { return map_hash(m_value); }
+	void freezeChildren() override { for(const auto &kv : m_value) kv.second.freezeForSharing(); }
+	bool childrenHaveArenaData() const override;
+	void promoteChildren() override { for(auto &kv : m_value) kv.second.promoteFromArena(); }
+	bool equals(const RpcValue::AbstractValueData * other) const override { return other->persistentMap()? other->equals(this): m_value == other->toMap(); }
 public:
 	explicit ChainPackMap(const RpcValue::Map &value) : ValueData(value) {}
-	explicit ChainPackMap(RpcValue::Map &&value) : ValueData(move(value)) {}
+	explicit ChainPackMap(RpcValue::Map &&value) : ValueData(std::move(value)) {}
+
+	RpcValue::Map take() { return std::move(m_value); }
 
 	const RpcValue::Map &toMap() const override { return m_value; }
 };
 
 class ChainPackIMap final : public ValueData<RpcValue::Type::IMap, RpcValue::IMap>
 {
+	RpcValue::AbstractValueData* clone() const override { return cloneAs<ChainPackIMap>(); }
 	std::string toStdString() const override { return std::string(); }
 	//const ChainPack::Map &toMap() const override { return m_value; }
 	size_t count() const override {return m_value.size();}
 	bool has(RpcValue::Int key) const override;
 	RpcValue at(RpcValue::Int key) const override;
-	void set(RpcValue::Int key, const RpcValue &val) override;
+	void set(RpcValue::Int key, RpcValue &&val) override;
+	size_t computeHash() const override;
+	void freezeChildren() override { for(const auto &kv : m_value) kv.second.freezeForSharing(); }
+	bool childrenHaveArenaData() const override;
+	void promoteChildren() override { for(auto &kv : m_value) kv.second.promoteFromArena(); }
 	bool equals(const RpcValue::AbstractValueData * other) const override { return m_value == other->toIMap(); }
 public:
 	explicit ChainPackIMap(const RpcValue::IMap &value) : ValueData(value) {}
 	explicit ChainPackIMap(RpcValue::IMap &&value) : ValueData(std::move(value)) {}
 
+	RpcValue::IMap take() { return std::move(m_value); }
+
 	const RpcValue::IMap &toIMap() const override { return m_value; }
 };
 
-class ChainPackNull final : public ValueData<RpcValue::Type::Null, std::nullptr_t>
+/// Map in PersistentMap, clone is O(1) and set copies O(log n) trie nodes only
+class ChainPackPersistentMap final : public ValueData<RpcValue::Type::Map, PersistentMap>
 {
-	std::string toStdString() const override { return "null"; }
+	RpcValue::AbstractValueData* clone() const override { return cloneAs<ChainPackPersistentMap>(); }
+	std::string toStdString() const override { return std::string(); }
 
-	bool isNull() const override {return true;}
-	bool equals(const RpcValue::AbstractValueData * other) const override { return other->isNull(); }
+	size_t count() const override {return m_value.size();}
+	bool has(const RpcValue::String &key) const override { return m_value.hasKey(key); }
+	RpcValue at(const RpcValue::String &key) const override { return m_value.value(key); }
+	void set(const RpcValue::String &key, RpcValue &&val) override;
+	size_t computeHash() const override { return map_hash(m_value); }
+	void freezeChildren() override;
+	bool childrenHaveArenaData() const override;
+	void promoteChildren() override;
+	bool equals(const RpcValue::AbstractValueData * other) const override;
 public:
-	ChainPackNull() : ValueData({}) {}
+	explicit ChainPackPersistentMap(const PersistentMap &value) : ValueData(value) {}
+
+	const PersistentMap *persistentMap() const override { return &m_value; }
+	const RpcValue::Map &toMap() const override;
+	RpcValue::Type typedValue(const void *&val) const override { val = &toMap(); return RpcValue::Type::Map; }
+private:
+	mutable std::mutex m_mapMutex;
+	mutable std::unique_ptr<RpcValue::Map> m_map;
 };
 
 /* * * * * * * * * * * * * * * * * * * *
@@ -345,11 +655,8 @@ public:
  */
 struct Statics
 {
-	const std::shared_ptr<RpcValue::AbstractValueData> null = std::make_shared<ChainPackNull>();
-	const std::shared_ptr<RpcValue::AbstractValueData> t = std::make_shared<ChainPackBoolean>(true);
-	const std::shared_ptr<RpcValue::AbstractValueData> f = std::make_shared<ChainPackBoolean>(false);
 	const RpcValue::String empty_string;
-	//const RpcValue::Blob empty_blob;
+	const RpcValue::Blob empty_blob;
 	Statics() {}
 };
 
@@ -360,11 +667,12 @@ static const Statics & statics()
 }
 
 static const RpcValue::String & static_empty_string() { return statics().empty_string; }
-//static const RpcValue::Blob & static_empty_blob() { return statics().empty_blob; }
+static const RpcValue::Blob & static_empty_blob() { return statics().empty_blob; }
 
 static const RpcValue & static_chain_pack_invalid() { static const RpcValue s{}; return s; }
 //static const ChainPack & static_chain_pack_null() { static const ChainPack s{statics().null}; return s; }
 static const RpcValue::List & static_empty_list() { static const RpcValue::List s{}; return s; }
+static const RpcValue::Array & static_empty_array() { static const RpcValue::Array s{}; return s; }
 static const RpcValue::Map & static_empty_map() { static const RpcValue::Map s{}; return s; }
 static const RpcValue::IMap & static_empty_imap() { static const RpcValue::IMap s{}; return s; }
 
@@ -372,7 +680,71 @@ static const RpcValue::IMap & static_empty_imap() { static const RpcValue::IMap
  * Constructors
  */
 
-RpcValue::RpcValue() noexcept {}
+RpcValue::RpcValue() noexcept
+{
+	new (&m_storage.ptr) DataPtr();
+}
+
+RpcValue::RpcValue(RpcValue::DataPtr &&data) noexcept
+{
+	new (&m_storage.ptr) DataPtr(std::move(data));
+}
+
+RpcValue::RpcValue(const RpcValue &other) noexcept
+	: m_scalarType(other.m_scalarType)
+{
+	if(isInline())
+		m_storage.scalar = other.m_storage.scalar;
+	else
+		new (&m_storage.ptr) DataPtr(other.m_storage.ptr);
+}
+
+RpcValue::RpcValue(RpcValue &&other) noexcept
+	: m_scalarType(other.m_scalarType)
+{
+	if(isInline())
+		m_storage.scalar = other.m_storage.scalar;
+	else
+		new (&m_storage.ptr) DataPtr(std::move(other.m_storage.ptr));
+}
+
+RpcValue::~RpcValue()
+{
+	if(!isInline())
+		m_storage.ptr.~DataPtr();
+}
+
+RpcValue &RpcValue::operator=(const RpcValue &rhs) noexcept
+{
+	if(this != &rhs) {
+		// rhs might be owned by this value
+		RpcValue tmp(rhs);
+		*this = std::move(tmp);
+	}
+	return *this;
+}
+
+RpcValue &RpcValue::operator=(RpcValue &&rhs) noexcept
+{
+	if(this == &rhs)
+		return *this;
+	if(rhs.isInline()) {
+		Scalar scalar = rhs.m_storage.scalar;
+		Type scalar_type = rhs.m_scalarType;
+		if(!isInline())
+			m_storage.ptr.~DataPtr();
+		m_storage.scalar = scalar;
+		m_scalarType = scalar_type;
+	}
+	else if(isInline()) {
+		new (&m_storage.ptr) DataPtr(std::move(rhs.m_storage.ptr));
+		m_scalarType = Type::Invalid;
+	}
+	else {
+		m_storage.ptr = std::move(rhs.m_storage.ptr);
+	}
+	return *this;
+}
 
 RpcValue RpcValue::fromType(RpcValue::Type t) noexcept
 {
@@ -386,50 +758,56 @@ RpcValue RpcValue::fromType(RpcValue::Type t) noexcept
 	case Type::String: return RpcValue{std::string()};
 	case Type::DateTime: return RpcValue{DateTime()};
 	case Type::List: return RpcValue{List()};
+	case Type::Array: return RpcValue{Array()};
 	case Type::Map: return RpcValue{Map()};
 	case Type::IMap: return RpcValue{IMap()};
 	case Type::Decimal: return RpcValue{Decimal()};
+	case Type::Blob: return RpcValue{Blob()};
 	}
 	return RpcValue();
 }
-RpcValue::RpcValue(std::nullptr_t) noexcept : m_ptr(statics().null) {}
-RpcValue::RpcValue(double value) : m_ptr(std::make_shared<ChainPackDouble>(value)) {}
-RpcValue::RpcValue(RpcValue::Decimal value) : m_ptr(std::make_shared<ChainPackDecimal>(std::move(value))) {}
-RpcValue::RpcValue(int32_t value) : m_ptr(std::make_shared<ChainPackInt>(value)) {}
-RpcValue::RpcValue(uint32_t value) : m_ptr(std::make_shared<ChainPackUInt>(value)) {}
-RpcValue::RpcValue(int64_t value) : m_ptr(std::make_shared<ChainPackInt>(value)) {}
-RpcValue::RpcValue(uint64_t value) : m_ptr(std::make_shared<ChainPackUInt>(value)) {}
-RpcValue::RpcValue(bool value) : m_ptr(value ? statics().t : statics().f) {}
-RpcValue::RpcValue(const DateTime &value) : m_ptr(std::make_shared<ChainPackDateTime>(value)) {}
-
-//RpcValue::RpcValue(const RpcValue::Blob &value) : m_ptr(std::make_shared<ChainPackBlob>(value)) {}
-//RpcValue::RpcValue(RpcValue::Blob &&value) : m_ptr(std::make_shared<ChainPackBlob>(std::move(value))) {}
-//RpcValue::RpcValue(const uint8_t * value, size_t size) : m_ptr(std::make_shared<ChainPackBlob>(value, size)) {}
-RpcValue::RpcValue(const std::string &value) : m_ptr(std::make_shared<ChainPackString>(value)) {}
-RpcValue::RpcValue(std::string &&value) : m_ptr(std::make_shared<ChainPackString>(std::move(value))) {}
-RpcValue::RpcValue(const char * value) : m_ptr(std::make_shared<ChainPackString>(value)) {}
-RpcValue::RpcValue(const RpcValue::List &values) : m_ptr(std::make_shared<ChainPackList>(values)) {}
-RpcValue::RpcValue(RpcValue::List &&values) : m_ptr(std::make_shared<ChainPackList>(std::move(values))) {}
-
-RpcValue::RpcValue(const RpcValue::Map &values) : m_ptr(std::make_shared<ChainPackMap>(values)) {}
-RpcValue::RpcValue(RpcValue::Map &&values) : m_ptr(std::make_shared<ChainPackMap>(std::move(values))) {}
-
-RpcValue::RpcValue(const RpcValue::IMap &values) : m_ptr(std::make_shared<ChainPackIMap>(values)) {}
-RpcValue::RpcValue(RpcValue::IMap &&values) : m_ptr(std::make_shared<ChainPackIMap>(std::move(values))) {}
-
-#ifdef RPCVALUE_COPY_AND_SWAP
-void RpcValue::swap(RpcValue& other) noexcept
-{
-	/*
-	std::cerr << __FUNCTION__ << " xxxxxxxxxx "
-			  << m_ptr.get() << " ref cnt: " << m_ptr.use_count() << " val: " << toStdString()
-			  << " X "
-			  << other.m_ptr.get() << " ref cnt: " << other.m_ptr.use_count() << " val: " << other.toStdString()
-			  << std::endl;
-	*/
-	std::swap(m_ptr, other.m_ptr);
+RpcValue::RpcValue(std::nullptr_t) noexcept : m_scalarType(Type::Null) {}
+RpcValue::RpcValue(double value) : m_scalarType(Type::Double) { m_storage.scalar.d = value; }
+RpcValue::RpcValue(RpcValue::Decimal value) : m_scalarType(Type::Decimal) { m_storage.scalar.decimal = value; }
+RpcValue::RpcValue(int32_t value) : m_scalarType(Type::Int) { m_storage.scalar.i = value; }
+RpcValue::RpcValue(uint32_t value) : m_scalarType(Type::UInt) { m_storage.scalar.u = value; }
+RpcValue::RpcValue(int64_t value) : m_scalarType(Type::Int) { m_storage.scalar.i = value; }
+RpcValue::RpcValue(uint64_t value) : m_scalarType(Type::UInt) { m_storage.scalar.u = value; }
+RpcValue::RpcValue(bool value) : m_scalarType(Type::Bool) { m_storage.scalar.b = value; }
+RpcValue::RpcValue(const DateTime &value) : m_scalarType(Type::DateTime) { m_storage.scalar.dateTime = value; }
+
+RpcValue::RpcValue(const RpcValue::Blob &value) : RpcValue(DataPtr(make_value_data<ChainPackBlob>(value))) {}
+RpcValue::RpcValue(RpcValue::Blob &&value) : RpcValue(DataPtr(make_value_data<ChainPackBlob>(std::move(value)))) {}
+RpcValue::RpcValue(const uint8_t * value, size_t size) : RpcValue(Blob(reinterpret_cast<const char*>(value), size)) {}
+RpcValue::RpcValue(const std::string &value) : RpcValue(DataPtr(make_value_data<ChainPackString>(value))) {}
+RpcValue::RpcValue(std::string &&value) : RpcValue(DataPtr(make_value_data<ChainPackString>(std::move(value)))) {}
+RpcValue::RpcValue(const char * value) : RpcValue(DataPtr(make_value_data<ChainPackString>(value))) {}
+RpcValue::RpcValue(const RpcValue::List &values) : RpcValue(DataPtr(make_value_data<ChainPackList>(values))) {}
+RpcValue::RpcValue(RpcValue::List &&values) : RpcValue(DataPtr(make_value_data<ChainPackList>(std::move(values)))) {}
+RpcValue::RpcValue(const RpcValue::Array &values) : RpcValue(DataPtr(make_value_data<ChainPackArray>(values))) {}
+RpcValue::RpcValue(RpcValue::Array &&values) : RpcValue(DataPtr(make_value_data<ChainPackArray>(std::move(values)))) {}
+
+RpcValue::RpcValue(const RpcValue::Map &values) : RpcValue(DataPtr(make_value_data<ChainPackMap>(values))) {}
+RpcValue::RpcValue(RpcValue::Map &&values) : RpcValue(DataPtr(make_value_data<ChainPackMap>(std::move(values)))) {}
+RpcValue::RpcValue(const PersistentMap &values) : RpcValue(DataPtr(make_value_data<ChainPackPersistentMap>(values))) {}
+
+RpcValue::RpcValue(const RpcValue::IMap &values) : RpcValue(DataPtr(make_value_data<ChainPackIMap>(values))) {}
+RpcValue::RpcValue(RpcValue::IMap &&values) : RpcValue(DataPtr(make_value_data<ChainPackIMap>(std::move(values)))) {}
+
+RpcValue RpcValue::fromStringData(Blob data)
+{
+	return RpcValue(DataPtr(make_value_data<ChainPackStringData>(std::move(data))));
+}
+
+void RpcValue::moveScalarToHeap()
+{
+	if(!isInline())
+		return;
+	DataPtr data(make_value_data<ChainPackScalar>(*this));
+	m_scalarType = Type::Invalid;
+	new (&m_storage.ptr) DataPtr(std::move(data));
 }
-#endif
+
 //Value::Value(const Value::MetaTypeId &value) : m_ptr(std::make_shared<ChainPackMetaTypeId>(value)) {}
 //Value::Value(const Value::MetaTypeNameSpaceId &value) : m_ptr(std::make_shared<ChainPackMetaTypeNameSpaceId>(value)) {}
 //Value::Value(const Value::MetaTypeName &value) : m_ptr(std::make_shared<ChainPackMetaTypeName>(value)) {}
@@ -441,7 +819,14 @@ void RpcValue::swap(RpcValue& other) noexcept
 
 RpcValue::Type RpcValue::type() const
 {
-	return m_ptr? m_ptr->type(): Type::Invalid;
+	if(isInline())
+		return m_scalarType;
+	return m_storage.ptr? m_storage.ptr->type(): Type::Invalid;
+}
+
+RpcValue::Type RpcValue::heapValue(const void *&val) const
+{
+	return m_storage.ptr? m_storage.ptr->typedValue(val): Type::Invalid;
 }
 /*
 RpcValue::Type RpcValue::arrayType() const
@@ -452,8 +837,8 @@ RpcValue::Type RpcValue::arrayType() const
 const RpcValue::MetaData &RpcValue::metaData() const
 {
 	static MetaData md;
-	if(m_ptr)
-		return m_ptr->metaData();
+	if(AbstractValueData *d = heapData())
+		return d->metaData();
 	return md;
 }
 
@@ -473,126 +858,362 @@ RpcValue RpcValue::metaValue(const RpcValue::String &key) const
 
 void RpcValue::setMetaData(RpcValue::MetaData &&meta_data)
 {
-	if(!m_ptr && !meta_data.isEmpty())
+	if(!isValid() && !meta_data.isEmpty())
 		SHVCHP_EXCEPTION("Cannot set valid meta data to invalid ChainPack value!");
-	if(m_ptr)
-		m_ptr->setMetaData(std::move(meta_data));
+	if(isInline()) {
+		if(meta_data.isEmpty())
+			return;
+		moveScalarToHeap();
+	}
+	detach();
+	if(AbstractValueData *d = heapData()) {
+		if(d->isFrozen()) {
+			meta_data.forEachIValue([d](Int, const RpcValue &val) { d->freezeIfFrozen(val); });
+			for(const auto &kv : meta_data.sValues())
+				d->freezeIfFrozen(kv.second);
+		}
+		d->setMetaData(std::move(meta_data));
+	}
 }
 
 void RpcValue::setMetaValue(RpcValue::Int key, const RpcValue &val)
 {
-	if(!m_ptr && val.isValid())
+	if(!isValid() && val.isValid())
 		SHVCHP_EXCEPTION("Cannot set valid meta value to invalid ChainPack value!");
-	if(m_ptr)
-		m_ptr->setMetaValue(key, val);
+	if(isInline()) {
+		if(!val.isValid())
+			return;
+		moveScalarToHeap();
+	}
+	detach();
+	if(AbstractValueData *d = heapData()) {
+		d->freezeIfFrozen(val);
+		d->setMetaValue(key, val);
+	}
 }
 
 void RpcValue::setMetaValue(const RpcValue::String &key, const RpcValue &val)
 {
-	if(!m_ptr && val.isValid())
+	if(!isValid() && val.isValid())
 		SHVCHP_EXCEPTION("Cannot set valid meta value to invalid ChainPack value!");
-	if(m_ptr)
-		m_ptr->setMetaValue(key, val);
+	if(isInline()) {
+		if(!val.isValid())
+			return;
+		moveScalarToHeap();
+	}
+	detach();
+	if(AbstractValueData *d = heapData()) {
+		d->freezeIfFrozen(val);
+		d->setMetaValue(key, val);
+	}
 }
 
 bool RpcValue::isValid() const
 {
-	return !!m_ptr;
+	return isInline() || m_storage.ptr;
+}
+
+double RpcValue::toDouble() const
+{
+	const Scalar &v = m_storage.scalar;
+	switch (m_scalarType) {
+	case Type::Invalid: return m_storage.ptr? m_storage.ptr->toDouble(): 0;
+	case Type::Double: return v.d;
+	case Type::Decimal: return v.decimal.toDouble();
+	case Type::Int: return v.i;
+	case Type::UInt: return v.u;
+	default: return 0;
+	}
+}
+
+RpcValue::Decimal RpcValue::toDecimal() const
+{
+	switch (m_scalarType) {
+	case Type::Invalid: return m_storage.ptr? m_storage.ptr->toDecimal(): Decimal();
+	case Type::Decimal: return m_storage.scalar.decimal;
+	default: return Decimal();
+	}
+}
+
+RpcValue::Int RpcValue::toInt() const
+{
+	const Scalar &v = m_storage.scalar;
+	switch (m_scalarType) {
+	case Type::Invalid: return m_storage.ptr? m_storage.ptr->toInt(): 0;
+	case Type::Double: return static_cast<Int>(v.d);
+	case Type::Decimal: return static_cast<Int>(v.decimal.toDouble());
+	case Type::Int: return static_cast<Int>(v.i);
+	case Type::UInt: return static_cast<Int>(v.u);
+	case Type::Bool: return v.b;
+	default: return 0;
+	}
+}
+
+RpcValue::UInt RpcValue::toUInt() const
+{
+	const Scalar &v = m_storage.scalar;
+	switch (m_scalarType) {
+	case Type::Invalid: return m_storage.ptr? m_storage.ptr->toUInt(): 0;
+	case Type::Double: return static_cast<UInt>(v.d);
+	case Type::Decimal: return static_cast<UInt>(v.decimal.toDouble());
+	case Type::Int: return static_cast<UInt>(v.i);
+	case Type::UInt: return static_cast<UInt>(v.u);
+	case Type::Bool: return v.b;
+	default: return 0;
+	}
+}
+
+int64_t RpcValue::toInt64() const
+{
+	const Scalar &v = m_storage.scalar;
+	switch (m_scalarType) {
+	case Type::Invalid: return m_storage.ptr? m_storage.ptr->toInt64(): 0;
+	case Type::Double: return static_cast<int64_t>(v.d);
+	case Type::Decimal: return static_cast<int64_t>(v.decimal.toDouble());
+	case Type::Int: return v.i;
+	case Type::UInt: return static_cast<int64_t>(v.u);
+	case Type::Bool: return v.b;
+	case Type::DateTime: return v.dateTime.msecsSinceEpoch();
+	default: return 0;
+	}
+}
+
+uint64_t RpcValue::toUInt64() const
+{
+	const Scalar &v = m_storage.scalar;
+	switch (m_scalarType) {
+	case Type::Invalid: return m_storage.ptr? m_storage.ptr->toUInt64(): 0;
+	case Type::Double: return static_cast<uint64_t>(v.d);
+	case Type::Decimal: return static_cast<uint64_t>(v.decimal.toDouble());
+	case Type::Int: return static_cast<uint64_t>(v.i);
+	case Type::UInt: return v.u;
+	case Type::Bool: return v.b;
+	case Type::DateTime: return static_cast<uint64_t>(v.dateTime.msecsSinceEpoch());
+	default: return 0;
+	}
+}
+
+bool RpcValue::toBool() const
+{
+	const Scalar &v = m_storage.scalar;
+	switch (m_scalarType) {
+	case Type::Invalid: return m_storage.ptr? m_storage.ptr->toBool(): false;
+	case Type::Double: return !(v.d == 0);
+	case Type::Decimal: return !(v.decimal.mantisa() == 0);
+	case Type::Int: return !(v.i == 0);
+	case Type::UInt: return !(v.u == 0);
+	case Type::Bool: return v.b;
+	case Type::DateTime: return v.dateTime.msecsSinceEpoch() != 0;
+	default: return false;
+	}
+}
+
+RpcValue::DateTime RpcValue::toDateTime() const
+{
+	switch (m_scalarType) {
+	case Type::Invalid: return m_storage.ptr? m_storage.ptr->toDateTime(): DateTime();
+	case Type::DateTime: return m_storage.scalar.dateTime;
+	default: return DateTime();
+	}
 }
 
-double RpcValue::toDouble() const { return m_ptr? m_ptr->toDouble(): 0; }
-RpcValue::Decimal RpcValue::toDecimal() const { return m_ptr? m_ptr->toDecimal(): Decimal(); }
-RpcValue::Int RpcValue::toInt() const { return m_ptr? m_ptr->toInt(): 0; }
-RpcValue::UInt RpcValue::toUInt() const { return m_ptr? m_ptr->toUInt(): 0; }
-int64_t RpcValue::toInt64() const { return m_ptr? m_ptr->toInt64(): 0; }
-uint64_t RpcValue::toUInt64() const { return m_ptr? m_ptr->toUInt64(): 0; }
-bool RpcValue::toBool() const { return m_ptr? m_ptr->toBool(): false; }
-RpcValue::DateTime RpcValue::toDateTime() const { return m_ptr? m_ptr->toDateTime(): RpcValue::DateTime{}; }
+const std::string & RpcValue::toString() const { AbstractValueData *d = heapData(); return d? d->toString(): static_empty_string(); }
+const RpcValue::Blob &RpcValue::toBlob() const { AbstractValueData *d = heapData(); return d? d->toBlob(): static_empty_blob(); }
+const RpcValue::Blob *RpcValue::stringData() const { AbstractValueData *d = heapData(); return d? d->stringData(): nullptr; }
 
-const std::string & RpcValue::toString() const { return m_ptr? m_ptr->toString(): static_empty_string(); }
-//const RpcValue::Blob &RpcValue::toBlob() const { return m_ptr? m_ptr->toBlob(): static_empty_blob(); }
+size_t RpcValue::count() const { AbstractValueData *d = heapData(); return d? d->count(): 0; }
+const RpcValue::List & RpcValue::toList() const { AbstractValueData *d = heapData(); return d? d->toList(): static_empty_list(); }
+const RpcValue::Array & RpcValue::toArray() const { AbstractValueData *d = heapData(); return d? d->toArray(): static_empty_array(); }
+const RpcValue::Map & RpcValue::toMap() const { AbstractValueData *d = heapData(); return d? d->toMap(): static_empty_map(); }
+const RpcValue::IMap &RpcValue::toIMap() const { AbstractValueData *d = heapData(); return d? d->toIMap(): static_empty_imap(); }
 
-size_t RpcValue::count() const { return m_ptr? m_ptr->count(): 0; }
-const RpcValue::List & RpcValue::toList() const { return m_ptr? m_ptr->toList(): static_empty_list(); }
-const RpcValue::Map & RpcValue::toMap() const { return m_ptr? m_ptr->toMap(): static_empty_map(); }
-const RpcValue::IMap &RpcValue::toIMap() const { return m_ptr? m_ptr->toIMap(): static_empty_imap(); }
-RpcValue RpcValue::at (RpcValue::Int i) const { return m_ptr? m_ptr->at(i): RpcValue(); }
-RpcValue RpcValue::at (const RpcValue::String &key) const { return m_ptr? m_ptr->at(key): RpcValue(); }
-bool RpcValue::has (RpcValue::Int i) const { return m_ptr? m_ptr->has(i): false; }
-bool RpcValue::has (const RpcValue::String &key) const { return m_ptr? m_ptr->has(key): false; }
+bool RpcValue::isPersistentMap() const
+{
+	AbstractValueData *d = heapData();
+	return d && d->persistentMap();
+}
 
-std::string RpcValue::toStdString() const { return m_ptr? m_ptr->toStdString(): std::string(); }
+PersistentMap RpcValue::toPersistentMap() const
+{
+	if(AbstractValueData *d = heapData()) {
+		if(const PersistentMap *map = d->persistentMap())
+			return *map;
+	}
+	return PersistentMap(toMap());
+}
+
+RpcValue RpcValue::at (RpcValue::Int i) const { AbstractValueData *d = heapData(); return d? d->at(i): RpcValue(); }
+RpcValue RpcValue::at (const RpcValue::String &key) const { AbstractValueData *d = heapData(); return d? d->at(key): RpcValue(); }
+bool RpcValue::has (RpcValue::Int i) const { AbstractValueData *d = heapData(); return d? d->has(i): false; }
+bool RpcValue::has (const RpcValue::String &key) const { AbstractValueData *d = heapData(); return d? d->has(key): false; }
+
+std::string RpcValue::toStdString() const
+{
+	const Scalar &v = m_storage.scalar;
+	switch (m_scalarType) {
+	case Type::Invalid: return m_storage.ptr? m_storage.ptr->toStdString(): std::string();
+	case Type::Null: return "null";
+	case Type::Double: return Utils::toString(v.d);
+	case Type::Decimal: return v.decimal.toString();
+	case Type::Int: return Utils::toString(v.i);
+	case Type::UInt: return Utils::toString(v.u);
+	case Type::Bool: return v.b? "true": "false";
+	case Type::DateTime: return v.dateTime.toIsoString();
+	default: return std::string();
+	}
+}
 
 void RpcValue::set(RpcValue::Int ix, const RpcValue &val)
 {
-	if(m_ptr)
-		m_ptr->set(ix, val);
+	set(ix, RpcValue(val));
+}
+
+void RpcValue::set(RpcValue::Int ix, RpcValue &&val)
+{
+	detach();
+	if(AbstractValueData *d = heapData()) {
+		d->resetHash();
+		d->freezeIfFrozen(val);
+		d->set(ix, std::move(val));
+	}
 	else
-		nError() << " Cannot set value to invalid ChainPack value! Index: " << ix;
+		nError() << " Cannot set value to invalid or scalar ChainPack value! Index: " << ix;
 }
 
 void RpcValue::set(const RpcValue::String &key, const RpcValue &val)
 {
-	if(m_ptr)
-		m_ptr->set(key, val);
+	set(key, RpcValue(val));
+}
+
+void RpcValue::set(const RpcValue::String &key, RpcValue &&val)
+{
+	detach();
+	if(AbstractValueData *d = heapData()) {
+		d->resetHash();
+		d->freezeIfFrozen(val);
+		d->set(key, std::move(val));
+	}
 	else
-		nError() << " Cannot set value to invalid ChainPack value! Key: " << key;
+		nError() << " Cannot set value to invalid or scalar ChainPack value! Key: " << key;
 }
 
 void RpcValue::append(const RpcValue &val)
 {
-	if(m_ptr)
-		m_ptr->append(val);
+	append(RpcValue(val));
+}
+
+void RpcValue::append(RpcValue &&val)
+{
+	detach();
+	if(AbstractValueData *d = heapData()) {
+		d->resetHash();
+		d->freezeIfFrozen(val);
+		d->append(std::move(val));
+	}
 	else
-		nError() << "Cannot append to invalid ChainPack value!";
+		nError() << "Cannot append to invalid or scalar ChainPack value!";
+}
+
+RpcValue::List RpcValue::takeList()
+{
+	List ret;
+	if(type() == Type::List) {
+		if(m_storage.ptr.use_count() == 1)
+			ret = static_cast<ChainPackList*>(heapData())->take();
+		else
+			ret = toList();
+	}
+	*this = RpcValue();
+	return ret;
+}
+
+RpcValue::Map RpcValue::takeMap()
+{
+	Map ret;
+	if(type() == Type::Map) {
+		if(m_storage.ptr.use_count() == 1 && !heapData()->persistentMap())
+			ret = static_cast<ChainPackMap*>(heapData())->take();
+		else
+			ret = toMap();
+	}
+	*this = RpcValue();
+	return ret;
+}
+
+RpcValue::IMap RpcValue::takeIMap()
+{
+	IMap ret;
+	if(type() == Type::IMap) {
+		if(m_storage.ptr.use_count() == 1)
+			ret = static_cast<ChainPackIMap*>(heapData())->take();
+		else
+			ret = toIMap();
+	}
+	*this = RpcValue();
+	return ret;
+}
+
+void RpcValue::detach()
+{
+	if(!isInline() && m_storage.ptr && m_storage.ptr.use_count() > 1)
+		m_storage.ptr = DataPtr(m_storage.ptr->clone());
 }
 
 std::string RpcValue::toPrettyString(const std::string &indent) const
 {
-	std::ostringstream out;
+	std::string out;
 	{
 		CponWriterOptions opts;
 		opts.setTranslateIds(true).setIndent(indent);
 		CponWriter wr(out, opts);
 		wr << *this;
 	}
-	return out.str();
+	return out;
 }
 
 std::string RpcValue::toCpon(const std::string &indent) const
 {
-	std::ostringstream out;
+	std::string out;
 	{
 		CponWriterOptions opts;
 		opts.setTranslateIds(false).setIndent(indent);
 		CponWriter wr(out, opts);
 		wr << *this;
 	}
-	return out.str();
+	return out;
 }
 
 const std::string & RpcValue::AbstractValueData::toString() const { return static_empty_string(); }
-//const RpcValue::Blob & RpcValue::AbstractValueData::toBlob() const { return static_empty_blob(); }
+const RpcValue::Blob & RpcValue::AbstractValueData::toBlob() const { return static_empty_blob(); }
 const RpcValue::List & RpcValue::AbstractValueData::toList() const { return static_empty_list(); }
+const RpcValue::Array & RpcValue::AbstractValueData::toArray() const { return static_empty_array(); }
 const RpcValue::Map & RpcValue::AbstractValueData::toMap() const { return static_empty_map(); }
 const RpcValue::IMap & RpcValue::AbstractValueData::toIMap() const { return static_empty_imap(); }
 
-void RpcValue::AbstractValueData::set(RpcValue::Int ix, const RpcValue &)
+void RpcValue::AbstractValueData::set(RpcValue::Int ix, RpcValue &&)
 {
 	nError() << "RpcValue::AbstractValueData::set: trivial implementation called! Key: " << ix;
 }
 
-void RpcValue::AbstractValueData::set(const RpcValue::String &key, const RpcValue &)
+void RpcValue::AbstractValueData::set(const RpcValue::String &key, RpcValue &&)
 {
 	nError() << "RpcValue::AbstractValueData::set: trivial implementation called! Key: " << key;
 }
 
-void RpcValue::AbstractValueData::append(const RpcValue &)
+void RpcValue::AbstractValueData::append(RpcValue &&)
 {
 	nError() << "RpcValue::AbstractValueData::append: trivial implementation called!";
 }
 
 
+bool ChainPackList::childrenHaveArenaData() const
+{
+	for(const RpcValue &val : m_value)
+		if(hasArenaData(val))
+			return true;
+	return false;
+}
+
 RpcValue ChainPackList::at(RpcValue::Int ix) const
 {
 	if(ix < 0)
@@ -603,31 +1224,182 @@ RpcValue ChainPackList::at(RpcValue::Int ix) const
 		return m_value[static_cast<size_t>(ix)];
 }
 
-void ChainPackList::set(RpcValue::Int ix, const RpcValue &val)
+void ChainPackList::set(RpcValue::Int ix, RpcValue &&val)
 {
 	if(ix < 0)
 		ix = static_cast<RpcValue::Int>(m_value.size()) + ix;
-	if(ix > 0) {
-		if (ix == (int)m_value.size())
+	if(ix >= 0) {
+		if (ix >= (int)m_value.size())
 			m_value.resize(static_cast<size_t>(ix) + 1);
-		m_value[static_cast<size_t>(ix)] = val;
+		m_value[static_cast<size_t>(ix)] = std::move(val);
+	}
+}
+
+RpcValue::Blob::Blob(std::string &&data)
+{
+	auto buffer = std::make_shared<const std::string>(std::move(data));
+	m_data = buffer->data();
+	m_size = buffer->size();
+	m_owner = std::move(buffer);
+}
+
+RpcValue::Blob RpcValue::Blob::mid(size_t pos, size_t len) const
+{
+	if(pos > m_size)
+		pos = m_size;
+	if(len > m_size - pos)
+		len = m_size - pos;
+	return Blob(m_owner, m_data + pos, len);
+}
+
+bool RpcValue::Blob::operator==(const RpcValue::Blob &o) const
+{
+	if(m_size != o.m_size)
+		return false;
+	return m_size == 0 || m_data == o.m_data || std::memcmp(m_data, o.m_data, m_size) == 0;
+}
+
+size_t RpcValue::Array::size() const
+{
+	switch(m_type) {
+	case Type::Int: return m_intValues.size();
+	case Type::UInt: return m_uintValues.size();
+	case Type::Double: return m_doubleValues.size();
+	default: return 0;
+	}
+}
+
+void RpcValue::Array::reserve(size_t n)
+{
+	switch(m_type) {
+	case Type::Int: m_intValues.reserve(n); break;
+	case Type::UInt: m_uintValues.reserve(n); break;
+	case Type::Double: m_doubleValues.reserve(n); break;
+	default: break;
+	}
+}
+
+RpcValue RpcValue::Array::value(size_t ix) const
+{
+	if(ix >= size())
+		return RpcValue();
+	switch(m_type) {
+	case Type::Int: return RpcValue(m_intValues[ix]);
+	case Type::UInt: return RpcValue(m_uintValues[ix]);
+	case Type::Double: return RpcValue(m_doubleValues[ix]);
+	default: return RpcValue();
 	}
 }
 
+RpcValue::List RpcValue::Array::toList() const
+{
+	List ret;
+	ret.reserve(size());
+	for (size_t i = 0; i < size(); ++i)
+		ret.push_back(value(i));
+	return ret;
+}
+
+RpcValue ChainPackArray::at(RpcValue::Int ix) const
+{
+	if(ix < 0)
+		ix = static_cast<RpcValue::Int>(m_value.size()) + ix;
+	if(ix < 0)
+		return static_chain_pack_invalid();
+	return m_value.value(static_cast<size_t>(ix));
+}
+
+const std::string &ChainPackStringData::toString() const
+{
+	std::call_once(m_stringOnce, [this]() {
+		m_string.assign(m_value.data(), m_value.size());
+	});
+	return m_string;
+}
+
+
 /* * * * * * * * * * * * * * * * * * * *
  * Comparison
  */
+size_t RpcValue::hash() const
+{
+	const Scalar &v = m_storage.scalar;
+	switch (m_scalarType) {
+	case Type::Invalid: return m_storage.ptr? m_storage.ptr->hash(): 0;
+	case Type::Null: return 1;
+	case Type::Bool: return v.b? 3: 2;
+	// Int and UInt are compared as int64
+	case Type::Int: return std::hash<int64_t>()(v.i);
+	case Type::UInt: return std::hash<int64_t>()(static_cast<int64_t>(v.u));
+	// Double and Decimal are compared as double
+	case Type::Double:
+	case Type::Decimal: {
+		double d = toDouble();
+		return d == 0? 0: std::hash<double>()(d);
+	}
+	case Type::DateTime: return std::hash<int64_t>()(v.dateTime.msecsSinceEpoch());
+	default: return 0;
+	}
+}
+
+size_t ChainPackList::computeHash() const
+{
+	size_t h = static_cast<size_t>(RpcValue::Type::List);
+	for(const RpcValue &val : m_value)
+		h = hash_combine(h, val.hash());
+	return h;
+}
+
+size_t ChainPackArray::computeHash() const
+{
+	size_t h = static_cast<size_t>(RpcValue::Type::Array);
+	for (size_t i = 0; i < m_value.size(); ++i)
+		h = hash_combine(h, m_value.value(i).hash());
+	return h;
+}
+
+size_t ChainPackIMap::computeHash() const
+{
+	size_t h = static_cast<size_t>(RpcValue::Type::IMap);
+	for(const auto &kv : m_value)
+		h = hash_combine(hash_combine(h, std::hash<RpcValue::Int>()(kv.first)), kv.second.hash());
+	return h;
+}
+
 bool RpcValue::operator== (const RpcValue &other) const
 {
 	if(isValid() && other.isValid()) {
+		Type t = type();
+		Type ot = other.type();
 		if (
-			(m_ptr->type() == other.m_ptr->type())
-			|| (m_ptr->type() == RpcValue::Type::UInt && other.m_ptr->type() == RpcValue::Type::Int)
-			|| (m_ptr->type() == RpcValue::Type::Int && other.m_ptr->type() == RpcValue::Type::UInt)
-			|| (m_ptr->type() == RpcValue::Type::Double && other.m_ptr->type() == RpcValue::Type::Decimal)
-			|| (m_ptr->type() == RpcValue::Type::Decimal && other.m_ptr->type() == RpcValue::Type::Double)
+			(t == ot)
+			|| (t == RpcValue::Type::UInt && ot == RpcValue::Type::Int)
+			|| (t == RpcValue::Type::Int && ot == RpcValue::Type::UInt)
+			|| (t == RpcValue::Type::Double && ot == RpcValue::Type::Decimal)
+			|| (t == RpcValue::Type::Decimal && ot == RpcValue::Type::Double)
 		) {
-			return m_ptr->equals(other.m_ptr.get());
+			switch (t) {
+			case Type::Null: return other.isNull();
+			case Type::Bool: return toBool() == other.toBool();
+			case Type::Int: return toInt64() == other.toInt64();
+			case Type::UInt: return toUInt64() == other.toUInt64();
+			case Type::Double:
+			case Type::Decimal: return toDouble() == other.toDouble();
+			case Type::DateTime: return toDateTime().msecsSinceEpoch() == other.toDateTime().msecsSinceEpoch();
+			default: {
+				// shared data (atoms, copies) are equal without comparing content
+				AbstractValueData *d = heapData();
+				AbstractValueData *od = other.heapData();
+				if(d == od)
+					return true;
+				// values with different cached hashes cannot be equal
+				size_t h = d->cachedHash();
+				size_t oh = od->cachedHash();
+				if(h && oh && h != oh)
+					return false;
+				return d->equals(od);
+			}
+			}
 		}
 		return false;
 	}
@@ -648,8 +1420,7 @@ bool ChainPack::operator< (const ChainPack &other) const
 RpcValue RpcValue::fromCpon(const std::string &str, std::string *err)
 {
 	RpcValue ret;
-	std::istringstream in(str);
-	CponReader rd(in);
+	CponReader rd(str.data(), str.size());
 	if(err) {
 		err->clear();
 		try {
@@ -670,19 +1441,19 @@ RpcValue RpcValue::fromCpon(const std::string &str, std::string *err)
 
 std::string RpcValue::toChainPack() const
 {
-	std::ostringstream out;
+	std::string out;
+	out.reserve(ChainPack::packedSize(*this));
 	{
 		ChainPackWriter wr(out);
 		wr << *this;
 	}
-	return out.str();
+	return out;
 }
 
 RpcValue RpcValue::fromChainPack(const std::string &str, std::string *err)
 {
 	RpcValue ret;
-	std::istringstream in(str);
-	ChainPackReader rd(in);
+	ChainPackReader rd(str.data(), str.size());
 	if(err) {
 		err->clear();
 		try {
@@ -710,18 +1481,27 @@ const char *RpcValue::typeToName(RpcValue::Type t)
 	case Type::Int: return "Int";
 	case Type::Double: return "Double";
 	case Type::Bool: return "Bool";
-	//case Type::Blob: return "Blob";
 	case Type::String: return "String";
 	case Type::List: return "List";
+	case Type::Array: return "Array";
 	case Type::Map: return "Map";
 	case Type::IMap: return "IMap";
 	case Type::DateTime: return "DateTime";
 	//case Type::MetaIMap: return "MetaIMap";
 	case Type::Decimal: return "Decimal";
+	case Type::Blob: return "Blob";
 	}
 	return "UNKNOWN"; // just to remove mingw warning
 }
 
+bool ChainPackMap::childrenHaveArenaData() const
+{
+	for(const auto &kv : m_value)
+		if(hasArenaData(kv.second))
+			return true;
+	return false;
+}
+
 bool ChainPackMap::has(const RpcValue::String &key) const
 {
 	auto iter = m_value.find(key);
@@ -734,14 +1514,84 @@ RpcValue ChainPackMap::at(const RpcValue::String &key) const
 	return (iter == m_value.end()) ? static_chain_pack_invalid() : iter->second;
 }
 
-void ChainPackMap::set(const RpcValue::String &key, const RpcValue &val)
+void ChainPackMap::set(const RpcValue::String &key, RpcValue &&val)
 {
 	if(val.isValid())
-		m_value[key] = val;
+		m_value[key] = std::move(val);
 	else
 		m_value.erase(key);
 }
 
+void ChainPackPersistentMap::set(const RpcValue::String &key, RpcValue &&val)
+{
+	m_value.setValue(key, val);
+	m_map.reset();
+}
+
+void ChainPackPersistentMap::freezeChildren()
+{
+	m_value.forEach([](const RpcValue::String &, const RpcValue &val) { val.freezeForSharing(); });
+}
+
+bool ChainPackPersistentMap::childrenHaveArenaData() const
+{
+	bool ret = false;
+	m_value.forEach([&ret](const RpcValue::String &, const RpcValue &val) { ret = ret || hasArenaData(val); });
+	return ret;
+}
+
+void ChainPackPersistentMap::promoteChildren()
+{
+	PersistentMap promoted = m_value;
+	m_value.forEach([&promoted](const RpcValue::String &key, const RpcValue &val) {
+		if(hasArenaData(val)) {
+			RpcValue v = val;
+			v.promoteFromArena();
+			promoted.setValue(key, v);
+		}
+	});
+	m_value = promoted;
+	m_map.reset();
+}
+
+bool ChainPackPersistentMap::equals(const RpcValue::AbstractValueData *other) const
+{
+	if(m_value.size() != other->count())
+		return false;
+	const PersistentMap *other_pm = other->persistentMap();
+	const RpcValue::Map *other_map = other_pm? nullptr: &other->toMap();
+	bool ret = true;
+	m_value.forEach([&ret, other_pm, other_map](const RpcValue::String &key, const RpcValue &val) {
+		if(!ret)
+			return;
+		if(other_pm) {
+			const RpcValue *other_val = other_pm->find(key);
+			ret = other_val && *other_val == val;
+		}
+		else {
+			auto it = other_map->find(key);
+			ret = it != other_map->end() && it->second == val;
+		}
+	});
+	return ret;
+}
+
+const RpcValue::Map &ChainPackPersistentMap::toMap() const
+{
+	std::lock_guard<std::mutex> lock(m_mapMutex);
+	if(!m_map)
+		m_map.reset(new RpcValue::Map(m_value.toMap()));
+	return *m_map;
+}
+
+bool ChainPackIMap::childrenHaveArenaData() const
+{
+	for(const auto &kv : m_value)
+		if(hasArenaData(kv.second))
+			return true;
+	return false;
+}
+
 bool ChainPackIMap::has(RpcValue::Int key) const
 {
 	auto iter = m_value.find(key);
@@ -754,10 +1604,10 @@ RpcValue ChainPackIMap::at(RpcValue::Int key) const
 	return (iter == m_value.end()) ? static_chain_pack_invalid() : iter->second;
 }
 
-void ChainPackIMap::set(RpcValue::Int key, const RpcValue &val)
+void ChainPackIMap::set(RpcValue::Int key, RpcValue &&val)
 {
 	if(val.isValid())
-		m_value[key] = val;
+		m_value[key] = std::move(val);
 	else
 		m_value.erase(key);
 }
@@ -803,7 +1653,7 @@ RpcValue::DateTime RpcValue::DateTime::fromLocalString(const std::string &local_
 	utc_offset = (tim - utc_tim) / 60;
 	epoch_msec = static_cast<int64_t>(utc_tim) * 60 * 1000 + msec;
 	ret.m_dtm.msec = epoch_msec;
-	ret.m_dtm.tz = utc_offset;
+	ret.setTimeZone(utc_offset);
 
 	return ret;
 }
@@ -823,7 +1673,7 @@ RpcValue::DateTime RpcValue::DateTime::fromUtcString(const std::string &utc_date
 		return ret;
 	}
 	ret.m_dtm.msec = epoch_msec;
-	ret.m_dtm.tz = utc_offset;
+	ret.setTimeZone(utc_offset);
 
 	if(plen)
 		*plen = len;
@@ -906,6 +1756,10 @@ std::string RpcValue::DateTime::toIsoString(RpcValue::DateTime::MsecPolicy msec_
 #endif
 }
 
+constexpr RpcValue::Int RpcValue::MetaData::SLOT_KEY_MIN;
+constexpr RpcValue::Int RpcValue::MetaData::SLOT_KEY_MAX;
+constexpr RpcValue::Int RpcValue::MetaData::SLOT_COUNT;
+
 RpcValue::MetaData::MetaData(RpcValue::MetaData &&o)
 	: MetaData()
 {
@@ -914,8 +1768,8 @@ RpcValue::MetaData::MetaData(RpcValue::MetaData &&o)
 
 RpcValue::MetaData::MetaData(RpcValue::IMap &&imap)
 {
-	if(!imap.empty())
-		m_imap = new RpcValue::IMap(std::move(imap));
+	for(auto &kv : imap)
+		setValue(kv.first, std::move(kv.second));
 }
 
 RpcValue::MetaData::MetaData(RpcValue::Map &&smap)
@@ -925,23 +1779,24 @@ RpcValue::MetaData::MetaData(RpcValue::Map &&smap)
 }
 
 RpcValue::MetaData::MetaData(RpcValue::IMap &&imap, RpcValue::Map &&smap)
+	: MetaData(std::move(smap))
 {
-	if(!imap.empty())
-		m_imap = new RpcValue::IMap(std::move(imap));
-	if(!smap.empty())
-		m_smap = new RpcValue::Map(std::move(smap));
+	for(auto &kv : imap)
+		setValue(kv.first, std::move(kv.second));
 }
 
 RpcValue::MetaData::MetaData(const RpcValue::MetaData &o)
 {
-	for(auto kv : o.iValues())
-		setValue(kv.first, kv.second);
-	for(auto kv : o.sValues())
-		setValue(kv.first, kv.second);
+	o.forEachIValue([this](RpcValue::Int key, const RpcValue &val) {
+		setValue(key, val);
+	});
+	if(o.m_smap && !o.m_smap->empty())
+		m_smap = new RpcValue::Map(*o.m_smap);
 }
 
 RpcValue::MetaData::~MetaData()
 {
+	delete[] m_slots;
 	if(m_imap)
 		delete m_imap;
 	if(m_smap)
@@ -951,8 +1806,9 @@ RpcValue::MetaData::~MetaData()
 std::vector<RpcValue::Int> RpcValue::MetaData::iKeys() const
 {
 	std::vector<RpcValue::Int> ret;
-	for(const auto &it : iValues())
-		ret.push_back(it.first);
+	forEachIValue([&ret](RpcValue::Int key, const RpcValue &) {
+		ret.push_back(key);
+	});
 	return ret;
 }
 
@@ -966,9 +1822,7 @@ std::vector<RpcValue::String> RpcValue::MetaData::sKeys() const
 
 bool RpcValue::MetaData::hasKey(RpcValue::Int key) const
 {
-	const IMap &m = iValues();
-	auto it = m.find(key);
-	return (it != m.end());
+	return valueRef(key).isValid();
 }
 
 bool RpcValue::MetaData::hasKey(const RpcValue::String &key) const
@@ -980,11 +1834,22 @@ bool RpcValue::MetaData::hasKey(const RpcValue::String &key) const
 
 RpcValue RpcValue::MetaData::value(RpcValue::Int key) const
 {
-	const IMap &m = iValues();
-	auto it = m.find(key);
-	if(it != m.end())
-		return it->second;
-	return RpcValue();
+	return valueRef(key);
+}
+
+const RpcValue &RpcValue::MetaData::valueRef(RpcValue::Int key) const
+{
+	if(isSlotKey(key)) {
+		if(m_slotMask & (1u << (key - SLOT_KEY_MIN)))
+			return m_slots[key - SLOT_KEY_MIN];
+		return static_chain_pack_invalid();
+	}
+	if(m_imap) {
+		auto it = m_imap->find(key);
+		if(it != m_imap->end())
+			return it->second;
+	}
+	return static_chain_pack_invalid();
 }
 
 RpcValue RpcValue::MetaData::value(const String &key) const
@@ -998,7 +1863,20 @@ RpcValue RpcValue::MetaData::value(const String &key) const
 
 void RpcValue::MetaData::setValue(RpcValue::Int key, const RpcValue &val)
 {
-	if(val.isValid()) {
+	if(isSlotKey(key)) {
+		uint32_t bit = 1u << (key - SLOT_KEY_MIN);
+		if(val.isValid()) {
+			if(!m_slots)
+				m_slots = new RpcValue[SLOT_COUNT];
+			m_slots[key - SLOT_KEY_MIN] = val;
+			m_slotMask |= bit;
+		}
+		else if(m_slotMask & bit) {
+			m_slots[key - SLOT_KEY_MIN] = RpcValue();
+			m_slotMask &= ~bit;
+		}
+	}
+	else if(val.isValid()) {
 		if(!m_imap)
 			m_imap = new RpcValue::IMap();
 		(*m_imap)[key] = val;
@@ -1024,26 +1902,28 @@ void RpcValue::MetaData::setValue(const RpcValue::String &key, const RpcValue &v
 
 bool RpcValue::MetaData::isEmpty() const
 {
-	return (!m_imap || m_imap->empty()) && (!m_smap || m_smap->empty());
+	return m_slotMask == 0 && (!m_imap || m_imap->empty()) && (!m_smap || m_smap->empty());
 }
 
 bool RpcValue::MetaData::operator==(const RpcValue::MetaData &o) const
 {
-	/*
-	std::cerr << "this" << std::endl;
-	for(const auto &it : m_imap)
-		std::cerr << '\t' << it.first << ": " << it.second.dumpText() << std::endl;
-	std::cerr << "other" << std::endl;
-	for(const auto &it : o.m_imap)
-		std::cerr << '\t' << it.first << ": " << it.second.dumpText() << std::endl;
-	*/
-	return iValues() == o.iValues() && sValues() == o.sValues();
+	if(m_slotMask != o.m_slotMask)
+		return false;
+	for (RpcValue::Int i = 0; i < SLOT_COUNT; ++i) {
+		if((m_slotMask & (1u << i)) && !(m_slots[i] == o.m_slots[i]))
+			return false;
+	}
+	static const RpcValue::IMap empty_map;
+	return (m_imap? *m_imap: empty_map) == (o.m_imap? *o.m_imap: empty_map) && sValues() == o.sValues();
 }
 
-const RpcValue::IMap &RpcValue::MetaData::iValues() const
+RpcValue::IMap RpcValue::MetaData::iValues() const
 {
-	static RpcValue::IMap m;
-	return m_imap? *m_imap: m;
+	RpcValue::IMap ret;
+	forEachIValue([&ret](RpcValue::Int key, const RpcValue &val) {
+		ret[key] = val;
+	});
+	return ret;
 }
 
 const RpcValue::Map &RpcValue::MetaData::sValues() const
@@ -1054,22 +1934,29 @@ const RpcValue::Map &RpcValue::MetaData::sValues() const
 
 std::string RpcValue::MetaData::toPrettyString() const
 {
-	std::ostringstream out;
+	std::string out;
 	{
 		CponWriterOptions opts;
 		opts.setTranslateIds(true);
 		CponWriter wr(out, opts);
 		wr << *this;
 	}
-	return out.str();
+	return out;
 }
 
 void RpcValue::MetaData::swap(RpcValue::MetaData &o)
 {
+	std::swap(m_slots, o.m_slots);
+	std::swap(m_slotMask, o.m_slotMask);
 	std::swap(m_imap, o.m_imap);
 	std::swap(m_smap, o.m_smap);
 }
 
+double RpcValue::Decimal::toDouble() const
+{
+	return ccpcp_decimal_to_double(mantisa(), exponent());
+}
+
 std::string RpcValue::Decimal::toString() const
 {
 	std::string ret = RpcValue(*this).toCpon();
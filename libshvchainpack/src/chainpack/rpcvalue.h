@@ -3,12 +3,14 @@
 #include "../shvchainpackglobal.h"
 #include "exception.h"
 #include "metatypes.h"
+#include "flatmap.h"
 
 #include <string>
 #include <vector>
 #include <map>
 #include <memory>
 #include <initializer_list>
+#include <utility>
 
 #ifndef CHAINPACK_UINT
 	#define CHAINPACK_UINT unsigned
@@ -16,6 +18,8 @@
 namespace shv {
 namespace chainpack {
 
+class PersistentMap;
+
 class SHVCHAINPACK_DECL_EXPORT RpcValue
 {
 public:
@@ -28,14 +32,15 @@ public:
 		Int,
 		Double,
 		Bool,
-		//Blob //deprecated, not used
 		String,
 		DateTime,
 		List,
-		//Array,
 		Map,
 		IMap,
 		Decimal,
+		Blob,
+		// appended to keep values of older types
+		Array,
 		//MetaMap,
 	};
 	static const char* typeToName(Type t);
@@ -77,16 +82,8 @@ public:
 			Decimal dc = fromDouble(d, -m_num.exponent);
 			m_num.mantisa = dc.mantisa();
 		}
-		double toDouble() const
-		{
-			double ret = mantisa();
-			int exp = exponent();
-			if(exp > 0)
-				for(; exp > 0; exp--) ret *= Base;
-			else
-				for(; exp < 0; exp++) ret /= Base;
-			return ret;
-		}
+		/// correctly rounded, Decimal read from shortest Cpon double gives the same double back
+		double toDouble() const;
 		//bool isValid() const {return !(mantisa() == 0 && exponent() != 0);}
 		std::string toString() const;
 	};
@@ -147,19 +144,35 @@ public:
 		MsTz m_dtm = {0, 0};
 	};
 	using String = std::string;
-	/*
-	struct SHVCHAINPACK_DECL_EXPORT Blob : public std::basic_string<char>
+	/// Immutable binary data, slice of a shared buffer like received frame or file content.
+	/// Copies and slices reference the same buffer, data are never copied.
+	/// Blob is packed as CP_Blob_depr which older peers and chainpack.js cannot read,
+	/// use RpcValue::fromStringData() to send it as String without copying.
+	class SHVCHAINPACK_DECL_EXPORT Blob
 	{
-	private:
-		using Super = std::basic_string<char>;
 	public:
-		using Super::Super; // expose base class constructors
-		Blob() : Super() {}
-		Blob(const Super &str) : Super(str) {}
-		Blob(Super &&str) : Super(std::move(str)) {}
-		//const std::string& toString() const {return *this;}
+		Blob() {}
+		explicit Blob(std::string &&data);
+		explicit Blob(const std::string &data) : Blob(std::string(data)) {}
+		Blob(const char *data, size_t size) : Blob(std::string(data, size)) {}
+		/// data must stay valid and unchanged as long as owner exists
+		Blob(std::shared_ptr<const void> owner, const char *data, size_t size)
+			: m_owner(std::move(owner)), m_data(data), m_size(size) {}
+
+		const char* data() const {return m_data;}
+		size_t size() const {return m_size;}
+		bool empty() const {return m_size == 0;}
+		const std::shared_ptr<const void>& owner() const {return m_owner;}
+		Blob mid(size_t pos, size_t len = std::string::npos) const;
+		std::string toString() const {return std::string(m_data, m_size);}
+
+		bool operator==(const Blob &o) const;
+		bool operator!=(const Blob &o) const {return !operator==(o);}
+	private:
+		std::shared_ptr<const void> m_owner;
+		const char *m_data = nullptr;
+		size_t m_size = 0;
 	};
-	*/
 	class List : public std::vector<RpcValue>
 	{
 		using Super = std::vector<RpcValue>;
@@ -172,9 +185,53 @@ public:
 			return operator [](ix);
 		}
 	};
-	class Map : public std::map<String, RpcValue>
+	/// Homogeneous array of Int, UInt or Double values,
+	/// packed as ChainPack typed array without per element schema byte.
+	/// Cpon has no typed array notation, Array is written as List there and read back as List.
+	class SHVCHAINPACK_DECL_EXPORT Array
+	{
+	public:
+		Array() {}
+		explicit Array(Type element_type) : m_type(element_type) {}
+		Array(const std::vector<int64_t> &values) : m_type(Type::Int), m_intValues(values) {}
+		Array(std::vector<int64_t> &&values) : m_type(Type::Int), m_intValues(std::move(values)) {}
+		Array(const std::vector<uint64_t> &values) : m_type(Type::UInt), m_uintValues(values) {}
+		Array(std::vector<uint64_t> &&values) : m_type(Type::UInt), m_uintValues(std::move(values)) {}
+		Array(const std::vector<double> &values) : m_type(Type::Double), m_doubleValues(values) {}
+		Array(std::vector<double> &&values) : m_type(Type::Double), m_doubleValues(std::move(values)) {}
+
+		/// element type, Invalid for default constructed array
+		Type type() const {return m_type;}
+		size_t size() const;
+		bool empty() const {return size() == 0;}
+		void reserve(size_t n);
+		RpcValue value(size_t ix) const;
+		/// elements converted to List, conversion is done on each call
+		List toList() const;
+
+		const std::vector<int64_t>& intValues() const {return m_intValues;}
+		std::vector<int64_t>& intValues() {return m_intValues;}
+		const std::vector<uint64_t>& uintValues() const {return m_uintValues;}
+		std::vector<uint64_t>& uintValues() {return m_uintValues;}
+		const std::vector<double>& doubleValues() const {return m_doubleValues;}
+		std::vector<double>& doubleValues() {return m_doubleValues;}
+
+		bool operator==(const Array &o) const
+		{
+			return m_type == o.m_type
+					&& m_intValues == o.m_intValues
+					&& m_uintValues == o.m_uintValues
+					&& m_doubleValues == o.m_doubleValues;
+		}
+	private:
+		Type m_type = Type::Invalid;
+		std::vector<int64_t> m_intValues;
+		std::vector<uint64_t> m_uintValues;
+		std::vector<double> m_doubleValues;
+	};
+	class Map : public FlatMap<String, RpcValue>
 	{
-		using Super = std::map<String, RpcValue>;
+		using Super = FlatMap<String, RpcValue>;
 		using Super::Super; // expose base class constructors
 	public:
 		RpcValue value(const String &key, const RpcValue &default_val = RpcValue()) const
@@ -197,9 +254,9 @@ public:
 			return ret;
 		}
 	};
-	class IMap : public std::map<Int, RpcValue>
+	class IMap : public FlatMap<Int, RpcValue>
 	{
-		using Super = std::map<Int, RpcValue>;
+		using Super = FlatMap<Int, RpcValue>;
 		using Super::Super; // expose base class constructors
 	public:
 		RpcValue value(Int key, const RpcValue &default_val = RpcValue()) const
@@ -223,8 +280,14 @@ public:
 		}
 	};
 
+	/// Int keys of meta type and RpcMessage header tags (RequestId .. TunnelCtl) are stored
+	/// in fixed slots with O(1) access, other keys in fallback maps.
 	class SHVCHAINPACK_DECL_EXPORT MetaData
 	{
+	public:
+		static constexpr Int SLOT_KEY_MIN = meta::Tag::MetaTypeId;
+		static constexpr Int SLOT_KEY_MAX = meta::Tag::USER + 7; // RpcMessage::MetaType::Tag::TunnelCtl
+		static constexpr Int SLOT_COUNT = SLOT_KEY_MAX - SLOT_KEY_MIN + 1;
 	public:
 		MetaData() {}
 		MetaData(MetaData &&o);
@@ -248,25 +311,32 @@ public:
 		RpcValue value(const RpcValue::String &key) const;
 		void setValue(RpcValue::Int key, const RpcValue &val);
 		void setValue(const RpcValue::String &key, const RpcValue &val);
+		/// reference to value, invalid value if key is not set
+		const RpcValue& valueRef(RpcValue::Int key) const;
 		bool isEmpty() const;
 		bool operator==(const MetaData &o) const;
-		const RpcValue::IMap& iValues() const;
+		/// int keys with values in ascending order, forEachIValue() does not build the map
+		RpcValue::IMap iValues() const;
 		const RpcValue::Map& sValues() const;
+		template<typename F>
+		void forEachIValue(F fn) const;
 		std::string toPrettyString() const;
 	private:
 		MetaData& operator =(const MetaData &o);
 		void swap(MetaData &o);
+		static bool isSlotKey(RpcValue::Int key) {return key >= SLOT_KEY_MIN && key <= SLOT_KEY_MAX;}
 	private:
+		RpcValue *m_slots = nullptr;
+		uint32_t m_slotMask = 0;
 		RpcValue::IMap *m_imap = nullptr;
 		RpcValue::Map *m_smap = nullptr;
 	};
 
 	// Constructors for the various types of JSON value.
 	RpcValue() noexcept;                // Invalid
-#ifdef RPCVALUE_COPY_AND_SWAP
-	RpcValue(const RpcValue &other) noexcept : m_ptr(other.m_ptr) {}
-	RpcValue(RpcValue &&other) noexcept : RpcValue() { swap(other); }
-#endif
+	RpcValue(const RpcValue &other) noexcept;
+	RpcValue(RpcValue &&other) noexcept;
+	~RpcValue();
 	RpcValue(std::nullptr_t) noexcept;  // Null
 	RpcValue(bool value);               // Bool
 
@@ -277,20 +347,24 @@ public:
 	RpcValue(double value);             // Double
 	RpcValue(Decimal value);             // Decimal
 	RpcValue(const DateTime &value);
-	//RpcValue(const Blob &value); // Blob
-	//RpcValue(Blob &&value);
-	RpcValue(const uint8_t *value, size_t size);
+	RpcValue(const Blob &value);        // Blob
+	RpcValue(Blob &&value);             // Blob
+	RpcValue(const uint8_t *value, size_t size); // Blob
 	RpcValue(const std::string &value); // String
 	RpcValue(std::string &&value);      // String
 	RpcValue(const char *value);       // String
 	RpcValue(const List &values);      // List
 	RpcValue(List &&values);           // List
-	//RpcValue(const Array &values);
-	//RpcValue(Array &&values);
+	RpcValue(const Array &values);     // Array
+	RpcValue(Array &&values);          // Array
 	RpcValue(const Map &values);     // Map
 	RpcValue(Map &&values);          // Map
+	RpcValue(const PersistentMap &values); // Map with O(1) copy of heap data
 	RpcValue(const IMap &values);     // IMap
 	RpcValue(IMap &&values);          // IMap
+	/// String referencing bytes of shared buffer like received frame or file content,
+	/// std::string is created on first toString() call only, writers pack the bytes directly
+	static RpcValue fromStringData(Blob data);
 
 	// Implicit constructor: anything with a to_json() function.
 	template <class T, class = decltype(&T::to_json)>
@@ -336,9 +410,10 @@ public:
 	bool isDecimal() const { return type() == Type::Decimal; }
 	bool isDateTime() const { return type() == Type::DateTime; }
 	bool isList() const { return type() == Type::List; }
-	//bool isArray() const { return type() == Type::Array; }
+	bool isArray() const { return type() == Type::Array; }
 	bool isMap() const { return type() == Type::Map; }
 	bool isIMap() const { return type() == Type::IMap; }
+	bool isBlob() const { return type() == Type::Blob; }
 
 	double toDouble() const;
 	Decimal toDecimal() const;
@@ -349,11 +424,19 @@ public:
 	bool toBool() const;
 	DateTime toDateTime() const;
 	const RpcValue::String &toString() const;
-	//const Blob &toBlob() const;
+	const Blob &toBlob() const;
+	/// bytes of String created by fromStringData(), nullptr for other values
+	const Blob *stringData() const;
+	/// empty for Array, use toArray().toList() or count() and at() instead
 	const List &toList() const;
-	//const Array &toArray() const;
+	const Array &toArray() const;
+	/// PersistentMap is converted to Map on first call
 	const Map &toMap() const;
 	const IMap &toIMap() const;
+	/// O(1) snapshot if value was created from PersistentMap, Map is converted
+	PersistentMap toPersistentMap() const;
+	/// value was created from PersistentMap, toMap() would have to convert it
+	bool isPersistentMap() const;
 
 	size_t count() const;
 	bool has(Int i) const;
@@ -364,9 +447,19 @@ public:
 	RpcValue at(const RpcValue::String &key, const RpcValue &def_val) const  { return has(key)? at(key): def_val; }
 	RpcValue operator[](Int i) const {return at(i);}
 	RpcValue operator[](const RpcValue::String &key) const {return at(key);}
+	/// Mutators detach shared heap data first (copy-on-write),
+	/// copies of this value are never affected.
 	void set(Int ix, const RpcValue &val);
+	void set(Int ix, RpcValue &&val);
 	void set(const RpcValue::String &key, const RpcValue &val);
+	void set(const RpcValue::String &key, RpcValue &&val);
 	void append(const RpcValue &val);
+	void append(RpcValue &&val);
+	/// Moves container out without copying if this value is its only owner,
+	/// copies it otherwise. Value is invalid afterwards, meta data are dropped.
+	List takeList();
+	Map takeMap();
+	IMap takeIMap();
 
 	std::string toPrettyString(const std::string &indent = std::string()) const;
 	std::string toStdString() const;
@@ -376,16 +469,21 @@ public:
 	std::string toChainPack() const;
 	static RpcValue fromChainPack(const std::string & str, std::string *err = nullptr);
 
+	/// Calls fn once with the typed value: fn() for Invalid, fn(nullptr) for Null,
+	/// fn(uint64_t), fn(int64_t), fn(double), fn(bool), fn(const DateTime&), fn(const Decimal&)
+	/// for scalars, fn(const String&), fn(const Blob&), fn(const List&), fn(const Array&),
+	/// fn(const Map&) or fn(const IMap&) for heap values. Meta data are not visited.
+	template<typename F>
+	auto visit(F &&fn) const -> decltype(fn(nullptr));
+
+	/// Structural hash consistent with operator==, meta data are not hashed.
+	/// Hash of shared data is computed once and cached till the value is modified.
+	size_t hash() const;
+
 	bool operator== (const RpcValue &rhs) const;
 	bool operator!= (const RpcValue &rhs) const {return !operator==(rhs);}
-#ifdef RPCVALUE_COPY_AND_SWAP
-	RpcValue& operator= (RpcValue rhs) noexcept
-	{
-		swap(rhs);
-		return *this;
-	}
-	void swap(RpcValue& other) noexcept;
-#endif
+	RpcValue& operator= (const RpcValue &rhs) noexcept;
+	RpcValue& operator= (RpcValue &&rhs) noexcept;
 	/*
 	bool operator<  (const ChainPack &rhs) const;
 	bool operator!= (const ChainPack &rhs) const { return !(*this == rhs); }
@@ -393,10 +491,114 @@ public:
 	bool operator>  (const ChainPack &rhs) const { return  (rhs < *this); }
 	bool operator>= (const ChainPack &rhs) const { return !(*this < rhs); }
 	*/
+	/// Switches heap data of this value and of all values reachable from it
+	/// to atomic reference counting, values set into them later are frozen too.
+	/// When the library is built with SHVCHAINPACK_NONATOMIC_REFCOUNT, it must be called
+	/// before the value (or its copy) is passed to another thread, it is no-op otherwise.
+	void freezeForSharing() const;
+	/// Copies data of this value and of all values reachable from it allocated in RpcValueArena
+	/// to default heap, data on default heap stay shared. Decoded value kept long should be promoted,
+	/// otherwise it keeps all blocks of its arena allocated.
+	void promoteFromArena();
+private:
+	/// Intrusive reference to heap data
+	class DataPtr
+	{
+	public:
+		DataPtr() noexcept {}
+		/// adopts initial reference of newly created data
+		explicit DataPtr(AbstractValueData *d) noexcept : m_d(d) {}
+		DataPtr(const DataPtr &o) noexcept;
+		DataPtr(DataPtr &&o) noexcept : m_d(o.m_d) {o.m_d = nullptr;}
+		~DataPtr();
+		DataPtr& operator=(const DataPtr &o) noexcept;
+		DataPtr& operator=(DataPtr &&o) noexcept;
+
+		AbstractValueData* get() const {return m_d;}
+		AbstractValueData* operator->() const {return m_d;}
+		explicit operator bool() const {return m_d != nullptr;}
+		long use_count() const;
+	private:
+		AbstractValueData *m_d = nullptr;
+	};
+
+	explicit RpcValue(DataPtr &&data) noexcept;
+
+	bool isInline() const {return m_scalarType != Type::Invalid;}
+	AbstractValueData* heapData() const {return isInline()? nullptr: m_storage.ptr.get();}
+	/// type of heap data and pointer to its value, RpcValue with inline scalar for scalar types
+	Type heapValue(const void *&val) const;
+	void moveScalarToHeap();
+	void detach();
 private:
-	std::shared_ptr<AbstractValueData> m_ptr;
+	union Scalar
+	{
+		Scalar() : i(0) {}
+		bool b;
+		int64_t i;
+		uint64_t u;
+		double d;
+		Decimal decimal;
+		DateTime dateTime;
+	};
+	/// Scalars without meta data are stored inline, strings, containers
+	/// and values with meta data are shared on heap.
+	union Storage
+	{
+		Storage() {}
+		~Storage() {}
+		DataPtr ptr;
+		Scalar scalar;
+	};
+	Storage m_storage;
+	/// type of inline stored scalar, Invalid if m_storage.ptr is active
+	Type m_scalarType = Type::Invalid;
 };
 
+template<typename F>
+void RpcValue::MetaData::forEachIValue(F fn) const
+{
+	static const IMap empty_map;
+	const IMap &m = m_imap? *m_imap: empty_map;
+	auto it = m.begin();
+	for(; it != m.end() && it->first < SLOT_KEY_MIN; ++it)
+		fn(it->first, it->second);
+	for(Int key = SLOT_KEY_MIN; key <= SLOT_KEY_MAX; ++key) {
+		if(m_slotMask & (1u << (key - SLOT_KEY_MIN)))
+			fn(key, m_slots[key - SLOT_KEY_MIN]);
+	}
+	for(; it != m.end(); ++it)
+		fn(it->first, it->second);
+}
+
+template<typename F>
+auto RpcValue::visit(F &&fn) const -> decltype(fn(nullptr))
+{
+	const Scalar &v = m_storage.scalar;
+	switch (m_scalarType) {
+	case Type::Invalid: break;
+	case Type::Null: return fn(nullptr);
+	case Type::UInt: return fn(v.u);
+	case Type::Int: return fn(v.i);
+	case Type::Double: return fn(v.d);
+	case Type::Bool: return fn(v.b);
+	case Type::DateTime: return fn(v.dateTime);
+	case Type::Decimal: return fn(v.decimal);
+	default: break;
+	}
+	const void *val = nullptr;
+	switch (heapValue(val)) {
+	case Type::Invalid: return fn();
+	case Type::String: return fn(*static_cast<const String*>(val));
+	case Type::Blob: return fn(*static_cast<const Blob*>(val));
+	case Type::List: return fn(*static_cast<const List*>(val));
+	case Type::Array: return fn(*static_cast<const Array*>(val));
+	case Type::Map: return fn(*static_cast<const Map*>(val));
+	case Type::IMap: return fn(*static_cast<const IMap*>(val));
+	default: return static_cast<const RpcValue*>(val)->visit(std::forward<F>(fn));
+	}
+}
+
 template<typename T> RpcValue::Type guessType() { throw std::runtime_error("guessing of this type is not implemented"); }
 template<> inline RpcValue::Type RpcValue::guessType<RpcValue::Int>() { return Type::Int; }
 template<> inline RpcValue::Type RpcValue::guessType<RpcValue::UInt>() { return Type::UInt; }
@@ -412,16 +614,16 @@ public:
 
 	RpcValue value(size_t ix) const
 	{
-		if(m_val.isList())
-			return m_val.toList().value(ix);
+		if(m_val.isList() || m_val.isArray())
+			return m_val.at(static_cast<RpcValue::Int>(ix));
 		else if(ix == 0)
 			return m_val;
 		return RpcValue();
 	}
 	bool size() const
 	{
-		if(m_val.isList())
-			return m_val.toList().size();
+		if(m_val.isList() || m_val.isArray())
+			return m_val.count();
 		return m_val.isValid()? 1: 0;
 	}
 	bool empty() const {return size() == 0;}
@@ -429,6 +631,8 @@ public:
 	{
 		if(m_val.isList())
 			return m_val.toList();
+		if(m_val.isArray())
+			return m_val.toArray().toList();
 		return m_val.isValid()? RpcValue::List{m_val}: RpcValue::List{};
 	}
 private:
@@ -437,6 +641,14 @@ private:
 
 }}
 
+namespace std {
+template<>
+struct hash<shv::chainpack::RpcValue>
+{
+	size_t operator()(const shv::chainpack::RpcValue &v) const { return v.hash(); }
+};
+}
+
 template<typename T> inline T rpcvalue_cast(const shv::chainpack::RpcValue &v)
 {
 	//static_assert(false, "Cannot cast RpcValue type.");
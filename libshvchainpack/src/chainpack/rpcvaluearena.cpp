@@ -0,0 +1,115 @@
+#include "rpcvaluearena.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace shv {
+namespace chainpack {
+
+namespace {
+constexpr size_t MAX_BLOCK_SIZE = 1024 * 1024;
+thread_local const std::shared_ptr<RpcValueArena> *current_arena = nullptr;
+}
+
+RpcValueArena::Scope::Scope(const std::shared_ptr<RpcValueArena> &arena)
+	: m_arena(arena)
+{
+	if(m_arena) {
+		m_previous = current_arena;
+		current_arena = &m_arena;
+	}
+}
+
+RpcValueArena::Scope::~Scope()
+{
+	if(m_arena)
+		current_arena = m_previous;
+}
+
+RpcValueArena::Suspend::Suspend()
+	: m_previous(current_arena)
+{
+	current_arena = nullptr;
+}
+
+RpcValueArena::Suspend::~Suspend()
+{
+	current_arena = m_previous;
+}
+
+class RpcValueArena::Memory
+{
+public:
+	~Memory()
+	{
+		for(char *block : blocks)
+			delete[] block;
+	}
+	void ref() { refCount.fetch_add(1, std::memory_order_relaxed); }
+	void deref()
+	{
+		if(refCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			delete this;
+	}
+
+	std::vector<char*> blocks;
+private:
+	std::atomic<size_t> refCount{1};
+};
+
+RpcValueArena::RpcValueArena(size_t first_block_size)
+	: m_memory(new Memory())
+	, m_nextBlockSize(std::min(std::max<size_t>(first_block_size, 64), MAX_BLOCK_SIZE))
+{
+}
+
+RpcValueArena::~RpcValueArena()
+{
+	m_memory->deref();
+}
+
+size_t RpcValueArena::blockCount() const
+{
+	return m_memory->blocks.size();
+}
+
+const std::shared_ptr<RpcValueArena> *RpcValueArena::current()
+{
+	return current_arena;
+}
+
+void *RpcValueArena::allocate(size_t size, size_t alignment)
+{
+	size_t pad = m_current? (alignment - reinterpret_cast<uintptr_t>(m_current) % alignment) % alignment: 0;
+	if(!m_current || pad + size > m_free) {
+		size_t block_size = std::max(m_nextBlockSize, size + alignment);
+		m_current = new char[block_size];
+		m_memory->blocks.push_back(m_current);
+		m_free = block_size;
+		m_nextBlockSize = std::min(2 * m_nextBlockSize, MAX_BLOCK_SIZE);
+		pad = (alignment - reinterpret_cast<uintptr_t>(m_current) % alignment) % alignment;
+	}
+	char *ret = m_current + pad;
+	m_current += pad + size;
+	m_free -= pad + size;
+	m_allocatedSize += size;
+	return ret;
+}
+
+void *RpcValueArena::allocateValueData(size_t size, size_t alignment, Memory **memory)
+{
+	void *ret = allocate(size, alignment);
+	m_memory->ref();
+	*memory = m_memory;
+	return ret;
+}
+
+void RpcValueArena::releaseValueData(Memory *memory)
+{
+	memory->deref();
+}
+
+} // namespace chainpack
+} // namespace shv
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "../shvchainpackglobal.h"
+
+#include <memory>
+
+namespace shv {
+namespace chainpack {
+
+/// Monotonic memory for heap data of RpcValues decoded from one message.
+/// RpcValues created in a thread while the arena is active there (see Scope)
+/// allocate their shared value data from arena blocks (string buffers and container nodes
+/// still use the default allocator). Each value data keeps arena blocks referenced,
+/// blocks are released at once when the arena and all values allocated from it are gone.
+/// Value kept long can be promoted to default heap by RpcValue::promoteFromArena(),
+/// so it does not hold all blocks of the arena.
+/// Arena must be owned by shared_ptr and active in one thread at a time.
+class SHVCHAINPACK_DECL_EXPORT RpcValueArena
+{
+public:
+	/// Activates arena in current thread for scope lifetime, null arena is no-op.
+	class SHVCHAINPACK_DECL_EXPORT Scope
+	{
+	public:
+		explicit Scope(const std::shared_ptr<RpcValueArena> &arena);
+		~Scope();
+		Scope(const Scope &) = delete;
+		Scope& operator=(const Scope &) = delete;
+	private:
+		std::shared_ptr<RpcValueArena> m_arena;
+		const std::shared_ptr<RpcValueArena> *m_previous = nullptr;
+	};
+	/// Deactivates arena in current thread for scope lifetime,
+	/// for values which must outlive decoding arena.
+	class SHVCHAINPACK_DECL_EXPORT Suspend
+	{
+	public:
+		Suspend();
+		~Suspend();
+		Suspend(const Suspend &) = delete;
+		Suspend& operator=(const Suspend &) = delete;
+	private:
+		const std::shared_ptr<RpcValueArena> *m_previous;
+	};
+	/// arena blocks, referenced by the arena and by value data allocated from it
+	class Memory;
+public:
+	static constexpr size_t DEFAULT_BLOCK_SIZE = 4096;
+
+	explicit RpcValueArena(size_t first_block_size = DEFAULT_BLOCK_SIZE);
+	~RpcValueArena();
+	RpcValueArena(const RpcValueArena &) = delete;
+	RpcValueArena& operator=(const RpcValueArena &) = delete;
+
+	/// arena active in current thread or nullptr
+	static const std::shared_ptr<RpcValueArena>* current();
+
+	void* allocate(size_t size, size_t alignment);
+	/// allocates value data, arena memory is referenced until releaseValueData() is called
+	void* allocateValueData(size_t size, size_t alignment, Memory **memory);
+	/// releases memory reference of destructed value data
+	static void releaseValueData(Memory *memory);
+	size_t allocatedSize() const {return m_allocatedSize;}
+	size_t blockCount() const;
+private:
+	Memory *m_memory;
+	char *m_current = nullptr;
+	size_t m_free = 0;
+	size_t m_nextBlockSize;
+	size_t m_allocatedSize = 0;
+};
+
+} // namespace chainpack
+} // namespace shv
@@ -0,0 +1,181 @@
+#include "structcodec.h"
+#include "chainpackreader.h"
+#include "chainpackview.h"
+#include "exception.h"
+
+#include <limits>
+
+namespace shv {
+namespace chainpack {
+
+namespace {
+
+void check_unpack_error(const ccpcp_unpack_context *ctx)
+{
+	if(ctx->err_no != CCPCP_RC_OK)
+		SHVCHP_EXCEPTION(std::string("Malformed ChainPack data: ") + ccpcp_error_string(ctx->err_no));
+}
+
+void unpack_next(ccpcp_unpack_context *ctx)
+{
+	cchainpack_unpack_next(ctx);
+	check_unpack_error(ctx);
+}
+
+uint8_t peek_schema(ccpcp_unpack_context *ctx)
+{
+	const char *p = ccpcp_unpack_peek_byte(ctx);
+	if(!p)
+		SHVCHP_EXCEPTION("Unexpected end of ChainPack data");
+	return static_cast<uint8_t>(*p);
+}
+
+}
+
+void StructCodec::unpack(ccpcp_unpack_context *ctx, bool &val)
+{
+	unpack_next(ctx);
+	if(ctx->item.type != CCPCP_ITEM_BOOLEAN)
+		SHVCHP_EXCEPTION("Bool expected");
+	val = ctx->item.as.Bool;
+}
+
+void StructCodec::unpack(ccpcp_unpack_context *ctx, int &val)
+{
+	val = static_cast<int>(unpackInt64(ctx, std::numeric_limits<int>::min(), std::numeric_limits<int>::max()));
+}
+
+void StructCodec::unpack(ccpcp_unpack_context *ctx, int64_t &val)
+{
+	val = unpackInt64(ctx, std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max());
+}
+
+void StructCodec::unpack(ccpcp_unpack_context *ctx, unsigned &val)
+{
+	val = static_cast<unsigned>(unpackUInt64(ctx, std::numeric_limits<unsigned>::max()));
+}
+
+void StructCodec::unpack(ccpcp_unpack_context *ctx, uint64_t &val)
+{
+	val = unpackUInt64(ctx, std::numeric_limits<uint64_t>::max());
+}
+
+int64_t StructCodec::unpackInt64(ccpcp_unpack_context *ctx, int64_t min_val, int64_t max_val)
+{
+	unpack_next(ctx);
+	switch(ctx->item.type) {
+	case CCPCP_ITEM_INT:
+		if(ctx->item.as.Int < min_val || ctx->item.as.Int > max_val)
+			SHVCHP_EXCEPTION("Int out of range: " + std::to_string(ctx->item.as.Int));
+		return ctx->item.as.Int;
+	case CCPCP_ITEM_UINT:
+		if(ctx->item.as.UInt > static_cast<uint64_t>(max_val))
+			SHVCHP_EXCEPTION("Int out of range: " + std::to_string(ctx->item.as.UInt));
+		return static_cast<int64_t>(ctx->item.as.UInt);
+	default:
+		SHVCHP_EXCEPTION("Int expected");
+	}
+}
+
+uint64_t StructCodec::unpackUInt64(ccpcp_unpack_context *ctx, uint64_t max_val)
+{
+	unpack_next(ctx);
+	switch(ctx->item.type) {
+	case CCPCP_ITEM_INT:
+		if(ctx->item.as.Int < 0 || static_cast<uint64_t>(ctx->item.as.Int) > max_val)
+			SHVCHP_EXCEPTION("UInt out of range: " + std::to_string(ctx->item.as.Int));
+		return static_cast<uint64_t>(ctx->item.as.Int);
+	case CCPCP_ITEM_UINT:
+		if(ctx->item.as.UInt > max_val)
+			SHVCHP_EXCEPTION("UInt out of range: " + std::to_string(ctx->item.as.UInt));
+		return ctx->item.as.UInt;
+	default:
+		SHVCHP_EXCEPTION("UInt expected");
+	}
+}
+
+void StructCodec::unpack(ccpcp_unpack_context *ctx, double &val)
+{
+	unpack_next(ctx);
+	switch(ctx->item.type) {
+	case CCPCP_ITEM_DOUBLE:
+		val = ctx->item.as.Double;
+		break;
+	case CCPCP_ITEM_INT:
+		val = static_cast<double>(ctx->item.as.Int);
+		break;
+	case CCPCP_ITEM_UINT:
+		val = static_cast<double>(ctx->item.as.UInt);
+		break;
+	case CCPCP_ITEM_DECIMAL:
+		val = RpcValue::Decimal(ctx->item.as.Decimal.mantisa, ctx->item.as.Decimal.exponent).toDouble();
+		break;
+	default:
+		SHVCHP_EXCEPTION("Double expected");
+	}
+}
+
+void StructCodec::unpack(ccpcp_unpack_context *ctx, std::string &val)
+{
+	if(peek_schema(ctx) == CP_String) {
+		// string bytes are copied from the data at once
+		ctx->current++;
+		bool ok;
+		uint64_t size = cchainpack_unpack_uint_data(ctx, &ok);
+		if(!ok || size > static_cast<uint64_t>(ctx->end - ctx->current))
+			SHVCHP_EXCEPTION("Malformed ChainPack string");
+		val.assign(ctx->current, static_cast<size_t>(size));
+		ctx->current += size;
+		return;
+	}
+	unpack_next(ctx);
+	if(ctx->item.type != CCPCP_ITEM_STRING)
+		SHVCHP_EXCEPTION("String expected");
+	val.clear();
+	while(true) {
+		const ccpcp_string &it = ctx->item.as.String;
+		val.append(it.chunk_start, it.chunk_size);
+		if(it.last_chunk)
+			break;
+		unpack_next(ctx);
+	}
+}
+
+void StructCodec::unpack(ccpcp_unpack_context *ctx, RpcValue &val)
+{
+	ChainPackReader rd(ctx->current, static_cast<size_t>(ctx->end - ctx->current));
+	rd.read(val);
+	ctx->current += rd.readPosition();
+}
+
+void StructCodec::skipValue(ccpcp_unpack_context *ctx)
+{
+	ChainPackView v(ctx->current, static_cast<size_t>(ctx->end - ctx->current));
+	ctx->current += v.packedSize();
+}
+
+void StructCodec::unpackIMapBegin(ccpcp_unpack_context *ctx)
+{
+	if(peek_schema(ctx) == CP_MetaMap) {
+		ctx->current++;
+		while(!unpackContainerEnd(ctx)) {
+			skipValue(ctx);
+			skipValue(ctx);
+		}
+	}
+	if(peek_schema(ctx) != CP_IMap)
+		SHVCHP_EXCEPTION("IMap expected");
+	ctx->current++;
+}
+
+bool StructCodec::unpackContainerEnd(ccpcp_unpack_context *ctx)
+{
+	if(peek_schema(ctx) == CP_TERM) {
+		ctx->current++;
+		return true;
+	}
+	return false;
+}
+
+} // namespace chainpack
+} // namespace shv
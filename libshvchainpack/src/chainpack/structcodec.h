@@ -0,0 +1,135 @@
+#pragma once
+
+#include "rpcvalue.h"
+#include "chainpackwriter.h"
+#include "../../c/cchainpack.h"
+
+#include <string>
+
+namespace shv {
+namespace chainpack {
+
+/// Direct ChainPack coding of plain structs declared by SHV_CHAINPACK_STRUCT().
+/// Fields are packed and unpacked with cchainpack functions, no RpcValue tree is built,
+/// RpcValue fields only are coded by ChainPackWriter / ChainPackReader.
+class SHVCHAINPACK_DECL_EXPORT StructCodec
+{
+public:
+	static void pack(ChainPackWriter &wr, bool val) {cchainpack_pack_boolean(wr.packContext(), val);}
+	static void pack(ChainPackWriter &wr, int val) {cchainpack_pack_int(wr.packContext(), val);}
+	static void pack(ChainPackWriter &wr, int64_t val) {cchainpack_pack_int(wr.packContext(), val);}
+	static void pack(ChainPackWriter &wr, unsigned val) {cchainpack_pack_uint(wr.packContext(), val);}
+	static void pack(ChainPackWriter &wr, uint64_t val) {cchainpack_pack_uint(wr.packContext(), val);}
+	static void pack(ChainPackWriter &wr, double val) {cchainpack_pack_double(wr.packContext(), val);}
+	static void pack(ChainPackWriter &wr, const std::string &val) {cchainpack_pack_string(wr.packContext(), val.data(), val.size());}
+	static void pack(ChainPackWriter &wr, const RpcValue &val) {wr.write(val);}
+	/// meta data <MetaTypeId: meta_type_id> as written for RpcValue with this meta value
+	static void packMetaTypeId(ChainPackWriter &wr, RpcValue::Int meta_type_id)
+	{
+		cchainpack_pack_meta_begin(wr.packContext());
+		cchainpack_pack_int(wr.packContext(), meta::Tag::MetaTypeId);
+		cchainpack_pack_int(wr.packContext(), meta_type_id);
+		cchainpack_pack_container_end(wr.packContext());
+	}
+
+	template<typename T>
+	static void packField(ChainPackWriter &wr, RpcValue::Int key, const T &val)
+	{
+		cchainpack_pack_int(wr.packContext(), key);
+		pack(wr, val);
+	}
+	/// invalid value is not packed, like not set SHV_IMAP_FIELD_IMPL field
+	static void packField(ChainPackWriter &wr, RpcValue::Int key, const RpcValue &val)
+	{
+		if(val.isValid()) {
+			cchainpack_pack_int(wr.packContext(), key);
+			pack(wr, val);
+		}
+	}
+
+	static void unpack(ccpcp_unpack_context *ctx, bool &val);
+	/// integers out of the field type range throw exception
+	static void unpack(ccpcp_unpack_context *ctx, int &val);
+	static void unpack(ccpcp_unpack_context *ctx, int64_t &val);
+	static void unpack(ccpcp_unpack_context *ctx, unsigned &val);
+	static void unpack(ccpcp_unpack_context *ctx, uint64_t &val);
+	static void unpack(ccpcp_unpack_context *ctx, double &val);
+	static void unpack(ccpcp_unpack_context *ctx, std::string &val);
+	static void unpack(ccpcp_unpack_context *ctx, RpcValue &val);
+	static void skipValue(ccpcp_unpack_context *ctx);
+
+	/// unpacks IMap packed at the data beginning, meta data are skipped,
+	/// fn(ctx, key) is called for every key and it has to unpack or skip the value
+	/// @return number of bytes consumed
+	template<typename F>
+	static size_t unpackIMap(const char *data, size_t length, F fn)
+	{
+		ccpcp_unpack_context ctx;
+		ccpcp_unpack_context_init(&ctx, data, length, nullptr, nullptr);
+		unpackIMapBegin(&ctx);
+		while(!unpackContainerEnd(&ctx)) {
+			RpcValue::Int key;
+			unpack(&ctx, key);
+			fn(&ctx, key);
+		}
+		return static_cast<size_t>(ctx.current - ctx.start);
+	}
+private:
+	static int64_t unpackInt64(ccpcp_unpack_context *ctx, int64_t min_val, int64_t max_val);
+	static uint64_t unpackUInt64(ccpcp_unpack_context *ctx, uint64_t max_val);
+	static void unpackIMapBegin(ccpcp_unpack_context *ctx);
+	static bool unpackContainerEnd(ccpcp_unpack_context *ctx);
+};
+
+} // namespace chainpack
+} // namespace shv
+
+#define SHV_STRUCT_FIELD_DECL(ptype, int_key, name, default_value) \
+	ptype name = default_value;
+#define SHV_STRUCT_FIELD_PACK(ptype, int_key, name, default_value) \
+	shv::chainpack::StructCodec::packField(wr, static_cast<shv::chainpack::RpcValue::Int>(int_key), name);
+#define SHV_STRUCT_FIELD_UNPACK(ptype, int_key, name, default_value) \
+	case int_key: shv::chainpack::StructCodec::unpack(ctx, ret.name); break;
+
+/// Declares plain struct with fields listed by FIELDS(F) macro, F(ptype, int_key, name, default_value) for each field.
+/// The struct is packed as ChainPack IMap {int_key: value} like the RpcValue wrappers with SHV_IMAP_FIELD_IMPL,
+/// unknown keys and meta data are skipped when unpacking.
+#define SHV_CHAINPACK_STRUCT(struct_name, FIELDS) \
+	SHV_CHAINPACK_STRUCT_IMPL(struct_name, FIELDS, )
+/// The same as SHV_CHAINPACK_STRUCT, IMap is preceded by <MetaTypeId: meta_type_id> meta data.
+#define SHV_CHAINPACK_STRUCT_META(struct_name, meta_type_id, FIELDS) \
+	SHV_CHAINPACK_STRUCT_IMPL(struct_name, FIELDS, shv::chainpack::StructCodec::packMetaTypeId(wr, meta_type_id);)
+#define SHV_CHAINPACK_STRUCT_IMPL(struct_name, FIELDS, PACK_META) \
+	struct struct_name \
+	{ \
+		FIELDS(SHV_STRUCT_FIELD_DECL) \
+		void write(shv::chainpack::ChainPackWriter &wr) const \
+		{ \
+			PACK_META \
+			cchainpack_pack_imap_begin(wr.packContext()); \
+			FIELDS(SHV_STRUCT_FIELD_PACK) \
+			cchainpack_pack_container_end(wr.packContext()); \
+		} \
+		std::string toChainPack() const \
+		{ \
+			std::string ret; \
+			shv::chainpack::ChainPackWriter wr(ret); \
+			write(wr); \
+			wr.flush(); \
+			return ret; \
+		} \
+		static struct_name fromChainPack(const char *data, size_t length, size_t *consumed = nullptr) \
+		{ \
+			struct_name ret; \
+			size_t n = shv::chainpack::StructCodec::unpackIMap(data, length, [&ret](ccpcp_unpack_context *ctx, shv::chainpack::RpcValue::Int key) { \
+				switch(key) { \
+				FIELDS(SHV_STRUCT_FIELD_UNPACK) \
+				default: shv::chainpack::StructCodec::skipValue(ctx); break; \
+				} \
+			}); \
+			if(consumed) \
+				*consumed = n; \
+			return ret; \
+		} \
+		static struct_name fromChainPack(const std::string &data) {return fromChainPack(data.data(), data.size());} \
+	};
@@ -0,0 +1,108 @@
+#include "transcoder.h"
+#include "exception.h"
+
+#include "../../c/ccpcp_convert.h"
+
+#include <vector>
+
+namespace shv {
+namespace chainpack {
+
+namespace {
+
+struct ContainerStack : public ccpcp_container_stack
+{
+	std::vector<ccpcp_container_state> states;
+
+	ContainerStack()
+		: states(16)
+	{
+		ccpcp_container_stack_init(this, states.data(), states.size(), grow);
+	}
+
+	static int grow(ccpcp_container_stack *stack)
+	{
+		ContainerStack *self = static_cast<ContainerStack*>(stack);
+		self->states.resize(2 * self->states.size());
+		self->container_states = self->states.data();
+		self->capacity = self->states.size();
+		return 0;
+	}
+};
+
+void append_overflow_handler(ccpcp_pack_context *ctx, size_t size_hint)
+{
+	std::string &out = *reinterpret_cast<std::string*>(ctx->custom_context);
+	size_t len = ctx->current - ctx->start;
+	if(size_hint == 0) {
+		// flush, cut off unused space
+		out.resize(len);
+	}
+	else {
+		size_t new_size = 2 * out.size();
+		if(new_size < len + size_hint)
+			new_size = len + size_hint;
+		if(new_size < 256)
+			new_size = 256;
+		out.resize(new_size);
+	}
+	ctx->start = &out[0];
+	ctx->current = ctx->start + len;
+	ctx->end = ctx->start + out.size();
+}
+
+ccpcp_pack_format pack_format(Rpc::ProtocolType protocol)
+{
+	switch (protocol) {
+	case Rpc::ProtocolType::ChainPack:
+		return CCPCP_ChainPack;
+	case Rpc::ProtocolType::Cpon:
+	case Rpc::ProtocolType::JsonRpc:
+		return CCPCP_Cpon;
+	default:
+		SHVCHP_EXCEPTION(std::string("Cannot transcode protocol: ") + Rpc::protocolTypeToString(protocol));
+	}
+}
+
+}
+
+size_t Transcoder::transcode(Rpc::ProtocolType in_protocol, const char *data, size_t length, Rpc::ProtocolType out_protocol, std::string &out_data)
+{
+	const ccpcp_pack_format in_format = pack_format(in_protocol);
+	const ccpcp_pack_format out_format = pack_format(out_protocol);
+
+	ContainerStack stack;
+	ccpcp_unpack_context in_ctx;
+	ccpcp_unpack_context_init(&in_ctx, data, length, nullptr, &stack);
+	std::vector<char> string_buff;
+	if(in_format == CCPCP_Cpon && length > sizeof(in_ctx.default_string_chunk_buff)) {
+		// unescaped string is never longer than its source, every string is unpacked in one chunk
+		// then and it can be packed to ChainPack with known length
+		string_buff.resize(length);
+		in_ctx.string_chunk_buff = string_buff.data();
+		in_ctx.string_chunk_buff_len = string_buff.size();
+	}
+
+	ccpcp_pack_context out_ctx;
+	ccpcp_pack_context_init(&out_ctx, &out_data[0], out_data.size(), append_overflow_handler);
+	out_ctx.current = out_ctx.end;
+	out_ctx.custom_context = &out_data;
+	out_ctx.cpon_options.json_output = (out_protocol == Rpc::ProtocolType::JsonRpc);
+
+	ccpcp_convert(&in_ctx, in_format, &out_ctx, out_format);
+	if(in_ctx.err_no != CCPCP_RC_OK)
+		SHVCHP_EXCEPTION(std::string("Transcode input error: ") + ccpcp_error_string(in_ctx.err_no) + " at pos: " + std::to_string(in_ctx.current - in_ctx.start));
+	if(out_ctx.err_no != CCPCP_RC_OK)
+		SHVCHP_EXCEPTION(std::string("Transcode output error: ") + ccpcp_error_string(out_ctx.err_no));
+	return static_cast<size_t>(in_ctx.current - in_ctx.start);
+}
+
+std::string Transcoder::transcode(Rpc::ProtocolType in_protocol, const std::string &data, Rpc::ProtocolType out_protocol)
+{
+	std::string ret;
+	transcode(in_protocol, data.data(), data.size(), out_protocol, ret);
+	return ret;
+}
+
+} // namespace chainpack
+} // namespace shv
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "rpc.h"
+
+#include <string>
+
+namespace shv {
+namespace chainpack {
+
+/// Streaming conversion of packed data between ChainPack and Cpon without building RpcValue.
+/// JsonRpc data is read as Cpon and written as Cpon in JSON format, JSON-RPC envelope is not handled here,
+/// see RpcDriver::transcodeData().
+/// Typed arrays are not supported by the C unpacker, exception is thrown for them.
+class SHVCHAINPACK_DECL_EXPORT Transcoder
+{
+public:
+	/// transcodes one value packed at the data beginning and appends it to out_data
+	/// @return number of input bytes consumed
+	static size_t transcode(Rpc::ProtocolType in_protocol, const char *data, size_t length, Rpc::ProtocolType out_protocol, std::string &out_data);
+	static std::string transcode(Rpc::ProtocolType in_protocol, const std::string &data, Rpc::ProtocolType out_protocol);
+};
+
+} // namespace chainpack
+} // namespace shv
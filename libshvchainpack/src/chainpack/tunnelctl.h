@@ -4,6 +4,7 @@
 
 #include "rpcvalue.h"
 #include "utils.h"
+#include "structcodec.h"
 
 namespace shv {
 namespace chainpack {
@@ -67,6 +68,15 @@ class SHVCHAINPACK_DECL_EXPORT FindTunnelReqCtl : public TunnelCtl
 public:
 	FindTunnelReqCtl() : Super(State::FindTunnelRequest) {}
 	FindTunnelReqCtl(const TunnelCtl &o) : Super(o) {}
+
+#define SHV_FIND_TUNNEL_REQ_FIELDS(F) \
+	F(int, MetaType::Key::State, state, State::FindTunnelRequest) \
+	F(std::string, MetaType::Key::Host, host, std::string()) \
+	F(int, MetaType::Key::Port, port, 0) \
+	F(std::string, MetaType::Key::Secret, secret, std::string()) \
+	F(shv::chainpack::RpcValue, MetaType::Key::CallerIds, callerIds, shv::chainpack::RpcValue())
+	/// the same fields as plain struct with direct ChainPack coding
+	SHV_CHAINPACK_STRUCT_META(Data, MetaType::ID, SHV_FIND_TUNNEL_REQ_FIELDS)
 };
 
 class SHVCHAINPACK_DECL_EXPORT FindTunnelRespCtl : public TunnelCtl
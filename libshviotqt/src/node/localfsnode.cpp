@@ -20,6 +20,22 @@ static const char M_MKFILE[] = "mkfile";
 static const char M_MKDIR[] = "mkdir";
 static const char M_RMDIR[] = "rmdir";
 
+static void write_file_content(QFile &f, const cp::RpcValue &content)
+{
+	if(content.isBlob()) {
+		const cp::RpcValue::Blob &blob = content.toBlob();
+		f.write(blob.data(), static_cast<qint64>(blob.size()));
+	}
+	else if(const cp::RpcValue::Blob *data = content.stringData()) {
+		// long string received in frame, written without copying
+		f.write(data->data(), static_cast<qint64>(data->size()));
+	}
+	else {
+		const cp::RpcValue::String &str = content.toString();
+		f.write(str.data(), static_cast<qint64>(str.size()));
+	}
+}
+
 LocalFSNode::LocalFSNode(const QString &root_path, Super *parent)
 	: Super(parent)
 	, m_rootDir(root_path)
@@ -158,8 +174,9 @@ chainpack::RpcValue LocalFSNode::ndRead(const QString &path)
 {
 	QFile f(m_rootDir.absolutePath() + '/' + path);
 	if(f.open(QFile::ReadOnly)) {
-		QByteArray ba = f.readAll();
-		return cp::RpcValue::String(ba.constData(), (size_t)ba.size());
+		// String, Blob is not supported by older peers, file content is packed without copying
+		auto ba = std::make_shared<const QByteArray>(f.readAll());
+		return cp::RpcValue::fromStringData(cp::RpcValue::Blob(ba, ba->constData(), (size_t)ba->size()));
 	}
 	SHV_EXCEPTION("Cannot open file " + f.fileName().toStdString() + " for reading.");
 }
@@ -168,10 +185,9 @@ chainpack::RpcValue LocalFSNode::ndWrite(const QString &path, const chainpack::R
 {
 	QFile f(m_rootDir.absolutePath() + '/' + path);
 
-	if (methods_params.isString()){
+	if (methods_params.isString() || methods_params.isBlob()){
 		if(f.open(QFile::WriteOnly)) {
-			const chainpack::RpcValue::String &content = methods_params.toString();
-			f.write(content.data(), content.size());
+			write_file_content(f, methods_params);
 			return true;
 		}
 		SHV_EXCEPTION("Cannot open file " + f.fileName().toStdString() + " for writing.");
@@ -186,8 +202,7 @@ chainpack::RpcValue LocalFSNode::ndWrite(const QString &path, const chainpack::R
 		QFile::OpenMode open_mode = (flags.value("append").toBool()) ? QFile::Append : QFile::WriteOnly;
 
 		if(f.open(open_mode)) {
-			const chainpack::RpcValue::String &content = params[0].toString();
-			f.write(content.data(), content.size());
+			write_file_content(f, params[0]);
 			return true;
 		}
 		SHV_EXCEPTION("Cannot open file " + f.fileName().toStdString() + " for writing.");
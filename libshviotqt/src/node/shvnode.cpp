@@ -7,6 +7,7 @@
 #include <shv/chainpack/metamethod.h>
 #include <shv/chainpack/rpcmessage.h>
 #include <shv/chainpack/rpcvalue.h>
+#include <shv/chainpack/persistentmap.h>
 #include <shv/chainpack/rpcdriver.h>
 #include <shv/core/stringview.h>
 #include <shv/core/exception.h>
@@ -16,6 +17,7 @@
 #include <QTimer>
 
 #include <cstring>
+#include <vector>
 
 namespace cp = shv::chainpack;
 
@@ -521,6 +523,34 @@ static std::vector<cp::MetaMethod> meta_methods_value_map_node {
 //===========================================================
 // RpcValueMapNode
 //===========================================================
+namespace {
+// set on PersistentMap copies O(log n) nodes instead of the whole map level
+constexpr size_t PERSISTENT_MAP_MIN_SIZE = 32;
+
+cp::RpcValue to_persistent_tree(const cp::RpcValue &val)
+{
+	if(!val.isMap())
+		return val;
+	const cp::RpcValue::Map &map = val.toMap();
+	cp::RpcValue ret;
+	if(map.size() >= PERSISTENT_MAP_MIN_SIZE) {
+		cp::PersistentMap pm;
+		for(const auto &kv : map)
+			pm.setValue(kv.first, to_persistent_tree(kv.second));
+		ret = cp::RpcValue(pm);
+	}
+	else {
+		cp::RpcValue::Map m;
+		for(const auto &kv : map)
+			m[kv.first] = to_persistent_tree(kv.second);
+		ret = cp::RpcValue(std::move(m));
+	}
+	if(!val.metaData().isEmpty())
+		ret.setMetaData(cp::RpcValue::MetaData(val.metaData()));
+	return ret;
+}
+}
+
 RpcValueMapNode::RpcValueMapNode(const std::string &node_id, ShvNode *parent)
 	: Super(node_id, parent)
 {
@@ -529,7 +559,7 @@ RpcValueMapNode::RpcValueMapNode(const std::string &node_id, ShvNode *parent)
 RpcValueMapNode::RpcValueMapNode(const std::string &node_id, const chainpack::RpcValue &values, ShvNode *parent)
 	: Super(node_id, parent)
 	, m_valuesLoaded(true)
-	, m_values(values)
+	, m_values(to_persistent_tree(values))
 {
 }
 
@@ -561,6 +591,9 @@ const shv::chainpack::MetaMethod *RpcValueMapNode::metaMethod(const shv::iotqt::
 shv::iotqt::node::ShvNode::StringList RpcValueMapNode::childNames(const shv::iotqt::node::ShvNode::StringViewList &shv_path)
 {
 	shv::chainpack::RpcValue val = valueOnPath(shv_path);
+	// snapshot keys, do not materialize Map copy of the level
+	if(val.isPersistentMap())
+		return val.toPersistentMap().keys();
 	ShvNode::StringList lst;
 	for(const auto &kv : val.toMap()) {
 		lst.push_back(kv.first);
@@ -582,11 +615,11 @@ chainpack::RpcValue RpcValueMapNode::callMethod(const ShvNode::StringViewList &s
 		}
 		if(method == M_SAVE) {
 			m_valuesLoaded = true;
-			m_values = params;
-			return saveValues(m_values);
+			setValues(params);
+			return saveValues(valuesSnapshot());
 		}
 		if(method == M_COMMIT) {
-			return saveValues(m_values);
+			return saveValues(valuesSnapshot());
 		}
 	}
 	if(method == cp::Rpc::METH_GET) {
@@ -615,17 +648,31 @@ const shv::chainpack::RpcValue &RpcValueMapNode::values()
 {
 	if(!m_valuesLoaded) {
 		m_valuesLoaded = true;
-		m_values = loadValues();
+		setValues(loadValues());
 	}
 	return m_values;
 }
 
+shv::chainpack::RpcValue RpcValueMapNode::valuesSnapshot() const
+{
+	std::lock_guard<std::mutex> lock(m_valuesMutex);
+	return m_values;
+}
+
+void RpcValueMapNode::setValues(const shv::chainpack::RpcValue &vals)
+{
+	shv::chainpack::RpcValue new_values = to_persistent_tree(vals);
+	// values set later are frozen by their parents
+	new_values.freezeForSharing();
+	std::lock_guard<std::mutex> lock(m_valuesMutex);
+	m_values = std::move(new_values);
+}
+
 shv::chainpack::RpcValue RpcValueMapNode::valueOnPath(const shv::iotqt::node::ShvNode::StringViewList &shv_path)
 {
 	shv::chainpack::RpcValue v = values();
 	for(const auto & dir : shv_path) {
-		const shv::chainpack::RpcValue::Map &m = v.toMap();
-		v = m.value(dir.toString());
+		v = v.at(dir.toString());
 		if(!v.isValid())
 			SHV_EXCEPTION("Invalid path: " + shv_path.join('/'));
 	}
@@ -636,15 +683,21 @@ void RpcValueMapNode::setValueOnPath(const shv::iotqt::node::ShvNode::StringView
 {
 	if(shv_path.empty())
 		SHV_EXCEPTION("Invalid path: " + shv_path.join('/'));
-	shv::chainpack::RpcValue v = values();
+	values();
+	// values are copy-on-write, modified maps have to be set back to their parents,
+	// maps off the path stay shared with snapshots
+	std::vector<shv::chainpack::RpcValue> maps{m_values};
 	for (size_t i = 0; i < shv_path.size()-1; ++i) {
-		auto dir = shv_path.at(i);
-		const shv::chainpack::RpcValue::Map &m = v.toMap();
-		v = m.value(dir.toString());
+		shv::chainpack::RpcValue v = maps.back().at(shv_path.at(i).toString());
 		if(!v.isValid())
 			SHV_EXCEPTION("Invalid path: " + shv_path.join('/'));
+		maps.push_back(v);
 	}
-	v.set(shv_path.at(shv_path.size() - 1).toString(), val);
+	maps.back().set(shv_path.at(shv_path.size() - 1).toString(), val);
+	for (size_t i = maps.size() - 1; i > 0; --i)
+		maps[i - 1].set(shv_path.at(i - 1).toString(), std::move(maps[i]));
+	std::lock_guard<std::mutex> lock(m_valuesMutex);
+	m_values = std::move(maps[0]);
 }
 
 bool RpcValueMapNode::isDir(const shv::iotqt::node::ShvNode::StringViewList &shv_path)
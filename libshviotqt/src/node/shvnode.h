@@ -10,6 +10,8 @@
 #include <QObject>
 #include <QMetaProperty>
 
+#include <mutex>
+
 //namespace shv { namespace chainpack { class MetaMethod; }}
 //namespace shv { namespace chainpack { class MetaMethod; class RpcValue; class RpcMessage; class RpcRequest; }}
 //namespace shv { namespace core { class StringView; }}
@@ -139,6 +141,8 @@ public:
 	shv::chainpack::RpcValue callMethod(const StringViewList &shv_path, const std::string &method, const shv::chainpack::RpcValue &params) override;
 
 	void clearValuesCache() {m_valuesLoaded = false;}
+	/// O(1) copy of current values, safe to read in other threads while set continues
+	shv::chainpack::RpcValue valuesSnapshot() const;
 protected:
 	virtual shv::chainpack::RpcValue loadValues();
 	virtual bool saveValues(const shv::chainpack::RpcValue &vals);
@@ -146,9 +150,12 @@ protected:
 	virtual shv::chainpack::RpcValue valueOnPath(const StringViewList &shv_path);
 	void setValueOnPath(const StringViewList &shv_path, const shv::chainpack::RpcValue &val);
 	bool isDir(const StringViewList &shv_path);
+	void setValues(const shv::chainpack::RpcValue &vals);
 protected:
 	bool m_valuesLoaded = false;
+	/// modified in node thread only, guarded for valuesSnapshot()
 	shv::chainpack::RpcValue m_values;
+	mutable std::mutex m_valuesMutex;
 };
 
 /// Deprecated
@@ -19,10 +19,12 @@ QVariant Utils::rpcValueToQVariant(const chainpack::RpcValue &v)
 	case chainpack::RpcValue::Type::Bool: return QVariant(v.toBool());
 	case chainpack::RpcValue::Type::String: return QVariant(QString::fromStdString(v.toString()));
 	case chainpack::RpcValue::Type::DateTime: return QDateTime::fromMSecsSinceEpoch(v.toDateTime().msecsSinceEpoch());
-	case chainpack::RpcValue::Type::List: {
+	case chainpack::RpcValue::Type::List:
+	case chainpack::RpcValue::Type::Array: {
+		// Array::toList() would copy all elements
 		QVariantList lst;
-		for(const auto &rv : v.toList())
-			lst.insert(lst.size(), rpcValueToQVariant(rv));
+		for(size_t i = 0; i < v.count(); i++)
+			lst.insert(lst.size(), rpcValueToQVariant(v.at(static_cast<chainpack::RpcValue::Int>(i))));
 		return lst;
 	}
 	case chainpack::RpcValue::Type::Map: {
@@ -38,6 +40,7 @@ QVariant Utils::rpcValueToQVariant(const chainpack::RpcValue &v)
 		return map;
 	}
 	case chainpack::RpcValue::Type::Decimal: return QVariant(v.toDouble());
+	case chainpack::RpcValue::Type::Blob: return QByteArray(v.toBlob().data(), static_cast<int>(v.toBlob().size()));
 	}
 	return QString::fromStdString(v.toString());
 }
@@ -1,12 +1,15 @@
 #include "fileshvjournal.h"
 #include "shvpath.h"
 
+#include <shv/chainpack/atomtable.h>
 #include <shv/chainpack/cponreader.h>
+#include <shv/chainpack/rpcvaluearena.h>
 #include <shv/core/log.h>
 #include <shv/core/string.h>
 #include <shv/core/stringview.h>
 
 #include <fstream>
+#include <map>
 #include <sstream>
 
 #include <dirent.h>
@@ -368,6 +371,8 @@ chainpack::RpcValue FileShvJournal::getLog(const ShvJournalGetLogParams &params)
 			logWShvJournal() << "Cannot read date time string from: " + fn;
 		}
 	}
+	// log records are allocated together, they keep the arena till the log is released
+	cp::RpcValueArena::Scope arena_scope(std::make_shared<cp::RpcValueArena>());
 	cp::RpcValue::List log;
 	if(!params.since.isValid()) {
 		file_no = min_file_no;
@@ -376,17 +381,18 @@ chainpack::RpcValue FileShvJournal::getLog(const ShvJournalGetLogParams &params)
 	if(file_no < m_journalStatus.minFileNo)
 		file_no = m_journalStatus.minFileNo;
 
-	// this ensure that there be only one copy of each path in memory
-	cp::RpcValue::Map path_cache;
+	// this ensure that there be only one copy of each path in memory,
+	// paths are atoms or ids from paths dictionary
+	// path_cache can hold many paths inserted in random order, std::map fits better than flat RpcValue::Map
+	std::map<std::string, cp::RpcValue> path_cache;
 	unsigned max_path_id = 0;
 	auto make_path_shared = [&path_cache, &max_path_id, &params](const std::string &path) -> cp::RpcValue {
-		cp::RpcValue ret = path_cache.value(path);
-		if(ret.isValid())
-			return ret;
-		if(params.headerOptions & static_cast<unsigned>(ShvJournalGetLogParams::HeaderOptions::PathsDict))
-			ret = ++max_path_id;
-		else
-			ret = path;
+		if(!(params.headerOptions & static_cast<unsigned>(ShvJournalGetLogParams::HeaderOptions::PathsDict)))
+			return cp::AtomTable::atom(path);
+		auto it = path_cache.find(path);
+		if(it != path_cache.end())
+			return it->second;
+		cp::RpcValue ret = ++max_path_id;
 		path_cache[path] = ret;
 		return ret;
 	};
@@ -63,6 +63,7 @@ public:
 
 	void append(const ShvJournalEntry &entry, int64_t msec = 0);
 
+	/// log records are allocated in one RpcValueArena
 	shv::chainpack::RpcValue getLog(const ShvJournalGetLogParams &params);
 private:
 	void checkJournalConsistecy();
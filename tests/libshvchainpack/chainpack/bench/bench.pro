@@ -0,0 +1,10 @@
+include ( ../../test_libshvchainpack.pri )
+
+# benchmarks are run manually, not by make check
+CONFIG -= testcase
+
+TARGET = bench_chainpack
+
+SOURCES += \
+    $${TARGET}.cpp \
+
@@ -0,0 +1,176 @@
+#include <shv/chainpack/rpcvalue.h>
+#include <shv/chainpack/tunnelctl.h>
+
+#include <QtTest/QtTest>
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace shv::chainpack;
+
+namespace {
+
+/// list of records, each one has 6 key string map and 4 key IMap
+RpcValue records(int count)
+{
+	RpcValue::List ret;
+	for(int i = 0; i < count; i++) {
+		RpcValue::Map m{
+			{"id", i},
+			{"name", "record" + std::to_string(i)},
+			{"value", i * 0.5},
+			{"unit", "V"},
+			{"status", i % 3},
+			{"path", "shv/node/" + std::to_string(i % 100)},
+		};
+		RpcValue::IMap im{{1, i}, {2, "x"}, {3, true}, {4, RpcValue::List{i, i + 1}}};
+		ret.push_back(RpcValue::List{m, im});
+	}
+	return ret;
+}
+
+std::vector<std::string> shuffled_keys(size_t count)
+{
+	std::vector<std::string> ret;
+	for(size_t i = 0; i < count; i++)
+		ret.push_back("key" + std::to_string(i));
+	std::shuffle(ret.begin(), ret.end(), std::mt19937(1));
+	return ret;
+}
+
+/// long string with quote to escape every 500 chars
+std::string escaped_text(size_t len)
+{
+	std::string ret(len, 'x');
+	for(size_t i = 0; i < len; i++)
+		ret[i] = (i % 500 == 499)? '"': static_cast<char>('a' + i % 26);
+	return ret;
+}
+
+RpcValue long_strings()
+{
+	RpcValue::List ret;
+	for(int i = 0; i < 4; i++)
+		ret.push_back(escaped_text(1024 * 1024));
+	return ret;
+}
+
+constexpr size_t SHUFFLED_MAP_SIZE = 50000;
+constexpr int TUNNEL_CTL_COUNT = 10000;
+
+}
+
+class BenchChainPack : public QObject
+{
+	Q_OBJECT
+private slots:
+	void mapDecodeChainPack()
+	{
+		std::string packed = records(2000).toChainPack();
+		QBENCHMARK {
+			RpcValue::fromChainPack(packed);
+		}
+	}
+	void mapLookup()
+	{
+		RpcValue recs = records(2000);
+		int n = 0;
+		QBENCHMARK {
+			for(const RpcValue &rec : recs.toList()) {
+				const RpcValue::Map &m = rec.at(0).toMap();
+				n += m.value("status").toInt() + m.value("id").toInt() + (m.hasKey("foo")? 1: 0);
+				n += rec.at(1).toIMap().value(1).toInt();
+			}
+		}
+		QVERIFY(n != 0);
+	}
+	/// keys in random order, like in hand written configs or JSON
+	void mapShuffledCpon()
+	{
+		std::string cpon = "{";
+		for(const std::string &key : shuffled_keys(SHUFFLED_MAP_SIZE))
+			cpon += '"' + key + "\":1,";
+		cpon += '}';
+		QBENCHMARK {
+			RpcValue::fromCpon(cpon);
+		}
+	}
+	void mapShuffledBuild()
+	{
+		std::vector<std::string> keys = shuffled_keys(SHUFFLED_MAP_SIZE);
+		QBENCHMARK {
+			RpcValue::Map::container_type pairs;
+			for(const std::string &key : keys)
+				pairs.emplace_back(key, 1);
+			RpcValue::Map m(std::move(pairs));
+		}
+	}
+	/// reference, std::map was RpcValue::Map storage before FlatMap
+	void stdMapShuffledBuild()
+	{
+		std::vector<std::string> keys = shuffled_keys(SHUFFLED_MAP_SIZE);
+		QBENCHMARK {
+			std::map<std::string, RpcValue> m;
+			for(const std::string &key : keys)
+				m[key] = 1;
+		}
+	}
+	/// Cpon string escaping, clean runs between quotes are copied at once
+	void cponWriteLongString()
+	{
+		RpcValue strings = long_strings();
+		size_t n = 0;
+		QBENCHMARK {
+			n += strings.toCpon().size();
+		}
+		QVERIFY(n != 0);
+	}
+	void cponReadLongString()
+	{
+		RpcValue strings = long_strings();
+		std::string cpon = strings.toCpon();
+		RpcValue v;
+		QBENCHMARK {
+			v = RpcValue::fromCpon(cpon);
+		}
+		QVERIFY(v == strings);
+	}
+	/// pack + unpack through RpcValue IMap with SHV_IMAP_FIELD_IMPL accessors
+	void tunnelCtlWrapper()
+	{
+		size_t n = 0;
+		QBENCHMARK {
+			for(int i = 0; i < TUNNEL_CTL_COUNT; i++) {
+				FindTunnelReqCtl w;
+				w.setHost("localhost");
+				w.setPort(3755 + i);
+				w.setSecret("secret");
+				FindTunnelReqCtl r(TunnelCtl(RpcValue::fromChainPack(w.toChainPack())));
+				n += r.host().size() + static_cast<size_t>(r.port());
+			}
+		}
+		QVERIFY(n != 0);
+	}
+	/// the same wire format coded by SHV_CHAINPACK_STRUCT
+	void tunnelCtlStruct()
+	{
+		size_t n = 0;
+		QBENCHMARK {
+			for(int i = 0; i < TUNNEL_CTL_COUNT; i++) {
+				FindTunnelReqCtl::Data w;
+				w.host = "localhost";
+				w.port = 3755 + i;
+				w.secret = "secret";
+				FindTunnelReqCtl::Data r = FindTunnelReqCtl::Data::fromChainPack(w.toChainPack());
+				n += r.host.size() + static_cast<size_t>(r.port);
+			}
+		}
+		QVERIFY(n != 0);
+	}
+};
+
+QTEST_MAIN(BenchChainPack)
+#include "bench_chainpack.moc"
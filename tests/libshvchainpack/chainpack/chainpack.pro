@@ -5,4 +5,5 @@ SUBDIRS += \
 	rpcvalue \
 	rpcmessage \
 	tst_ccpcp \
+	bench \
 
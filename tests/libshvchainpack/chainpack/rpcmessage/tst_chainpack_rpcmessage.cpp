@@ -1,6 +1,8 @@
 #include <shv/chainpack/chainpackreader.h>
 #include <shv/chainpack/chainpackwriter.h>
 #include <shv/chainpack/rpcmessage.h>
+#include <shv/chainpack/rpcframereader.h>
+#include <shv/chainpack/rpcdriver.h>
 //#include <shv/chainpack/chainpackprotocol.h>
 
 #include <cassert>
@@ -56,6 +58,34 @@ std::string binary_dump(const RpcValue::String &out)
 	return ret;
 }
 
+std::string compose_frame(const RpcValue &msg)
+{
+	std::string data = msg.toChainPack();
+	std::string frame;
+	{
+		ChainPackWriter wr(frame);
+		wr.writeUIntData(data.size() + 1);
+		wr.writeUIntData((unsigned)Rpc::ProtocolType::ChainPack);
+	}
+	return frame + data;
+}
+
+/// reference for RpcDriver::transcodeData(), data are decoded to RpcValue and coded again
+std::string recode_data(Rpc::ProtocolType from, const std::string &data, Rpc::ProtocolType to, const RpcValue::MetaData &meta_data)
+{
+	RpcValue val = RpcDriver::decodeData(from, data, 0);
+	if(to == Rpc::ProtocolType::JsonRpc)
+		val.setMetaData(RpcValue::MetaData(meta_data));
+	return RpcDriver::codeRpcValue(to, val);
+}
+
+RpcValue read_frame(const RpcFrameReader &rd, const RpcFrameReader::Frame &frame)
+{
+	ChainPackReader in(rd.buffer().data() + frame.start, frame.length);
+	in.setBlobDataOwner(rd.sharedBuffer());
+	return in.read();
+}
+
 }
 
 class TestRpcMessage: public QObject
@@ -145,6 +175,130 @@ private:
 		QCOMPARE(rq2.params(), rq.params());
 	}
 }
+void rpcFrameReaderTest()
+{
+	qDebug() << "------------- RpcFrameReader";
+	RpcValue msg1 = RpcRequest().setMethod("foo").setParams(RpcValue::List{1, 2, 3}).setRequestId(1).value();
+	RpcValue msg2 = RpcValue(RpcValue::Blob(std::string(200, 'x')));
+	std::string frame1 = compose_frame(msg1);
+	std::string frame2 = compose_frame(msg2);
+	{
+		qDebug() << "header split across chunks";
+		RpcFrameReader rd;
+		RpcFrameReader::Frame frame;
+		// frame2 has two byte chunk length
+		std::string data = frame2;
+		rd.addData(data.substr(0, 1));
+		QVERIFY(!rd.nextFrame(frame));
+		QCOMPARE(rd.bytesNeeded(), (size_t)0);
+		rd.addData(data.substr(1, 2));
+		QVERIFY(!rd.nextFrame(frame));
+		QCOMPARE(rd.bytesNeeded(), data.size() - 3);
+		rd.addData(data.substr(3));
+		QVERIFY(rd.nextFrame(frame));
+		QVERIFY(frame.protocolType == Rpc::ProtocolType::ChainPack);
+		QVERIFY(read_frame(rd, frame) == msg2);
+		QVERIFY(!rd.nextFrame(frame));
+	}
+	{
+		qDebug() << "more frames in one chunk";
+		RpcFrameReader rd;
+		RpcFrameReader::Frame frame;
+		rd.addData(frame1 + frame2 + frame1 + frame2.substr(0, 5));
+		QVERIFY(rd.nextFrame(frame));
+		QVERIFY(read_frame(rd, frame) == msg1);
+		QVERIFY(rd.nextFrame(frame));
+		QVERIFY(read_frame(rd, frame) == msg2);
+		QVERIFY(rd.nextFrame(frame));
+		QVERIFY(read_frame(rd, frame) == msg1);
+		QVERIFY(!rd.nextFrame(frame));
+		QCOMPARE(rd.bytesNeeded(), frame2.size() - 5);
+		rd.addData(frame2.substr(5));
+		QVERIFY(rd.nextFrame(frame));
+		QVERIFY(read_frame(rd, frame) == msg2);
+		QVERIFY(!rd.nextFrame(frame));
+	}
+	{
+		qDebug() << "buffer held by blob";
+		RpcFrameReader rd;
+		RpcFrameReader::Frame frame;
+		rd.addData(frame2 + frame1.substr(0, 4));
+		QVERIFY(rd.nextFrame(frame));
+		RpcValue blob = read_frame(rd, frame);
+		const std::string *buffer = &rd.buffer();
+		QVERIFY(blob.toBlob().owner() == rd.sharedBuffer());
+		QVERIFY(!rd.nextFrame(frame));
+		// buffer referenced by blob is not modified, unprocessed rest is copied
+		rd.addData(frame1.substr(4));
+		QVERIFY(&rd.buffer() != buffer);
+		QCOMPARE(rd.buffer(), frame1);
+		QVERIFY(blob == msg2);
+		QVERIFY(rd.nextFrame(frame));
+		QVERIFY(read_frame(rd, frame) == msg1);
+	}
+	{
+		qDebug() << "corrupted chunk length";
+		RpcFrameReader rd;
+		RpcFrameReader::Frame frame;
+		std::string data;
+		{
+			ChainPackWriter wr(data);
+			wr.writeUIntData(~static_cast<uint64_t>(0) - 2);
+			wr.writeUIntData((unsigned)Rpc::ProtocolType::ChainPack);
+		}
+		rd.addData(data + frame1);
+		QVERIFY(rd.nextFrame(frame));
+		QVERIFY(frame.protocolType == Rpc::ProtocolType::Invalid);
+		// frame end must not wrap into the header
+		QCOMPARE(frame.start, data.size() - 1);
+		QCOMPARE(frame.length, (size_t)0);
+		QCOMPARE(rd.bytesNeeded(), (size_t)0);
+	}
+}
+void transcodeTest()
+{
+	qDebug() << "============= transcode test ============";
+	RpcValue::Map params{
+		{"a", RpcValue::fromCpon(R"(<8:"m">5)")},
+		{"b", 2},
+		{"c", RpcValue::fromCpon(R"(<1:2,"foo":<5:6>"bar">[1u,<7:8>{"x":<1:2>i{1:<3:4>"y"}},2.30])")},
+		{"d", RpcValue::fromCpon(R"(<1:2>{"k":<3:4>true})")},
+	};
+	RpcRequest rq;
+	rq.setRequestId(123);
+	rq.setMethod("foo");
+	rq.setShvPath("a/b");
+	rq.setParams(params);
+	RpcResponse resp;
+	resp.setRequestId(123);
+	resp.setResult(RpcValue::List{1, "hello", params});
+	RpcResponse resp_err;
+	resp_err.setRequestId(124);
+	resp_err.setError(RpcResponse::Error::create(RpcResponse::Error::MethodNotFound, "no such"));
+	const Rpc::ProtocolType protocols[] = {Rpc::ProtocolType::ChainPack, Rpc::ProtocolType::Cpon, Rpc::ProtocolType::JsonRpc};
+	for(const RpcValue &msg : {rq.value(), resp.value(), resp_err.value()}) {
+		RpcValue::MetaData meta_data = msg.metaData();
+		RpcValue data = msg;
+		data.setMetaData(RpcValue::MetaData());
+		std::string chainpack = RpcDriver::codeRpcValue(Rpc::ProtocolType::ChainPack, data);
+		for(Rpc::ProtocolType from : protocols) {
+			// JSON-RPC envelope carries meta data itself
+			std::string in = (from == Rpc::ProtocolType::JsonRpc)
+					? recode_data(Rpc::ProtocolType::ChainPack, chainpack, from, meta_data)
+					: RpcDriver::codeRpcValue(from, data);
+			for(Rpc::ProtocolType to : protocols) {
+				if(from == to)
+					continue;
+				std::string expected = recode_data(from, in, to, meta_data);
+				std::string transcoded = RpcDriver::transcodeData(from, in, to, meta_data);
+				qDebug() << Rpc::protocolTypeToString(from) << "->" << Rpc::protocolTypeToString(to) << transcoded;
+				QVERIFY(RpcDriver::decodeData(to, transcoded, 0) == RpcDriver::decodeData(to, expected, 0));
+				if(to != Rpc::ProtocolType::ChainPack)
+					QVERIFY(transcoded == expected);
+			}
+		}
+	}
+}
 private slots:
 	void initTestCase()
 	{
@@ -153,6 +307,8 @@ private slots:
 	void tests()
 	{
 		rpcmessageTest();
+		rpcFrameReaderTest();
+		transcodeTest();
 	}
 
 	void cleanupTestCase()
@@ -2,7 +2,13 @@
 #include <shv/chainpack/chainpack.h>
 #include <shv/chainpack/chainpackwriter.h>
 #include <shv/chainpack/chainpackreader.h>
+#include <shv/chainpack/chainpackview.h>
+#include <shv/chainpack/rpcvaluearena.h>
+#include <shv/chainpack/atomtable.h>
+#include <shv/chainpack/persistentmap.h>
 #include <shv/chainpack/cponreader.h>
+#include <shv/chainpack/transcoder.h>
+#include <shv/chainpack/tunnelctl.h>
 
 #include <QtTest/QtTest>
 #include <QDebug>
@@ -19,6 +25,8 @@
 #include <unordered_map>
 #include <algorithm>
 #include <type_traits>
+#include <limits>
+#include <thread>
 
 #ifdef __linux
 
@@ -1008,6 +1016,568 @@ private:
 			QVERIFY(cp1.type() == cp2.type());
 			QVERIFY(cp1.metaData() == cp2.metaData());
 		}
+		{
+			qDebug() << "------------- ChainPackView";
+			RpcValue cp1{RpcValue::Map{
+					{"foo", RpcValue::List{1, "bar", RpcValue::IMap{{1, 2.5}, {3, true}}}},
+					{"baz", "hello"},
+					{"num", -123},
+				}};
+			cp1.setMetaValue(meta::Tag::MetaTypeId, 11);
+			cp1.setMetaValue("bar", "meta");
+			std::string packed = cp1.toChainPack();
+			ChainPackView v(packed);
+			QVERIFY(v.type() == RpcValue::Type::Map);
+			QVERIFY(v.packedSize() == packed.size());
+			QCOMPARE(v.metaValue(meta::Tag::MetaTypeId).toInt(), 11);
+			QVERIFY(v.metaValue("bar").toStringView() == "meta");
+			QCOMPARE(v.count(), (size_t)3);
+			QCOMPARE(v.at("num").toInt(), -123);
+			QVERIFY(v.at("baz").toStringView() == "hello");
+			QVERIFY(v.at("foo").at(1).toString() == "bar");
+			QCOMPARE(v.at("foo").at(2).at(1).toDouble(), 2.5);
+			QVERIFY(v.at("foo").at(2).at(3).toBool());
+			QVERIFY(!v.at("foo").at(3).isValid());
+			QVERIFY(!v.at("nokey").isValid());
+			QVERIFY(v.at("foo").toRpcValue() == cp1.at("foo"));
+			QVERIFY(v.toRpcValue().metaData() == cp1.metaData());
+		}
+		{
+			qDebug() << "------------- packedSize";
+			RpcValue::DateTime dt = RpcValue::DateTime::fromUtcString("2018-02-02T10:20:30.123+0130");
+			RpcValue cp1{RpcValue::List{
+					nullptr, true, 0, 63, 64, -1, 1U << 20, -(1 << 30), int64_t(1) << 40, 1.5,
+					RpcValue::Decimal(-12345, -2), dt, RpcValue::DateTime::fromMSecsSinceEpoch(0),
+					std::string(300, 'x'), RpcValue::Map{{"a", 1}, {"bb", RpcValue::IMap{{1000, "c"}}}},
+				}};
+			cp1.setMetaValue(meta::Tag::MetaTypeId, 1);
+			cp1.setMetaValue("foo", "bar");
+			for(const RpcValue &v : cp1.toList())
+				QCOMPARE(ChainPack::packedSize(v), v.toChainPack().size());
+			QCOMPARE(ChainPack::packedSize(cp1), cp1.toChainPack().size());
+		}
+		{
+			qDebug() << "------------- typed Array";
+			std::vector<RpcValue> arrays{
+				RpcValue::Array(std::vector<int64_t>{0, -1, 63, 64, -(int64_t(1) << 40), INT64_MAX}),
+				RpcValue::Array(std::vector<uint64_t>{0, 127, 128, UINT64_MAX}),
+				RpcValue::Array(std::vector<double>{0, -1.5, 1024.25}),
+				RpcValue::Array(std::vector<double>{}),
+			};
+			for(RpcValue cp1 : arrays) {
+				cp1.setMetaValue(meta::Tag::MetaTypeId, 2);
+				std::string packed = cp1.toChainPack();
+				qDebug() << cp1.toCpon() << " len: " << packed.size() << " dump: " << binary_dump(packed);
+				QCOMPARE(ChainPack::packedSize(cp1), packed.size());
+				RpcValue cp2 = RpcValue::fromChainPack(packed);
+				QVERIFY(cp2.isArray());
+				QVERIFY(cp1 == cp2);
+				QVERIFY(cp2.metaData() == cp1.metaData());
+				std::istringstream in(packed);
+				ChainPackReader rd(in);
+				QVERIFY(rd.read() == cp1);
+				ChainPackView v(packed);
+				QVERIFY(v.isArray());
+				QCOMPARE(v.packedSize(), packed.size());
+				QCOMPARE(v.count(), cp1.count());
+				// Cpon has no typed array notation, element type is lost
+				RpcValue cp3 = RpcValue::fromCpon(cp1.toCpon());
+				QVERIFY(cp3.isList() && cp3 != cp1);
+				QVERIFY(cp3.toList() == cp1.toArray().toList());
+				QVERIFY(cp3.metaData() == cp1.metaData());
+				QVERIFY(cp1.toList().empty());
+			}
+			// types are appended to enum, values of older types are kept
+			QCOMPARE(static_cast<int>(RpcValue::Type::Map), 9);
+			QCOMPARE(static_cast<int>(RpcValue::Type::Blob), 12);
+			QCOMPARE(static_cast<int>(RpcValue::Type::Array), 13);
+			RpcValue cp1 = arrays[0];
+			QCOMPARE(cp1.at(-1).toInt64(), INT64_MAX);
+			QVERIFY(RpcValue(RpcValue::List{cp1, "x"}).toChainPack() == RpcValue::fromChainPack(RpcValue(RpcValue::List{cp1, "x"}).toChainPack()).toChainPack());
+		}
+		{
+			qDebug() << "------------- inline scalars";
+			RpcValue cp1 = RpcValue::Decimal(125, -2);
+			RpcValue cp2 = cp1;
+			cp2.setMetaValue(meta::Tag::MetaTypeId, 3);
+			QVERIFY(cp1.metaData().isEmpty());
+			QVERIFY(cp1 == cp2 && cp2.isDecimal());
+			QCOMPARE(cp2.metaValue(meta::Tag::MetaTypeId).toInt(), 3);
+			QVERIFY(RpcValue::fromChainPack(cp2.toChainPack()).metaData() == cp2.metaData());
+			RpcValue cp3 = RpcValue::List{1, RpcValue::List{true}};
+			cp3 = cp3.at(1);
+			QVERIFY(cp3.at(0).toBool());
+		}
+		{
+			qDebug() << "------------- RpcValueArena";
+			RpcValue cp1{RpcValue::Map{{"foo", RpcValue::List{"a", 1, RpcValue::IMap{{1, "b"}}}}, {"bar", "baz"}}};
+			cp1.setMetaValue("meta", RpcValue::List{"m"});
+			std::string packed = cp1.toChainPack();
+			RpcValue heap_val = RpcValue::List{"x"};
+			RpcValue foo;
+			RpcValue mixed;
+			RpcValue kept;
+			{
+				auto arena = std::make_shared<RpcValueArena>();
+				ChainPackReader rd(packed.data(), packed.size());
+				rd.setArena(arena);
+				RpcValue cp2;
+				rd >> cp2;
+				QVERIFY(arena->allocatedSize() > 0);
+				QVERIFY(cp1 == cp2);
+				// not promoted value keeps arena memory alive
+				kept = cp2;
+				// promoted values do not reference the arena
+				foo = cp2.at("foo");
+				foo.promoteFromArena();
+				mixed = RpcValue::List{heap_val, cp2};
+				mixed.promoteFromArena();
+				size_t allocated = arena->allocatedSize();
+				RpcValueArena::Scope arena_scope(arena);
+				heap_val.promoteFromArena();
+				QCOMPARE(arena->allocatedSize(), allocated);
+			}
+			QVERIFY(kept == cp1);
+			kept = RpcValue();
+			QVERIFY(foo == cp1.at("foo"));
+			QVERIFY(mixed.at(0) == heap_val && mixed.at(1) == cp1);
+			QVERIFY(mixed.at(1).metaData() == cp1.metaData());
+		}
+		{
+			qDebug() << "------------- copy on write";
+			RpcValue cp1{RpcValue::Map{{"foo", RpcValue::List{1, 2}}}};
+			RpcValue cp2 = cp1;
+			cp2.set("bar", 3);
+			cp2.setMetaValue(meta::Tag::MetaTypeId, 4);
+			QVERIFY(!cp1.has("bar") && cp1.metaData().isEmpty());
+			QCOMPARE(cp2.at("bar").toInt(), 3);
+			RpcValue list = cp1.at("foo");
+			list.append("x");
+			list.set(0, 0);
+			QCOMPARE(cp1.at("foo").count(), (size_t)2);
+			QVERIFY(list == RpcValue(RpcValue::List{0, 2, "x"}));
+			RpcValue::List l = list.takeList();
+			QCOMPARE(l.size(), (size_t)3);
+			QVERIFY(!list.isValid());
+			RpcValue::Map m = cp1.takeMap();
+			QVERIFY(m.at("foo").toList().size() == 2);
+			QVERIFY(cp2.takeMap().count("bar") == 1);
+		}
+		{
+			qDebug() << "------------- flat Map";
+			RpcValue::Map m{{"c", 3}, {"a", 1}, {"b", 2}, {"a", 4}};
+			QCOMPARE(m.size(), (size_t)3);
+			QVERIFY(m.keys() == (std::vector<std::string>{"a", "b", "c"}));
+			QCOMPARE(m.value("a").toInt(), 1);
+			m["0"] = 0;
+			QVERIFY(m.begin()->first == "0");
+			QCOMPARE(m.erase("b"), (size_t)1);
+			QVERIFY(!m.hasKey("b") && m.count("c") == 1);
+			RpcValue::IMap im{{3, "c"}, {1, "a"}};
+			QVERIFY(im.keys() == (std::vector<RpcValue::Int>{1, 3}));
+			QVERIFY(RpcValue::fromChainPack(RpcValue(m).toChainPack()).toMap() == m);
+			QVERIFY(RpcValue::fromCpon("i{3:3,1:1,2:2}").toIMap().keys() == (std::vector<RpcValue::Int>{1, 2, 3}));
+			// unsorted input is sorted once, the last of duplicate keys wins like with operator[]
+			RpcValue::Map m2 = RpcValue::fromCpon(R"({"b":1,"c":2,"a":3,"b":4})").toMap();
+			QVERIFY(m2.keys() == (std::vector<std::string>{"a", "b", "c"}));
+			QCOMPARE(m2.value("b").toInt(), 4);
+			QVERIFY(RpcValue::fromChainPack(RpcValue(m2).toChainPack()).toMap() == m2);
+			RpcValue::Map m3(RpcValue::Map::container_type{{"z", 1}, {"y", 2}, {"z", 3}});
+			QVERIFY(m3.keys() == (std::vector<std::string>{"y", "z"}) && m3.value("z").toInt() == 3);
+			// range insert keeps existing keys
+			m3.insert(m2.begin(), m2.end());
+			m3.insert(m.begin(), m.end());
+			QVERIFY(m3.keys() == (std::vector<std::string>{"0", "a", "b", "c", "y", "z"}));
+			QCOMPARE(m3.value("a").toInt(), 3);
+			std::vector<std::string> keys;
+			for(int i = 0; i < 1000; i++)
+				keys.push_back(std::to_string(i * 7919 % 1000));
+			RpcValue::Map::container_type pairs;
+			for(const std::string &key : keys)
+				pairs.emplace_back(key, RpcValue(key));
+			RpcValue::Map m4(std::move(pairs));
+			QCOMPARE(m4.size(), (size_t)1000);
+			QVERIFY(std::is_sorted(m4.begin(), m4.end(), [](const RpcValue::Map::value_type &a, const RpcValue::Map::value_type &b) { return a.first < b.first; }));
+			QVERIFY(m4.value("123").toString() == "123");
+		}
+		{
+			qDebug() << "------------- string atoms";
+			RpcValue a1 = AtomTable::atom("chng");
+			RpcValue a2 = AtomTable::atom(std::string("chng"));
+			QVERIFY(a1 == a2 && a1.toString().data() == a2.toString().data());
+			RpcValue cp1{RpcValue::List{RpcValue::Map{{"path", "a/b"}}, RpcValue::Map{{"path", "a/b"}}, "some long string value"}};
+			std::string packed = cp1.toChainPack();
+			ChainPackReader rd(packed.data(), packed.size());
+			rd.setInternMapKeys(true);
+			rd.setInternStringMaxLength(8);
+			RpcValue cp2 = rd.read();
+			QVERIFY(cp1 == cp2);
+			QVERIFY(cp2.at(0).at("path").toString().data() == cp2.at(1).at("path").toString().data());
+			QVERIFY(cp2.at(0).at("path").toString().data() == AtomTable::atom("a/b").toString().data());
+			std::string cpon = cp1.toCpon();
+			CponReader rd2(cpon.data(), cpon.size());
+			rd2.setInternStringMaxLength(8);
+			RpcValue cp3 = rd2.read();
+			QVERIFY(cp3.at(1).at("path").toString().data() == cp2.at(1).at("path").toString().data());
+			QVERIFY(cp3.at(2).toString().data() != cp2.at(2).toString().data());
+		}
+		{
+			qDebug() << "------------- meta data slots";
+			RpcValue::MetaData md;
+			md.setValue(20, "fallback");
+			md.setValue(meta::Tag::USER + 2, "method");
+			md.setValue(meta::Tag::MetaTypeId, 1);
+			md.setValue(-1, "negative");
+			md.setValue("foo", "bar");
+			QVERIFY(md.iKeys() == (std::vector<RpcValue::Int>{-1, meta::Tag::MetaTypeId, meta::Tag::USER + 2, 20}));
+			QVERIFY(md.valueRef(meta::Tag::USER + 2).toString() == "method");
+			QVERIFY(!md.hasKey(meta::Tag::USER));
+			RpcValue cp1 = 42;
+			cp1.setMetaData(RpcValue::MetaData(md));
+			QVERIFY(cp1.metaData() == md);
+			RpcValue cp2 = RpcValue::fromChainPack(cp1.toChainPack());
+			QVERIFY(cp2.metaData() == md);
+			QVERIFY(cp2.metaData().iValues() == md.iValues());
+			QVERIFY(RpcValue::fromCpon(cp1.toCpon()).metaData() == md);
+			md.setValue(meta::Tag::MetaTypeId, RpcValue());
+			QVERIFY(!md.hasKey(meta::Tag::MetaTypeId) && !(cp2.metaData() == md));
+		}
+		{
+			qDebug() << "------------- hash";
+			QCOMPARE(RpcValue(5).hash(), RpcValue(RpcValue::UInt(5)).hash());
+			QCOMPARE(RpcValue(1.25).hash(), RpcValue(RpcValue::Decimal(125, -2)).hash());
+			RpcValue cp1 = RpcValue::fromCpon(R"({"a":[1,2u,"x"],"b":i{1:<8:9>true}})");
+			RpcValue cp2 = RpcValue::fromChainPack(cp1.toChainPack());
+			QVERIFY(cp1 == cp2);
+			QCOMPARE(cp1.hash(), cp2.hash());
+			RpcValue cp3 = cp2;
+			cp3.set("c", 1);
+			QVERIFY(cp3.hash() != cp2.hash() && !(cp3 == cp2));
+			cp3.set("c", RpcValue());
+			QCOMPARE(cp3.hash(), cp2.hash());
+			std::unordered_map<RpcValue, int> cache{{cp1, 1}, {"foo", 2}};
+			QCOMPARE(cache.at(cp3), 1);
+			QCOMPARE(cache.at(RpcValue("foo")), 2);
+		}
+		{
+			qDebug() << "------------- persistent map";
+			PersistentMap pm;
+			for (int i = 0; i < 1000; ++i)
+				pm.setValue("key" + std::to_string(i), i);
+			RpcValue v1(pm);
+			RpcValue snapshot = v1;
+			v1.set("key5", "foo");
+			v1.set("key7", RpcValue());
+			QCOMPARE(v1.count(), (size_t)999);
+			QCOMPARE(snapshot.count(), (size_t)1000);
+			QVERIFY(v1.at("key5") == RpcValue("foo"));
+			QCOMPARE(snapshot.at("key5").toInt(), 5);
+			QVERIFY(!v1.has("key7") && snapshot.has("key7"));
+			QVERIFY(v1.isPersistentMap() && !RpcValue(RpcValue::Map()).isPersistentMap());
+			RpcValue v2 = snapshot;
+			v2.set("key5", "foo");
+			v2.set("key7", RpcValue());
+			QVERIFY(v1 == v2 && !(v1 == snapshot));
+			QCOMPARE(v1.hash(), v2.hash());
+			QVERIFY(v1.hash() != snapshot.hash());
+			RpcValue::Map m = snapshot.toMap();
+			QCOMPARE(m.size(), (size_t)1000);
+			QVERIFY(m.begin()->first == "key0");
+			QVERIFY(RpcValue(m) == snapshot && snapshot == RpcValue(m));
+			QCOMPARE(RpcValue(m).hash(), snapshot.hash());
+			QVERIFY(RpcValue::fromChainPack(snapshot.toChainPack()) == snapshot);
+			QCOMPARE(RpcValue(m).toPersistentMap().size(), (size_t)1000);
+		}
+		{
+			qDebug() << "------------- freeze for sharing";
+			RpcValue v1 = RpcValue::fromCpon(R"({"a":[1,"foo",{"b":<1:2>"bar"}],"c":i{1:"baz"}})");
+			v1.freezeForSharing();
+			// set to frozen value freezes the new child as well
+			v1.set("d", RpcValue::List{"x", "y"});
+			std::vector<RpcValue> copies(4);
+			std::vector<std::thread> threads;
+			for (size_t i = 0; i < copies.size(); ++i) {
+				threads.emplace_back([&v1, &copies, i]() {
+					for (int j = 0; j < 1000; ++j)
+						copies[i] = RpcValue(v1.at("a")).at(2).at("b");
+				});
+			}
+			for(auto &t : threads)
+				t.join();
+			for(const auto &c : copies)
+				QVERIFY(c == RpcValue("bar") && c.metaValue(1) == RpcValue(2));
+			QVERIFY(v1.at("d").at(1) == RpcValue("y"));
+		}
+		{
+			qDebug() << "------------- visit";
+			struct TypeName
+			{
+				std::string operator()() const { return "Invalid"; }
+				std::string operator()(std::nullptr_t) const { return "Null"; }
+				std::string operator()(uint64_t) const { return "UInt"; }
+				std::string operator()(int64_t) const { return "Int"; }
+				std::string operator()(double) const { return "Double"; }
+				std::string operator()(bool) const { return "Bool"; }
+				std::string operator()(const RpcValue::DateTime &) const { return "DateTime"; }
+				std::string operator()(const RpcValue::Decimal &) const { return "Decimal"; }
+				std::string operator()(const RpcValue::String &) const { return "String"; }
+				std::string operator()(const RpcValue::Blob &) const { return "Blob"; }
+				std::string operator()(const RpcValue::List &) const { return "List"; }
+				std::string operator()(const RpcValue::Array &) const { return "Array"; }
+				std::string operator()(const RpcValue::Map &) const { return "Map"; }
+				std::string operator()(const RpcValue::IMap &) const { return "IMap"; }
+			};
+			for(const std::string &cpon : {"null", "1u", "<1:2>-1", "1.5", "true", "d\"2018-01-01T00:00:00Z\"",
+				"1.25e-1", "\"foo\"", "[]", "{}", "<3:4>i{}"}) {
+				RpcValue v = RpcValue::fromCpon(cpon);
+				QVERIFY(v.visit(TypeName()) == RpcValue::typeToName(v.type()));
+			}
+			QVERIFY(RpcValue(RpcValue::Array{RpcValue::Type::Int}).visit(TypeName()) == "Array");
+			QVERIFY(RpcValue().visit(TypeName()) == "Invalid");
+			QVERIFY(RpcValue(RpcValue::Blob("x", 1)).visit(TypeName()) == "Blob");
+		}
+		{
+			qDebug() << "------------- blob";
+			std::string bytes("a\0b\"c", 5);
+			RpcValue v1 = RpcValue::Blob(bytes);
+			QVERIFY(v1.isBlob() && v1.toBlob().toString() == bytes);
+			QVERIFY(v1 != RpcValue(bytes));
+			RpcValue lst = RpcValue::List{v1, "str"};
+			std::string packed = lst.toChainPack();
+			QCOMPARE(ChainPack::packedSize(lst), packed.size());
+			auto buffer = std::make_shared<const std::string>(packed);
+			RpcValue v2;
+			{
+				ChainPackReader rd(buffer->data(), buffer->size());
+				rd.setBlobDataOwner(buffer);
+				v2 = rd.read();
+			}
+			QVERIFY(v2 == lst && v2.at(0).hash() == v1.hash());
+			// decoded blob references the input buffer
+			const RpcValue::Blob &blob = v2.at(0).toBlob();
+			QVERIFY(blob.owner() == buffer);
+			QVERIFY(blob.data() > buffer->data() && blob.data() < buffer->data() + buffer->size());
+			QVERIFY(blob.mid(2).toString() == bytes.substr(2));
+			std::istringstream in(packed);
+			ChainPackReader rd(in);
+			QVERIFY(rd.read() == lst);
+			QVERIFY(ChainPackView(packed.data(), packed.size()).at(0).toString() == bytes);
+			QVERIFY(RpcValue::fromCpon(v1.toCpon()) == RpcValue(bytes));
+		}
+		{
+			qDebug() << "------------- string data";
+			std::string text(2000, 'x');
+			text[10] = '"';
+			auto file = std::make_shared<const std::string>(text);
+			RpcValue v1 = RpcValue::fromStringData(RpcValue::Blob(file, file->data(), file->size()));
+			QVERIFY(v1.isString() && v1.stringData()->data() == file->data());
+			QVERIFY(RpcValue(text).stringData() == nullptr);
+			// packed as CP_String without copying
+			std::string packed = v1.toChainPack();
+			QVERIFY(packed == RpcValue(text).toChainPack());
+			QCOMPARE(ChainPack::packedSize(v1), packed.size());
+			QVERIFY(v1.toCpon() == RpcValue(text).toCpon());
+			RpcValue lst = RpcValue::List{v1, "short"};
+			packed = lst.toChainPack();
+			auto buffer = std::make_shared<const std::string>(packed);
+			RpcValue v2;
+			{
+				ChainPackReader rd(buffer->data(), buffer->size());
+				rd.setBlobDataOwner(buffer);
+				v2 = rd.read();
+			}
+			// long string references the input buffer, short one is copied
+			const RpcValue::Blob *data = v2.at(0).stringData();
+			QVERIFY(data && data->owner() == buffer);
+			QVERIFY(data->data() > buffer->data() && data->data() < buffer->data() + buffer->size());
+			QVERIFY(v2.at(1).stringData() == nullptr);
+			QVERIFY(v2 == lst && v2.at(0) == RpcValue(text) && RpcValue(text) == v2.at(0));
+			QVERIFY(v2.at(0) != RpcValue(std::string(2000, 'x')) && v2.at(0) != RpcValue::Blob(text));
+			QCOMPARE(v2.at(0).hash(), RpcValue(text).hash());
+			QVERIFY(v2.at(0).toString() == text);
+			QVERIFY(RpcValue::fromChainPack(packed).at(0).stringData() == nullptr);
+		}
+		{
+			qDebug() << "------------- transcode";
+			RpcValue deep = std::string(300, '"');
+			for(int i = 0; i < 40; i++)
+				deep = RpcValue::List{deep, i};
+			RpcValue val = RpcValue::Map{{"a", RpcValue::IMap{{1, -2}, {2, "x"}}}, {"b", deep}, {"c", RpcValue::Decimal(123, -2)}};
+			std::string cpon = Transcoder::transcode(Rpc::ProtocolType::ChainPack, val.toChainPack(), Rpc::ProtocolType::Cpon);
+			QVERIFY(cpon == val.toCpon());
+			std::string chainpack = Transcoder::transcode(Rpc::ProtocolType::Cpon, cpon, Rpc::ProtocolType::ChainPack);
+			QVERIFY(chainpack == val.toChainPack());
+			// value with meta data counts as single map item
+			for(const char *meta_cpon : {R"({"a":<8:"m">5,"b":2})", R"([<1:2>3,<4:<5:6>7>{"k":<8:9>i{1:<2:3>[<4:5>6]}},"x"])", R"(<1:2>i{1:<3:4>5,6:7})"}) {
+				RpcValue meta_val = RpcValue::fromCpon(meta_cpon);
+				QVERIFY(Transcoder::transcode(Rpc::ProtocolType::ChainPack, meta_val.toChainPack(), Rpc::ProtocolType::Cpon) == meta_val.toCpon());
+				QVERIFY(Transcoder::transcode(Rpc::ProtocolType::Cpon, meta_val.toCpon(), Rpc::ProtocolType::ChainPack) == meta_val.toChainPack());
+			}
+			std::string out("abc");
+			QCOMPARE(Transcoder::transcode(Rpc::ProtocolType::Cpon, "[1,2] [3]", 9, Rpc::ProtocolType::ChainPack, out), (size_t)5);
+			QVERIFY(RpcValue::fromChainPack(out.substr(3)) == RpcValue(RpcValue::List{1, 2}));
+		}
+		{
+			qDebug() << "------------- read events";
+			struct Handler : public AbstractStreamReader::EventHandler
+			{
+				std::string trace;
+				std::string str;
+				void onInt(int64_t n) override {trace += std::to_string(n) + ' ';}
+				void onString(const char *data, size_t size, bool last_chunk) override
+				{
+					str.append(data, size);
+					if(last_chunk) {
+						trace += 's' + std::to_string(str.size()) + ' ';
+						str.clear();
+					}
+				}
+				void onMetaBegin() override {trace += "< ";}
+				void onListBegin() override {trace += "[ ";}
+				void onMapBegin() override {trace += "{ ";}
+				void onIMapBegin() override {trace += "i{ ";}
+				void onMapKey(const std::string &key) override {trace += key + ": ";}
+				void onIMapKey(RpcValue::Int key) override {trace += std::to_string(key) + ": ";}
+				void onContainerEnd() override {trace += "} ";}
+			};
+			RpcValue::MetaData md;
+			md.setValue(1, 2);
+			md.setValue("k", 3);
+			RpcValue val = RpcValue::List{1, std::string(1000, 'x'), RpcValue::Map{{"a", RpcValue::IMap{{2, 3}}}}};
+			val.setMetaData(std::move(md));
+			const std::string expected = "< 1: 2 k: 3 } [ 1 s1000 { a: i{ 2: 3 } } } ";
+			std::string packed = val.toChainPack();
+			Handler h1;
+			ChainPackReader rd1(packed.data(), packed.size());
+			rd1.readEvents(h1);
+			QVERIFY(h1.trace == expected);
+			QCOMPARE((size_t)rd1.readPosition(), packed.size());
+			std::istringstream in(val.toCpon());
+			Handler h2;
+			CponReader rd2(in);
+			rd2.readEvents(h2);
+			QVERIFY(h2.trace == expected);
+		}
+		{
+			qDebug() << "------------- struct codec";
+			FindTunnelReqCtl::Data d1;
+			d1.host = "localhost";
+			d1.port = 3755;
+			d1.callerIds = RpcValue::List{1, 2};
+			FindTunnelReqCtl rq(TunnelCtl(RpcValue::fromChainPack(d1.toChainPack())));
+			QVERIFY(rq.state() == TunnelCtl::State::FindTunnelRequest);
+			QVERIFY(rq.host() == d1.host && rq.port() == d1.port && rq.callerIds() == d1.callerIds);
+			QVERIFY(rq.secret().empty());
+			rq.setSecret(std::string(300, 's'));
+			rq.set(100, RpcValue::Map{{"unknown", "key"}});
+			std::string packed = rq.toChainPack();
+			size_t consumed = 0;
+			FindTunnelReqCtl::Data d2 = FindTunnelReqCtl::Data::fromChainPack(packed.data(), packed.size(), &consumed);
+			QCOMPARE(consumed, packed.size());
+			QVERIFY(d2.host == d1.host && d2.port == d1.port && d2.secret == rq.secret() && d2.callerIds == d1.callerIds);
+			// struct is packed with the same meta data and fields as the RpcValue wrapper
+			FindTunnelReqCtl rq2;
+			rq2.setHost(d1.host);
+			rq2.setPort(d1.port);
+			rq2.setSecret(d2.secret);
+			rq2.setCallerIds(d1.callerIds);
+			QVERIFY(d2.toChainPack() == rq2.toChainPack());
+			// test case aborts on exception by default
+			bool abort_on_exception = shv::chainpack::Exception::isAbortOnException();
+			shv::chainpack::Exception::setAbortOnException(false);
+			for(const RpcValue &port : {RpcValue(int64_t(1) << 40), RpcValue(uint64_t(1) << 31)}) {
+				RpcValue::IMap m{{TunnelCtl::MetaType::Key::Port, port}};
+				bool out_of_range = false;
+				try {
+					FindTunnelReqCtl::Data::fromChainPack(RpcValue(m).toChainPack());
+				}
+				catch (const shv::chainpack::Exception &) {
+					out_of_range = true;
+				}
+				QVERIFY(out_of_range);
+			}
+			shv::chainpack::Exception::setAbortOnException(abort_on_exception);
+		}
+		{
+			qDebug() << "------------- Cpon long string escaping";
+			std::string str;
+			const char special[] = "\"\\\n\r\t\b\x01\x0c";
+			for(size_t i = 0; i < 2000; i++)
+				str += (i % 37 == 0)? special[i % (sizeof(special) - 1)]: static_cast<char>('a' + i % 26);
+			str += std::string(1, '\0') + "end";
+			std::string cpon = RpcValue(str).toCpon();
+			QVERIFY(cpon.find('\n') == std::string::npos);
+			QVERIFY(RpcValue::fromCpon(cpon) == RpcValue(str));
+			std::istringstream in(cpon);
+			CponReader rd(in);
+			QVERIFY(rd.read() == RpcValue(str));
+		}
+		{
+			qDebug() << "------------- Cpon double round trip";
+			for(double d : {0.1 + 0.2, 1. / 3, -2.5e-7, 123456.789012345, 6.02214076e23, 5e-324, std::numeric_limits<double>::max()}) {
+				std::string cpon = RpcValue(d).toCpon();
+				QVERIFY(RpcValue::fromCpon(cpon).toDouble() == d);
+			}
+			QCOMPARE(RpcValue(0.1 + 0.2).toCpon(), std::string("0.30000000000000004"));
+			QVERIFY(RpcValue::Decimal(1234567890123456789, -20).toDouble() == 0.01234567890123456789);
+		}
+		{
+			qDebug() << "------------- DateTime ISO string";
+			RpcValue::DateTime dt = RpcValue::DateTime::fromUtcString("2018-02-02T10:20:30.007+0130");
+			QCOMPARE(dt.toIsoString(), std::string("2018-02-02T10:20:30.007+0130"));
+			// same second, cached date part
+			QCOMPARE(RpcValue::DateTime::fromMSecsSinceEpoch(dt.msecsSinceEpoch() + 900, 90).toIsoString(), std::string("2018-02-02T10:20:30.907+0130"));
+			QCOMPARE(RpcValue::DateTime::fromMSecsSinceEpoch(dt.msecsSinceEpoch() + 1000, 0).toIsoString(), std::string("2018-02-02T08:50:31.007Z"));
+			QVERIFY(RpcValue::DateTime::fromUtcString("2024-02-29 23:59:59Z") == RpcValue::DateTime::fromUtcString("2024-03-01T00:59:59+01"));
+			long len = 0;
+			RpcValue::DateTime::fromUtcString("2024-02-29T23:59:59.123-0130\tx", &len);
+			QCOMPARE(len, 28L);
+		}
+		{
+			qDebug() << "------------- ChainPack varint all lengths";
+			RpcValue::List lst;
+			for(unsigned bits = 0; bits <= 64; bits++) {
+				uint64_t n = (bits == 0)? 0: (~static_cast<uint64_t>(0) >> (64 - bits));
+				lst.push_back(RpcValue(static_cast<RpcValue::UInt>(n)));
+				lst.push_back(RpcValue(static_cast<RpcValue::Int>(n >> 1)));
+				lst.push_back(RpcValue(-static_cast<RpcValue::Int>(n >> 1)));
+			}
+			lst.push_back(RpcValue(std::numeric_limits<int64_t>::min()));
+			lst.push_back(RpcValue(std::numeric_limits<int64_t>::max()));
+			lst.push_back(RpcValue(std::numeric_limits<uint64_t>::max()));
+			RpcValue cp1(lst);
+			// numbers in the middle of buffer and at its end
+			QVERIFY(RpcValue::fromChainPack(cp1.toChainPack()) == cp1);
+			for(const RpcValue &v : lst)
+				QVERIFY(RpcValue::fromChainPack(v.toChainPack()) == v);
+		}
+		{
+			qDebug() << "------------- long string single chunk";
+			std::string s(1024 * 1024 + 7, 'x');
+			for(size_t i = 0; i < s.size(); i++)
+				s[i] = static_cast<char>('a' + i % 26);
+			RpcValue cp1(s);
+			QVERIFY(RpcValue::fromChainPack(cp1.toChainPack()) == cp1);
+			QVERIFY(RpcValue::fromCpon(cp1.toCpon()) == cp1);
+			{
+				std::istringstream in(cp1.toChainPack());
+				ChainPackReader rd(in);
+				QVERIFY(rd.read() == cp1);
+			}
+			{
+				std::istringstream in(cp1.toCpon());
+				CponReader rd(in);
+				QVERIFY(rd.read() == cp1);
+			}
+			// escapes split string to chunks
+			s[10] = '"';
+			s[s.size() - 10] = '\n';
+			RpcValue cp2(s);
+			QVERIFY(RpcValue::fromCpon(cp2.toCpon()) == cp2);
+			RpcValue cp3(RpcValue::Map{{s, s}});
+			QVERIFY(RpcValue::fromCpon(cp3.toCpon()) == cp3);
+			QVERIFY(RpcValue::fromChainPack(cp3.toChainPack()) == cp3);
+		}
 #ifdef __linux
 		{
 			qDebug() << "------------- Memory usage";
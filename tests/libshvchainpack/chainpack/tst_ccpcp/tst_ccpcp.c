@@ -521,6 +521,62 @@ void test_vals()
 	}
 }
 
+/// pack to buffer ending right behind the number or having spare bytes, unpack it back
+static void test_chainpack_int_limit(bool is_signed, int64_t snum, uint64_t unum, const uint8_t *packed, size_t packed_len)
+{
+	for (size_t spare = 0; spare <= 16; spare += 16) {
+		for (size_t offset = 0; offset < 4; ++offset) {
+			uint8_t buff[64];
+			memset(buff, 0xaa, sizeof(buff));
+			ccpcp_pack_context out_ctx;
+			ccpcp_pack_context_init(&out_ctx, buff + offset, packed_len + spare, NULL);
+			if(is_signed)
+				cchainpack_pack_int(&out_ctx, snum);
+			else
+				cchainpack_pack_uint(&out_ctx, unum);
+			assert(out_ctx.err_no == CCPCP_RC_OK);
+			assert((size_t)(out_ctx.current - out_ctx.start) == packed_len);
+			if(memcmp(buff + offset, packed, packed_len)) {
+				printf("FAIL! pack int limit have:");
+				for (size_t i = 0; i < packed_len; ++i)
+					printf(" %02x", buff[offset + i]);
+				printf("\n");
+				assert(false);
+			}
+			ccpcp_unpack_context in_ctx;
+			ccpcp_unpack_context_init(&in_ctx, buff + offset, packed_len + spare, NULL, NULL);
+			cchainpack_unpack_next(&in_ctx);
+			assert(in_ctx.err_no == CCPCP_RC_OK);
+			assert((size_t)(in_ctx.current - in_ctx.start) == packed_len);
+			if(is_signed)
+				assert(in_ctx.item.type == CCPCP_ITEM_INT && in_ctx.item.as.Int == snum);
+			else
+				assert(in_ctx.item.type == CCPCP_ITEM_UINT && in_ctx.item.as.UInt == unum);
+		}
+	}
+}
+
+void test_chainpack_int_limits()
+{
+	printf("------------- ChainPack int limits \n");
+	{
+		static const uint8_t packed[] = {CP_Int, 0xf5, 0x00, 0x80, 0, 0, 0, 0, 0, 0, 0};
+		test_chainpack_int_limit(true, INT64_MIN, 0, packed, sizeof(packed));
+	}
+	{
+		static const uint8_t packed[] = {CP_Int, 0xf4, 0x7f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+		test_chainpack_int_limit(true, INT64_MAX, 0, packed, sizeof(packed));
+	}
+	{
+		static const uint8_t packed[] = {CP_Int, 0xf4, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+		test_chainpack_int_limit(true, -INT64_MAX, 0, packed, sizeof(packed));
+	}
+	{
+		static const uint8_t packed[] = {CP_UInt, 0xf4, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+		test_chainpack_int_limit(false, 0, UINT64_MAX, packed, sizeof(packed));
+	}
+}
+
 void test_cpons()
 {
 	const char* cpons[] = {
@@ -591,6 +647,7 @@ int main(int argc, const char * argv[])
 	printf("\nC Cpon test started.\n");
 
 	test_vals();
+	test_chainpack_int_limits();
 
 	test_pack_int(1, "1");
 	test_pack_int(-1234567890l, "-1234567890");
@@ -610,12 +667,16 @@ int main(int argc, const char * argv[])
 	test_pack_double(1.23e7, "1.23e7");
 	test_pack_double(1e8, "1e8");
 	test_pack_double(-1e8, "-1e8");
-	test_pack_double(-123456789e-8, "-1.234567");
-	test_pack_double(-123456789e-9, "-0.123456");
-	test_pack_double(-123456789e-10, "-1.234567e-2");
-	test_pack_double(123456789., "1.234567e8");
-	test_pack_double(123456789e1, "1.234567e9");
-	test_pack_double(123456789e2, "1.234567e10");
+	test_pack_double(-123456789e-8, "-1.23456789");
+	test_pack_double(-123456789e-9, "-0.123456789");
+	test_pack_double(-123456789e-10, "-1.23456789e-2");
+	test_pack_double(123456789., "1.23456789e8");
+	test_pack_double(123456789e1, "1.23456789e9");
+	test_pack_double(123456789e2, "1.23456789e10");
+	test_pack_double(0.1 + 0.2, "0.30000000000000004");
+	test_pack_double(1. / 3, "0.3333333333333333");
+	test_pack_double(5e-324, "5e-324");
+	test_pack_double(1.7976931348623157e308, "1.7976931348623157e308");
 
 	test_unpack_number("1", CCPCP_ITEM_INT, 1);
 	test_unpack_number("123u", CCPCP_ITEM_UINT, 123);
@@ -632,6 +693,9 @@ int main(int argc, const char * argv[])
 	test_unpack_number("-21.23e-4", CCPCP_ITEM_DECIMAL, -21.23e-4);
 	test_unpack_number("-0.567e-3", CCPCP_ITEM_DECIMAL, -0.567e-3);
 	test_unpack_number("1.23n", CCPCP_ITEM_DECIMAL, 1.23);
+	test_unpack_number("0.30000000000000004", CCPCP_ITEM_DECIMAL, 0.1 + 0.2);
+	test_unpack_number("1.2345678901234567e-5", CCPCP_ITEM_DECIMAL, 1.2345678901234567e-5);
+	test_unpack_number("1.7976931348623157e308", CCPCP_ITEM_DECIMAL, 1.7976931348623157e308);
 
 	test_unpack_datetime("d\"2018-02-02T0:00:00.001\"", 1, 0);
 	test_unpack_datetime("d\"1970-01-01 00:00:00-01\"", 0, -60);
@@ -644,6 +708,8 @@ int main(int argc, const char * argv[])
 	test_unpack_datetime("d\"2017-05-03T15:52:03.923Z\"", 923, 0);
 	test_unpack_datetime("d\"2017-05-03T15:52:03.000-0130\"", 0, -(1*60+30));
 	test_unpack_datetime("d\"2017-05-03T15:52:03.923+00\"", 923, 0);
+	test_unpack_datetime("d\"2024-02-29T23:59:59.999-0130\"", 999, -(1*60+30));
+	test_unpack_datetime("d\"1900-03-01T00:00:00.007Z\"", 7, 0);
 
 	if(datetime_str_to_msec_utc("d\"2017-05-03T18:30:00Z\"") != datetime_str_to_msec_utc("d\"2017-05-03T22:30:00+04\"")) {
 		printf("FAIL! UTC offsets shall be the same\n");